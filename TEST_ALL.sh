@@ -108,8 +108,19 @@ else
     ((FAIL++))
 fi
 
-# Test 11: Java bindings compilation
-echo "[11] Testing Java bindings compilation..."
+# Test 11: Link two modules big enough to be split into partitions
+echo "[11] Testing split module linking..."
+if ./flowbase/build/flowbase -j2 flowbase/examples/split_modules/main.flow -o /tmp/flow_split_modules &> /dev/null \
+    && /tmp/flow_split_modules &> /dev/null; then
+    echo "     ✓ split_modules linked and ran"
+    ((PASS++))
+else
+    echo "     ✗ split_modules failed"
+    ((FAIL++))
+fi
+
+# Test 12: Java bindings compilation
+echo "[12] Testing Java bindings compilation..."
 cd javabindings
 if javac -cp "src/main/java" -d /tmp/flowtest src/main/java/com/flowlang/bindings/*.java &> /dev/null; then
     echo "     ✓ Java bindings compiled"
@@ -120,8 +131,8 @@ else
 fi
 cd ..
 
-# Test 12: Count examples
-echo "[12] Checking example coverage..."
+# Test 13: Count examples
+echo "[13] Checking example coverage..."
 EXAMPLE_COUNT=$(ls flowbase/examples/*.flow 2>/dev/null | wc -l)
 if [ "$EXAMPLE_COUNT" -ge 10 ]; then
     echo "     ✓ $EXAMPLE_COUNT examples available"
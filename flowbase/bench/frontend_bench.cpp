@@ -0,0 +1,130 @@
+// Lexer + parser benchmark: times lexing and parsing (ms and MB/s) and tracks heap
+// allocations and peak live heap (global operator new) on a generated source
+// file, or on a .flow file.
+//
+//   flow-frontend-bench [units]         generate <units> struct + function pairs (default 2500, ~52k lines)
+//   flow-frontend-bench file.flow
+
+#include "include/Lexer/Lexer.h"
+#include "include/Parser/Parser.h"
+#include "include/Common/SourceManager.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+static size_t allocationCount = 0;
+static size_t liveBytes = 0;
+static size_t peakBytes = 0;
+
+// Each block carries its size in a 16-byte header so delete can track live bytes
+void *operator new(size_t size) {
+    allocationCount++;
+    if (auto *block = static_cast<size_t *>(std::malloc(size + 16))) {
+        *block = size;
+        liveBytes += size;
+        if (liveBytes > peakBytes) peakBytes = liveBytes;
+        return reinterpret_cast<char *>(block) + 16;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+    if (!memory) return;
+    auto *block = reinterpret_cast<size_t *>(static_cast<char *>(memory) - 16);
+    liveBytes -= *block;
+    std::free(block);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+// Peak heap above what was live when the phase started
+static size_t resetPeak() {
+    peakBytes = liveBytes;
+    return liveBytes;
+}
+
+static std::string generateSource(int units) {
+    std::string source;
+    for (int i = 0; i < units; i++) {
+        std::string n = std::to_string(i);
+        source += "struct Point" + n + " {\n    float x;\n    float y;\n}\n\n";
+        source += "func compute" + n + "(a: int, b: int) -> int {\n";
+        source += "    let mut total: int = a * " + n + " + b;\n";
+        source += "    for (k in 0..10) {\n        if (k % 2 == 0) {\n            total = total + k * a;\n";
+        source += "        } else {\n            total = total - (b << 1);\n        }\n    }\n";
+        source += "    while (total > 1000) {\n        total = total / 2;\n    }\n";
+        source += "    print(\"compute" + n + ": \" + total);\n    return total;\n}\n\n";
+    }
+    return source;
+}
+
+int main(int argc, char **argv) {
+    std::string arg = argc > 1 ? argv[1] : "2500";
+    std::shared_ptr<const flow::SourceFile> file;
+    if (arg.find_first_not_of("0123456789") == std::string::npos) {
+        // A realistic path length, so per-token filename copies would show up
+        file = flow::SourceManager::instance().addBuffer("/home/user/project/src/generated/bench.flow",
+                                                         generateSource(std::atoi(arg.c_str())));
+    } else {
+        file = flow::SourceManager::instance().loadFile(arg);
+        if (!file) {
+            std::cerr << "Error: Could not read " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    constexpr int runs = 5;
+    double bestLex = 0, bestParse = 0;
+    size_t lexAllocations = 0, parseAllocations = 0, lexPeak = 0, parsePeak = 0, tokenCount = 0;
+
+    for (int run = 0; run < runs; run++) {
+        // Lexing alone, materializing every token (what tools use)
+        size_t before = allocationCount;
+        size_t baseline = resetPeak();
+        auto start = std::chrono::steady_clock::now();
+        {
+            flow::Lexer lexer(*file);
+            std::vector<flow::Token> tokens = lexer.tokenize();
+            tokenCount = tokens.size();
+        }
+        auto lexEnd = std::chrono::steady_clock::now();
+        lexAllocations = allocationCount - before;
+        lexPeak = peakBytes - baseline;
+
+        // Parsing, pulling tokens from the lexer as the compiler does
+        before = allocationCount;
+        baseline = resetPeak();
+        auto parseStart = std::chrono::steady_clock::now();
+        flow::Lexer lexer(*file);
+        flow::Parser parser(lexer);
+        auto program = parser.parse();
+        auto parseEnd = std::chrono::steady_clock::now();
+        parseAllocations = allocationCount - before;
+        parsePeak = peakBytes - baseline;
+        if (!program) {
+            std::cerr << "Error: parse failed" << std::endl;
+            return 1;
+        }
+
+        double lexMs = std::chrono::duration<double, std::milli>(lexEnd - start).count();
+        double parseMs = std::chrono::duration<double, std::milli>(parseEnd - parseStart).count();
+        if (run == 0 || lexMs < bestLex) bestLex = lexMs;
+        if (run == 0 || parseMs < bestParse) bestParse = parseMs;
+    }
+
+    double megabytes = file->getText().size() / (1024.0 * 1024.0);
+    std::cout << "Source:       " << file->getLineCount() << " lines, " << file->getText().size() << " bytes\n"
+              << "Tokens:       " << tokenCount << " x " << sizeof(flow::Token) << " bytes\n"
+              << "Lex:          " << bestLex << " ms (" << megabytes / (bestLex / 1000) << " MB/s), "
+              << lexAllocations << " allocations, "
+              << lexPeak / 1024 << " KiB peak\n"
+              << "Lex + parse:  " << bestParse << " ms (" << megabytes / (bestParse / 1000) << " MB/s), "
+              << parseAllocations << " allocations, "
+              << parsePeak / 1024 << " KiB peak\n"
+              << "(best of " << runs << " runs)" << std::endl;
+    return 0;
+}
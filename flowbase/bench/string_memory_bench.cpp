@@ -0,0 +1,101 @@
+// String memory benchmark: runs the runtime calls the compiler emits for a
+// request handler that formats a response with `+`, the way a long-running
+// service would, and reports throughput and resident memory as it goes.
+//
+//   flow-string-bench [regions|none] [requests]   (default: both, 2000000)
+//
+// "regions" makes the calls --string-memory=regions compiles the loop below
+// to: the handler's only string is its return value, so it gets no region
+// and builds the response in the loop iteration's region, which is left at
+// the end of the iteration. "none" never releases anything, like
+// --string-memory=none. Run one mode per process to compare RSS, since
+// memory the first mode leaks stays resident.
+
+#include "include/Stdlib/FlowString.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace flow;
+
+// Current resident set in KiB (peak where /proc isn't available)
+static long residentKiB() {
+    if (FILE *statm = std::fopen("/proc/self/statm", "r")) {
+        long pages = 0, resident = 0;
+        int fields = std::fscanf(statm, "%ld %ld", &pages, &resident);
+        std::fclose(statm);
+        if (fields == 2) {
+            return resident * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+    }
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// func handle(id: int, latency: float, path: string) -> string {
+//     return "GET " + path + "?id=" + id + " took " + latency + "ms";
+// }
+static FlowString handle(int32_t id, double latency, FlowString path) {
+    char idBuffer[flowIntBufferSize];
+    char latencyBuffer[flowFloatBufferSize];
+    FlowString pieces[] = {
+        {"GET ", 4},
+        path,
+        {"?id=", 4},
+        {idBuffer, flow_format_int(id, idBuffer)},
+        {" took ", 6},
+        {latencyBuffer, flow_format_float(latency, latencyBuffer)},
+        {"ms", 2},
+    };
+    return flow_string_concat_n(pieces, sizeof(pieces) / sizeof(pieces[0]));
+}
+
+static void run(bool regions, int requests) {
+    std::cout << (regions ? "regions" : "none") << ":\n";
+
+    FlowString path{"/api/items", 10};
+    int64_t bytes = 0;
+    int reports = 4;
+    auto start = std::chrono::steady_clock::now();
+    for (int report = 1; report <= reports; report++) {
+        int end = static_cast<int>(static_cast<int64_t>(requests) * report / reports);
+        for (int i = static_cast<int>(static_cast<int64_t>(requests) * (report - 1) / reports); i < end; i++) {
+            // for (i in 0..requests) { let response = handle(...); ... }
+            int64_t iteration = regions ? flow_region_enter() : 0;
+            FlowString response = handle(i, (i % 1000) * 0.25, path);
+            bytes += response.length;
+            if (regions) {
+                flow_region_leave(iteration);
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << end << " requests: " << static_cast<long>(end / seconds) << " req/s, RSS "
+                  << residentKiB() << " KiB\n";
+    }
+    std::cout << "  (" << bytes << " bytes formatted)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::string mode = argc > 1 ? argv[1] : "both";
+    int requests = argc > 2 ? std::atoi(argv[2]) : 2000000;
+    if (mode != "regions" && mode != "none" && mode != "both") {
+        std::cerr << "Usage: flow-string-bench [regions|none] [requests]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Baseline RSS " << residentKiB() << " KiB\n";
+    if (mode != "none") run(true, requests);
+    if (mode != "regions") run(false, requests);
+    return 0;
+}
@@ -4,7 +4,11 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/Casting.h>
 #include "../Lexer/Token.h"
+#include "TypeContext.h"
 
 namespace flow {
     // Forward declarations
@@ -15,47 +19,104 @@ namespace flow {
 
     // ============================================================
 
+    // The concrete class of every node, so code can test nodes with
+    // isa<>/cast<>/dyn_cast<> (each class has a classof) instead of
+    // dynamic_cast. Expressions, statements and declarations are contiguous
+    // ranges so the abstract bases can be tested too.
+    enum class NodeKind : uint8_t {
+        // Expressions
+        IntLiteralExpr,
+        FloatLiteralExpr,
+        StringLiteralExpr,
+        BoolLiteralExpr,
+        IdentifierExpr,
+        ThisExpr,
+        BinaryExpr,
+        UnaryExpr,
+        CallExpr,
+        MemberAccessExpr,
+        StructInitExpr,
+        ArrayLiteralExpr,
+        IndexExpr,
+        LambdaExpr,
+
+        // Statements
+        ExprStmt,
+        VarDeclStmt,
+        AssignmentStmt,
+        ReturnStmt,
+        IfStmt,
+        ForStmt,
+        WhileStmt,
+        BlockStmt,
+
+        // Declarations
+        FunctionDecl,
+        StructDecl,
+        ImplDecl,
+        LinkDecl,
+        TypeDefDecl,
+        ImportDecl,
+        ModuleDecl,
+
+        Program,
+
+        FirstExpr = IntLiteralExpr,
+        LastExpr = LambdaExpr,
+        FirstStmt = ExprStmt,
+        LastStmt = BlockStmt,
+        FirstDecl = FunctionDecl,
+        LastDecl = ModuleDecl
+    };
+
+    using llvm::isa;
+    using llvm::cast;
+    using llvm::dyn_cast;
+
     class ASTNode {
+    private:
+        const NodeKind kind;
+
     public:
         SourceLocation location;
 
-        ASTNode(const SourceLocation &loc) : location(loc) {
+        ASTNode(NodeKind k, const SourceLocation &loc) : kind(k), location(loc) {
         }
 
         virtual ~ASTNode() = default;
 
+        NodeKind getKind() const { return kind; }
+
         virtual void accept(ASTVisitor &visitor) = 0;
     };
 
-    // ============================================================
-    // TYPE SYSTEM
-    // ============================================================
+    // Owns the nodes of one Program. Nodes are bump-allocated and destroyed
+    // together with the arena, so parents point at their children with plain
+    // pointers. Not thread-safe; only the parser creates nodes.
+    class ASTArena {
+    private:
+        llvm::BumpPtrAllocator allocator;
+        std::vector<ASTNode *> nodes; // to run their destructors
 
-    enum class TypeKind {
-        INT,
-        FLOAT,
-        STRING,
-        BOOL,
-        VOID,
-        STRUCT,
-        FUNCTION,
-        ARRAY,
-        UNKNOWN
-    };
-
-    class Type {
     public:
-        TypeKind kind;
-        std::string name;
-        std::vector<std::shared_ptr<Type> > typeParams; // For Option<T>, etc.
+        ASTArena() = default;
+
+        ASTArena(const ASTArena &) = delete;
+
+        ASTArena &operator=(const ASTArena &) = delete;
 
-        Type(TypeKind k, const std::string &n = "") : kind(k), name(n) {
+        ~ASTArena();
+
+        template<typename T, typename... Args>
+        T *create(Args &&... args) {
+            T *node = new(allocator.Allocate<T>()) T(std::forward<Args>(args)...);
+            nodes.push_back(node);
+            return node;
         }
 
-        bool isNumeric() const { return kind == TypeKind::INT || kind == TypeKind::FLOAT; }
-        bool isVoid() const { return kind == TypeKind::VOID; }
+        size_t getNodeCount() const { return nodes.size(); }
 
-        std::string toString() const;
+        size_t getBytesAllocated() const { return allocator.getBytesAllocated(); }
     };
 
     // ============================================================
@@ -64,9 +125,13 @@ namespace flow {
 
     class Expr : public ASTNode {
     public:
-        std::shared_ptr<Type> type; // Type inference result
+        const Type *type; // Type inference result
+
+        Expr(NodeKind kind, const SourceLocation &loc) : ASTNode(kind, loc), type(nullptr) {
+        }
 
-        Expr(const SourceLocation &loc) : ASTNode(loc), type(nullptr) {
+        static bool classof(const ASTNode *node) {
+            return node->getKind() >= NodeKind::FirstExpr && node->getKind() <= NodeKind::LastExpr;
         }
     };
 
@@ -74,142 +139,168 @@ namespace flow {
     public:
         int value;
 
-        IntLiteralExpr(int val, const SourceLocation &loc) : Expr(loc), value(val) {
+        IntLiteralExpr(int val, const SourceLocation &loc) : Expr(NodeKind::IntLiteralExpr, loc), value(val) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::IntLiteralExpr; }
     };
 
     class FloatLiteralExpr : public Expr {
     public:
         double value;
 
-        FloatLiteralExpr(double val, const SourceLocation &loc) : Expr(loc), value(val) {
+        FloatLiteralExpr(double val, const SourceLocation &loc) : Expr(NodeKind::FloatLiteralExpr, loc), value(val) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::FloatLiteralExpr; }
     };
 
     class StringLiteralExpr : public Expr {
     public:
         std::string value;
 
-        StringLiteralExpr(const std::string &val, const SourceLocation &loc) : Expr(loc), value(val) {
+        StringLiteralExpr(const std::string &val, const SourceLocation &loc) : Expr(NodeKind::StringLiteralExpr, loc), value(val) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::StringLiteralExpr; }
     };
 
     class BoolLiteralExpr : public Expr {
     public:
         bool value;
 
-        BoolLiteralExpr(bool val, const SourceLocation &loc) : Expr(loc), value(val) {
+        BoolLiteralExpr(bool val, const SourceLocation &loc) : Expr(NodeKind::BoolLiteralExpr, loc), value(val) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::BoolLiteralExpr; }
     };
 
     class IdentifierExpr : public Expr {
     public:
         std::string name;
 
-        IdentifierExpr(const std::string &n, const SourceLocation &loc) : Expr(loc), name(n) {
+        IdentifierExpr(const std::string &n, const SourceLocation &loc) : Expr(NodeKind::IdentifierExpr, loc), name(n) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::IdentifierExpr; }
     };
 
     class ThisExpr : public Expr {
     public:
-        ThisExpr(const SourceLocation &loc) : Expr(loc) {
+        ThisExpr(const SourceLocation &loc) : Expr(NodeKind::ThisExpr, loc) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::ThisExpr; }
     };
 
     class BinaryExpr : public Expr {
     public:
-        std::shared_ptr<Expr> left;
+        Expr *left;
         TokenType op;
-        std::shared_ptr<Expr> right;
+        Expr *right;
 
-        BinaryExpr(std::shared_ptr<Expr> l, TokenType o, std::shared_ptr<Expr> r, const SourceLocation &loc)
-            : Expr(loc), left(l), op(o), right(r) {
+        BinaryExpr(Expr *l, TokenType o, Expr *r, const SourceLocation &loc)
+            : Expr(NodeKind::BinaryExpr, loc), left(l), op(o), right(r) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::BinaryExpr; }
     };
 
     class UnaryExpr : public Expr {
     public:
         TokenType op;
-        std::shared_ptr<Expr> operand;
+        Expr *operand;
 
-        UnaryExpr(TokenType o, std::shared_ptr<Expr> operand, const SourceLocation &loc)
-            : Expr(loc), op(o), operand(operand) {
+        UnaryExpr(TokenType o, Expr *operand, const SourceLocation &loc)
+            : Expr(NodeKind::UnaryExpr, loc), op(o), operand(operand) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::UnaryExpr; }
     };
 
     class CallExpr : public Expr {
     public:
-        std::shared_ptr<Expr> callee;
-        std::vector<std::shared_ptr<Expr> > arguments;
+        Expr *callee;
+        std::vector<Expr *> arguments;
 
-        CallExpr(std::shared_ptr<Expr> c, std::vector<std::shared_ptr<Expr> > args, const SourceLocation &loc)
-            : Expr(loc), callee(c), arguments(args) {
+        CallExpr(Expr *c, std::vector<Expr *> args, const SourceLocation &loc)
+            : Expr(NodeKind::CallExpr, loc), callee(c), arguments(std::move(args)) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::CallExpr; }
     };
 
     class MemberAccessExpr : public Expr {
     public:
-        std::shared_ptr<Expr> object;
+        Expr *object;
         std::string member;
 
-        MemberAccessExpr(std::shared_ptr<Expr> obj, const std::string &mem, const SourceLocation &loc)
-            : Expr(loc), object(obj), member(mem) {
+        MemberAccessExpr(Expr *obj, const std::string &mem, const SourceLocation &loc)
+            : Expr(NodeKind::MemberAccessExpr, loc), object(obj), member(mem) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::MemberAccessExpr; }
     };
 
     class StructInitExpr : public Expr {
     public:
         std::string structName;
-        std::vector<std::shared_ptr<Expr> > fieldValues;
+        std::vector<Expr *> fieldValues;
 
-        StructInitExpr(const std::string &name, std::vector<std::shared_ptr<Expr> > fields, const SourceLocation &loc)
-            : Expr(loc), structName(name), fieldValues(fields) {
+        StructInitExpr(const std::string &name, std::vector<Expr *> fields, const SourceLocation &loc)
+            : Expr(NodeKind::StructInitExpr, loc), structName(name), fieldValues(std::move(fields)) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::StructInitExpr; }
     };
 
     class ArrayLiteralExpr : public Expr {
     public:
-        std::vector<std::shared_ptr<Expr> > elements;
+        std::vector<Expr *> elements;
 
-        ArrayLiteralExpr(std::vector<std::shared_ptr<Expr> > elems, const SourceLocation &loc)
-            : Expr(loc), elements(elems) {
+        ArrayLiteralExpr(std::vector<Expr *> elems, const SourceLocation &loc)
+            : Expr(NodeKind::ArrayLiteralExpr, loc), elements(std::move(elems)) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::ArrayLiteralExpr; }
     };
 
     class IndexExpr : public Expr {
     public:
-        std::shared_ptr<Expr> array;
-        std::shared_ptr<Expr> index;
+        Expr *array;
+        Expr *index;
 
-        IndexExpr(std::shared_ptr<Expr> arr, std::shared_ptr<Expr> idx, const SourceLocation &loc)
-            : Expr(loc), array(arr), index(idx) {
+        IndexExpr(Expr *arr, Expr *idx, const SourceLocation &loc)
+            : Expr(NodeKind::IndexExpr, loc), array(arr), index(idx) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::IndexExpr; }
     };
 
     // ============================================================
@@ -218,109 +309,129 @@ namespace flow {
 
     class Stmt : public ASTNode {
     public:
-        Stmt(const SourceLocation &loc) : ASTNode(loc) {
+        Stmt(NodeKind kind, const SourceLocation &loc) : ASTNode(kind, loc) {
+        }
+
+        static bool classof(const ASTNode *node) {
+            return node->getKind() >= NodeKind::FirstStmt && node->getKind() <= NodeKind::LastStmt;
         }
     };
 
     class ExprStmt : public Stmt {
     public:
-        std::shared_ptr<Expr> expression;
+        Expr *expression;
 
-        ExprStmt(std::shared_ptr<Expr> expr, const SourceLocation &loc)
-            : Stmt(loc), expression(expr) {
+        ExprStmt(Expr *expr, const SourceLocation &loc)
+            : Stmt(NodeKind::ExprStmt, loc), expression(expr) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::ExprStmt; }
     };
 
     class VarDeclStmt : public Stmt {
     public:
         std::string name;
         bool isMutable;
-        std::shared_ptr<Type> declaredType;
-        std::shared_ptr<Expr> initializer;
+        const Type *declaredType;
+        Expr *initializer;
 
-        VarDeclStmt(const std::string &n, bool mut, std::shared_ptr<Type> t,
-                    std::shared_ptr<Expr> init, const SourceLocation &loc)
-            : Stmt(loc), name(n), isMutable(mut), declaredType(t), initializer(init) {
+        VarDeclStmt(const std::string &n, bool mut, const Type *t,
+                    Expr *init, const SourceLocation &loc)
+            : Stmt(NodeKind::VarDeclStmt, loc), name(n), isMutable(mut), declaredType(t), initializer(init) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::VarDeclStmt; }
     };
 
     class AssignmentStmt : public Stmt {
     public:
         std::string target;
-        std::shared_ptr<Expr> value;
+        Expr *value;
 
-        AssignmentStmt(const std::string &t, std::shared_ptr<Expr> v, const SourceLocation &loc)
-            : Stmt(loc), target(t), value(v) {
+        AssignmentStmt(const std::string &t, Expr *v, const SourceLocation &loc)
+            : Stmt(NodeKind::AssignmentStmt, loc), target(t), value(v) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::AssignmentStmt; }
     };
 
     class ReturnStmt : public Stmt {
     public:
-        std::shared_ptr<Expr> value;
+        Expr *value;
 
-        ReturnStmt(std::shared_ptr<Expr> val, const SourceLocation &loc)
-            : Stmt(loc), value(val) {
+        ReturnStmt(Expr *val, const SourceLocation &loc)
+            : Stmt(NodeKind::ReturnStmt, loc), value(val) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::ReturnStmt; }
     };
 
     class IfStmt : public Stmt {
     public:
-        std::shared_ptr<Expr> condition;
-        std::vector<std::shared_ptr<Stmt> > thenBranch;
-        std::vector<std::shared_ptr<Stmt> > elseBranch;
+        Expr *condition;
+        std::vector<Stmt *> thenBranch;
+        std::vector<Stmt *> elseBranch;
 
-        IfStmt(std::shared_ptr<Expr> cond, std::vector<std::shared_ptr<Stmt> > thenB,
-               std::vector<std::shared_ptr<Stmt> > elseB, const SourceLocation &loc)
-            : Stmt(loc), condition(cond), thenBranch(thenB), elseBranch(elseB) {
+        IfStmt(Expr *cond, std::vector<Stmt *> thenB,
+               std::vector<Stmt *> elseB, const SourceLocation &loc)
+            : Stmt(NodeKind::IfStmt, loc), condition(cond), thenBranch(std::move(thenB)), elseBranch(std::move(elseB)) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::IfStmt; }
     };
 
     class ForStmt : public Stmt {
     public:
         std::string iteratorVar;
-        std::shared_ptr<Expr> rangeStart;
-        std::shared_ptr<Expr> rangeEnd;
-        std::shared_ptr<Expr> iterable; // For array iteration
-        std::vector<std::shared_ptr<Stmt> > body;
+        Expr *rangeStart;
+        Expr *rangeEnd;
+        Expr *iterable; // For array iteration
+        std::vector<Stmt *> body;
 
         ForStmt(const std::string &var, const SourceLocation &loc)
-            : Stmt(loc), iteratorVar(var), rangeStart(nullptr), rangeEnd(nullptr), iterable(nullptr) {
+            : Stmt(NodeKind::ForStmt, loc), iteratorVar(var), rangeStart(nullptr), rangeEnd(nullptr), iterable(nullptr) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::ForStmt; }
     };
 
     class WhileStmt : public Stmt {
     public:
-        std::shared_ptr<Expr> condition;
-        std::vector<std::shared_ptr<Stmt> > body;
+        Expr *condition;
+        std::vector<Stmt *> body;
 
-        WhileStmt(std::shared_ptr<Expr> cond, std::vector<std::shared_ptr<Stmt> > b, const SourceLocation &loc)
-            : Stmt(loc), condition(cond), body(b) {
+        WhileStmt(Expr *cond, std::vector<Stmt *> b, const SourceLocation &loc)
+            : Stmt(NodeKind::WhileStmt, loc), condition(cond), body(std::move(b)) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::WhileStmt; }
     };
 
     class BlockStmt : public Stmt {
     public:
-        std::vector<std::shared_ptr<Stmt> > statements;
+        std::vector<Stmt *> statements;
 
-        BlockStmt(std::vector<std::shared_ptr<Stmt> > stmts, const SourceLocation &loc)
-            : Stmt(loc), statements(stmts) {
+        BlockStmt(std::vector<Stmt *> stmts, const SourceLocation &loc)
+            : Stmt(NodeKind::BlockStmt, loc), statements(std::move(stmts)) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::BlockStmt; }
     };
 
     // ============================================================
@@ -331,16 +442,20 @@ namespace flow {
     public:
         std::string name;
 
-        Decl(const std::string &n, const SourceLocation &loc) : ASTNode(loc), name(n) {
+        Decl(NodeKind kind, const std::string &n, const SourceLocation &loc) : ASTNode(kind, loc), name(n) {
+        }
+
+        static bool classof(const ASTNode *node) {
+            return node->getKind() >= NodeKind::FirstDecl && node->getKind() <= NodeKind::LastDecl;
         }
     };
 
     class Parameter {
     public:
         std::string name;
-        std::shared_ptr<Type> type;
+        const Type *type;
 
-        Parameter(const std::string &n, std::shared_ptr<Type> t) : name(n), type(t) {
+        Parameter(const std::string &n, const Type *t) : name(n), type(t) {
         }
     };
 
@@ -348,37 +463,41 @@ namespace flow {
     class LambdaExpr : public Expr {
     public:
         std::vector<Parameter> parameters;
-        std::shared_ptr<Type> returnType;
-        std::vector<std::shared_ptr<Stmt> > body;
+        const Type *returnType;
+        std::vector<Stmt *> body;
 
-        LambdaExpr(const SourceLocation &loc) : Expr(loc), returnType(nullptr) {
+        LambdaExpr(const SourceLocation &loc) : Expr(NodeKind::LambdaExpr, loc), returnType(nullptr) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::LambdaExpr; }
     };
 
     class FunctionDecl : public Decl {
     public:
         std::vector<Parameter> parameters;
-        std::shared_ptr<Type> returnType;
-        std::vector<std::shared_ptr<Stmt> > body;
+        const Type *returnType;
+        std::vector<Stmt *> body;
         bool isAsync;
         bool isExported;
         std::string abi; // For exported functions
 
         FunctionDecl(const std::string &n, const SourceLocation &loc)
-            : Decl(n, loc), isAsync(false), isExported(false), abi("") {
+            : Decl(NodeKind::FunctionDecl, n, loc), isAsync(false), isExported(false), abi("") {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::FunctionDecl; }
     };
 
     class StructField {
     public:
-        std::shared_ptr<Type> type;
+        const Type *type;
         std::string name;
 
-        StructField(std::shared_ptr<Type> t, const std::string &n) : type(t), name(n) {
+        StructField(const Type *t, const std::string &n) : type(t), name(n) {
         }
     };
 
@@ -387,10 +506,12 @@ namespace flow {
         std::vector<StructField> fields;
 
         StructDecl(const std::string &n, std::vector<StructField> f, const SourceLocation &loc)
-            : Decl(n, loc), fields(f) {
+            : Decl(NodeKind::StructDecl, n, loc), fields(std::move(f)) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::StructDecl; }
     };
 
     class ImplDecl : public Decl {
@@ -398,14 +519,16 @@ namespace flow {
         std::string structName;
         std::string methodName;
         std::vector<Parameter> parameters;
-        std::shared_ptr<Type> returnType;
-        std::vector<std::shared_ptr<Stmt> > body;
+        const Type *returnType;
+        std::vector<Stmt *> body;
 
         ImplDecl(const std::string &sName, const std::string &mName, const SourceLocation &loc)
-            : Decl(sName + "::" + mName, loc), structName(sName), methodName(mName), returnType(nullptr) {
+            : Decl(NodeKind::ImplDecl, sName + "::" + mName, loc), structName(sName), methodName(mName), returnType(nullptr) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::ImplDecl; }
     };
 
     class LinkDecl : public Decl {
@@ -413,25 +536,29 @@ namespace flow {
         std::string adapter; // "c", "python", "js"
         std::string module; // Optional module name
         std::string inlineCode; // For inline blocks
-        std::vector<std::shared_ptr<FunctionDecl> > functions;
+        std::vector<FunctionDecl *> functions;
 
         LinkDecl(const std::string &adp, const std::string &mod, const SourceLocation &loc)
-            : Decl("", loc), adapter(adp), module(mod), inlineCode("") {
+            : Decl(NodeKind::LinkDecl, "", loc), adapter(adp), module(mod), inlineCode("") {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::LinkDecl; }
     };
 
     // Type definition declaration
     class TypeDefDecl : public Decl {
     public:
-        std::shared_ptr<Type> aliasedType;
+        const Type *aliasedType;
 
-        TypeDefDecl(const std::string &name, std::shared_ptr<Type> aliasedType, const SourceLocation &loc)
-            : Decl(name, loc), aliasedType(aliasedType) {
+        TypeDefDecl(const std::string &name, const Type *aliasedType, const SourceLocation &loc)
+            : Decl(NodeKind::TypeDefDecl, name, loc), aliasedType(aliasedType) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::TypeDefDecl; }
     };
 
     // Import declaration - for multi-file support
@@ -442,20 +569,24 @@ namespace flow {
         std::string alias; // Optional alias for the module
 
         ImportDecl(const std::string &path, const SourceLocation &loc)
-            : Decl("", loc), modulePath(path), alias("") {
+            : Decl(NodeKind::ImportDecl, "", loc), modulePath(path), alias("") {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::ImportDecl; }
     };
 
     // Module declaration - defines the current module name
     class ModuleDecl : public Decl {
     public:
         ModuleDecl(const std::string &name, const SourceLocation &loc)
-            : Decl(name, loc) {
+            : Decl(NodeKind::ModuleDecl, name, loc) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::ModuleDecl; }
     };
 
     // ============================================================
@@ -464,12 +595,16 @@ namespace flow {
 
     class Program : public ASTNode {
     public:
-        std::vector<std::shared_ptr<Decl> > declarations;
+        std::vector<Decl *> declarations;
+
+        ASTArena arena; // owns every node below this one
 
-        Program(const SourceLocation &loc) : ASTNode(loc) {
+        Program(const SourceLocation &loc) : ASTNode(NodeKind::Program, loc) {
         }
 
         void accept(ASTVisitor &visitor) override;
+
+        static bool classof(const ASTNode *node) { return node->getKind() == NodeKind::Program; }
     };
 
     // ============================================================
@@ -0,0 +1,125 @@
+#ifndef FLOW_TYPE_CONTEXT_H
+#define FLOW_TYPE_CONTEXT_H
+
+#include <array>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace flow {
+    enum class TypeKind {
+        INT,
+        FLOAT,
+        STRING,
+        BOOL,
+        VOID,
+        STRUCT,
+        FUNCTION,
+        ARRAY,
+        UNKNOWN
+    };
+
+    class TypeContext;
+
+    // A Flow type. Types are created only by TypeContext, which hands out one
+    // object per distinct (kind, name, params), so two types are the same
+    // exactly when their pointers are equal. Immutable once created.
+    class Type {
+    private:
+        std::string spelling; // cached toString()
+
+        Type(TypeKind k, const std::string &n, std::vector<const Type *> params);
+
+        friend class TypeContext;
+
+    public:
+        const TypeKind kind;
+        const std::string name;
+        const std::vector<const Type *> typeParams; // For Option<T>, T[], function types
+
+        Type(const Type &) = delete;
+        Type &operator=(const Type &) = delete;
+
+        bool isNumeric() const { return kind == TypeKind::INT || kind == TypeKind::FLOAT; }
+        bool isVoid() const { return kind == TypeKind::VOID; }
+
+        const std::string &toString() const { return spelling; }
+    };
+
+    // Uniques every Type in the process. Types live as long as the process,
+    // so the parser, Sema and codegen can hold plain pointers to them and
+    // compare them with ==. Thread-safe: the table is split into shards by
+    // hash, and a type that already exists is found under a shared lock, so
+    // threads checking bodies in parallel don't wait on each other.
+    class TypeContext {
+    private:
+        // Borrows the name and parameters, from the caller for a lookup and
+        // from the Type itself for a stored entry, so a lookup doesn't copy
+        struct Key {
+            TypeKind kind;
+            std::string_view name;
+            const std::vector<const Type *> *params;
+            size_t hash;
+
+            bool operator==(const Key &other) const {
+                return kind == other.kind && name == other.name && *params == *other.params;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const { return key.hash; }
+        };
+
+        struct Shard {
+            std::shared_mutex mutex;
+            std::unordered_map<Key, std::unique_ptr<Type>, KeyHash> types;
+        };
+
+        static constexpr size_t shardCount = 16;
+        std::array<Shard, shardCount> shards;
+
+        // Built once so the common types don't take the lock
+        const Type *intType;
+        const Type *floatType;
+        const Type *stringType;
+        const Type *boolType;
+        const Type *voidType;
+
+        TypeContext();
+
+    public:
+        static TypeContext &instance();
+
+        // The unique type with this kind, name and parameters
+        const Type *get(TypeKind kind, const std::string &name, const std::vector<const Type *> &params = {});
+
+        const Type *getInt() const { return intType; }
+        const Type *getFloat() const { return floatType; }
+        const Type *getString() const { return stringType; }
+        const Type *getBool() const { return boolType; }
+        const Type *getVoid() const { return voidType; }
+
+        const Type *getUnknown(const std::string &name = "") { return get(TypeKind::UNKNOWN, name); }
+
+        const Type *getStruct(const std::string &name) { return get(TypeKind::STRUCT, name); }
+
+        // T[]
+        const Type *getArray(const Type *element) {
+            return get(TypeKind::ARRAY, "array", {element});
+        }
+
+        // T?, spelled Option<T>
+        const Type *getOption(const Type *value) {
+            return get(TypeKind::STRUCT, "Option", {value});
+        }
+
+        // A function type keeps its return type in typeParams[0] and the
+        // parameter types after it
+        const Type *getFunction(const Type *returnType, const std::vector<const Type *> &paramTypes);
+    };
+} // namespace flow
+
+#endif // FLOW_TYPE_CONTEXT_H
@@ -2,13 +2,20 @@
 #define FLOW_CODEGEN_H
 
 #include "../AST/AST.h"
+#include "../Common/ScopedTable.h"
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Value.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/raw_ostream.h>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace flow {
     class CodeGenerator : public ASTVisitor {
@@ -17,18 +24,30 @@ namespace flow {
         std::unique_ptr<llvm::Module> module;
         std::unique_ptr<llvm::IRBuilder<> > builder;
 
-        std::map<std::string, llvm::Value *> namedValues;
+        // Flow strings lower to this { ptr data, i64 length } struct; see
+        // Stdlib/FlowString.h for the runtime side
+        llvm::StructType *stringType;
+
+        // Flow arrays lower to a pointer to this { ptr data, i64 length,
+        // i64 capacity } header; see Stdlib/FlowArray.h
+        llvm::StructType *arrayType;
+
+        // Locals of the function being generated; each function, method and
+        // lambda body is an isolated scope
+        ScopedTable<llvm::Value *> namedValues;
         std::map<std::string, llvm::StructType *> structTypes;
         std::map<std::string, std::map<std::string, int> > structFieldIndices;
+        std::map<std::string, std::vector<const Type *> > structFieldTypes; // Flow types, in field order
         
         // Track lambda variables (variable name -> lambda function)
-        std::map<std::string, llvm::Function *> lambdaValues;
-
+        ScopedTable<llvm::Function *> lambdaValues;
 
-        std::map<std::string, std::shared_ptr<Type> > typeAliases;
 
+        std::map<std::string, const Type *> typeAliases;
 
-        std::map<llvm::Value *, int> arrayLengths;
+        // Lowered types; cleared when a struct or alias is declared, since
+        // either can change what a name lowers to
+        std::unordered_map<const Type *, llvm::Type *> llvmTypes;
 
         // Foreign function tracking for IPC
         struct ForeignFunctionInfo {
@@ -47,13 +66,186 @@ namespace flow {
 
         llvm::Value *currentValue; // Hold the result of the last visited expression
 
-        llvm::Type *getLLVMType(std::shared_ptr<Type> flowType);
+        // Optimization settings (-O0..-O3, sizeLevel 1 = -Os, 2 = -Oz)
+        int optimizationLevel;
+        int sizeLevel;
+        int ltoMode; // 0 = off, 1 = ThinLTO, 2 = full LTO (pre-link pipeline, bitcode output)
+        bool moduleOptimized;
+
+        // PGO: instrument so the program writes a .profraw here, or optimize
+        // with a merged .profdata profile
+        std::string profileGenerateFile;
+        std::string profileUseFile;
+
+        int lambdaCounter;
+
+        // Threads for generating function bodies (0 = one per hardware thread)
+        unsigned jobs;
+
+        // Threads for running the backend over one module's partitions
+        // (1 = one after another, 0 = one per hardware thread)
+        unsigned codegenThreads;
+
+        // Release the strings a function or loop iteration builds when it
+        // ends (--string-memory=regions), along with its arrays; off, strings
+        // and arrays are never freed
+        bool stringRegions;
+
+        // Set when generateBodies fails for the program being generated
+        bool bodiesFailed;
+
+        // Region mark of the function being generated, or null if it doesn't
+        // enter one
+        llvm::Value *functionRegion;
+
+        // Declared return type of the function being generated, so a returned
+        // value's strings and arrays can be kept
+        const Type *functionReturnType;
+
+        // Assignments, in the loops being generated, to variables declared
+        // outside an iteration region, with the mark of the outermost such
+        // region so the value is kept past it
+        std::map<AssignmentStmt *, llvm::Value *> loopAssignmentMarks;
+
+        // Functions declared through declareExternalFunction, so partitions
+        // can declare them too
+        std::vector<FunctionDecl *> externalDecls;
+
+        // Declarations made ahead of a body in this module, which the
+        // function or method visitor fills in instead of creating a new one
+        std::set<llvm::Function *> prototypes;
+
+        // Target CPU and feature string ("native" resolves to the host)
+        std::string targetCPU;
+        std::string targetFeatures;
+
+        // Created lazily and shared by the optimizer and object emission
+        std::unique_ptr<llvm::TargetMachine> targetMachine;
+        std::string targetMachineKey; // triple, CPU, features and -O it was created for
+
+        llvm::TargetMachine *getTargetMachine();
+
+        // A new machine for the module's triple and this generator's CPU,
+        // features and -O; null (with an error reported) if there isn't one
+        std::unique_ptr<llvm::TargetMachine> createTargetMachine(const std::string &triple);
+
+        // Optimize and run the backend, writing the object file to dest
+        bool emitObject(llvm::raw_pwrite_stream &dest);
+
+        // Split the optimized module with llvm::SplitModule and run the
+        // backend on the parts in parallel, one object per part
+        bool emitPartitions(std::vector<llvm::SmallVector<char, 0> > &objects, size_t partitions);
+
+        llvm::Type *getLLVMType(const Type *flowType);
+
+        llvm::Type *lowerType(const Type *flowType); // getLLVMType without the cache
 
         llvm::FunctionType *getFunctionType(FunctionDecl &funcDecl);
 
+        // getFunctionType with the C ABI for `link` functions: strings are
+        // passed and returned as NUL-terminated char pointers
+        llvm::FunctionType *getForeignFunctionType(FunctionDecl &funcDecl);
+
+        // String values: build one, or convert at a C call boundary
+        llvm::Value *createString(llvm::Value *data, llvm::Value *length);
+
+        llvm::Value *toCString(llvm::Value *str);
+
+        llvm::Value *fromCString(llvm::Value *ptr);
+
+        // Calls the string runtime function name with the (data, length) of
+        // each string followed by extra
+        llvm::Value *callStringRuntime(const std::string &name, const std::vector<llvm::Value *> &strings,
+                                       const std::vector<llvm::Value *> &extra = {});
+
+        // The string a value of type valueType contributes to a `+`; a number
+        // is formatted into a stack buffer, so the result must be copied
+        llvm::Value *stringify(llvm::Value *value, const Type *valueType);
+
+        // A `+` with a string on either side
+        bool isStringConcat(BinaryExpr &node);
+
+        // The operands of a chain of string `+`, left to right, so the chain
+        // can be joined with one allocation
+        void flattenConcat(Expr *expr, std::vector<Expr *> &operands);
+
+        llvm::Value *concatStrings(const std::vector<llvm::Value *> &pieces);
+
+        // Array values: the lowered element type of an array type, the
+        // element pointer, the length as an int, a pointer to element index
+        // (trapping when it's out of bounds) and an amortized O(1) push, which
+        // keeps what the value carries in the array's region
+        bool isArrayType(const Type *type);
+
+        llvm::Type *arrayElementType(const Type *type);
+
+        llvm::Value *arrayData(llvm::Value *array);
+
+        llvm::Value *arrayLength(llvm::Value *array);
+
+        llvm::Value *arrayElement(llvm::Value *array, llvm::Value *index, llvm::Type *elementType);
+
+        void pushElement(llvm::Value *array, llvm::Value *value, const Type *elementFlowType);
+
+        // Stack slot in the entry block, so it's allocated once per call even
+        // when the code using it runs in a loop
+        llvm::AllocaInst *createEntryAlloca(llvm::Type *type, const std::string &name);
+
+        // Field types of a declared struct or Option<T>, or null
+        const std::vector<const Type *> *structFieldTypesOf(const Type *type);
+
+        // Whether a value of this type carries memory from a region: strings
+        // and arrays, directly or in struct fields
+        bool holdsRegionMemory(const Type *type);
+
+        // Whether expr itself (not the expressions inside it) can allocate
+        // strings or arrays in the region it runs in
+        bool allocatesString(Expr *expr);
+
+        // Whether body can allocate strings or arrays in the region it runs in
+        bool buildsStrings(const std::vector<Stmt *> &body);
+
+        // Enter a string region for a function body or one loop iteration if
+        // it builds strings or arrays; returns the mark to leave it with, or
+        // null. A loop's assignments to outer variables are recorded in
+        // loopAssignmentMarks.
+        llvm::Value *enterRegion(const std::vector<Stmt *> &body, bool loopBody);
+
+        void leaveRegion(llvm::Value *mark);
+
+        // Leave a loop iteration's region and forget its assignments
+        void leaveLoopRegion(llvm::Value *mark);
+
+        // value (of Flow type type) with each string and array it carries kept
+        // past the regions from mark up
+        llvm::Value *keepValue(llvm::Value *value, const Type *type, llvm::Value *mark);
+
+        // An array kept past the regions from mark up, with its elements
+        llvm::Value *keepArray(llvm::Value *array, const Type *type, llvm::Value *mark);
+
+        // Return value (null for void), leaving the function's region first
+        void createReturn(llvm::Value *value);
+
+        // Null if the struct hasn't been declared
+        llvm::FunctionType *getMethodType(ImplDecl &node);
+
+        // Declare a function or method ahead of its body
+        void declarePrototype(Decl &decl);
+
+        // The prototype made for name if it matches type, else a new function
+        llvm::Function *createFunction(llvm::FunctionType *type, const std::string &name);
+
+        // Generate function and method bodies, split into partitions that are
+        // generated in parallel and linked when there are enough of them;
+        // false if a partition couldn't be read back or linked
+        bool generateBodies(const std::vector<Decl *> &declarations, const std::vector<Decl *> &bodies);
+
+        bool generatePartitions(const std::vector<Decl *> &declarations, const std::vector<Decl *> &bodies,
+                                size_t partitions);
+
         void declareBuiltinFunctions();
 
-        std::shared_ptr<Type> resolveTypeAlias(std::shared_ptr<Type> type);
+        const Type *resolveTypeAlias(const Type *type);
 
         // Module loading for imports
         std::string resolveModulePath(const std::string &importPath);
@@ -65,13 +257,60 @@ namespace flow {
     public:
         CodeGenerator(const std::string &moduleName);
 
+        ~CodeGenerator();
 
-        void generate(std::shared_ptr<Program> program);
+
+        // False if the bodies couldn't be generated, which leaves the module
+        // with prototypes only
+        bool generate(std::shared_ptr<Program> program);
         
         void setLibraryPaths(const std::vector<std::string> &paths) {
             libraryPaths = paths;
         }
 
+        void setOptimizationLevel(int level, int size = 0) {
+            optimizationLevel = level;
+            sizeLevel = size;
+        }
+
+        void setJobs(unsigned count) {
+            jobs = count;
+        }
+
+        void setCodegenThreads(unsigned count) {
+            codegenThreads = count;
+        }
+
+        void setStringRegions(bool enabled) {
+            stringRegions = enabled;
+        }
+
+        void setLTOMode(int mode) {
+            ltoMode = mode;
+        }
+
+        void setProfile(const std::string &generateFile, const std::string &useFile) {
+            profileGenerateFile = generateFile;
+            profileUseFile = useFile;
+        }
+
+        void setTargetCPU(const std::string &cpu, const std::string &features = "") {
+            targetCPU = cpu;
+            targetFeatures = features;
+        }
+
+        // Register the native target with LLVM (once per process)
+        static void initializeTargets();
+
+        // Resolve a CPU name ("" -> generic, "native" -> host CPU)
+        static std::string resolveTargetCPU(const std::string &cpu);
+
+        // Resolve a feature string; "native" prepends the host's features
+        static std::string resolveTargetFeatures(const std::string &cpu, const std::string &features);
+
+        // Run the LLVM optimization pipeline over the module (once)
+        void optimizeModule();
+
         // Declare external function (for multi-file compilation)
         void declareExternalFunction(FunctionDecl &funcDecl);
 
@@ -82,8 +321,21 @@ namespace flow {
 
         void compileToObject(const std::string &filename);
 
+        // Write LTO bitcode (with a summary for ThinLTO); optimizes with the
+        // pre-link pipeline first
+        bool compileToBitcode(const std::string &filename);
+
+        // Emit the module into memory, e.g. to hand straight to the linker.
+        // A large module becomes several objects, in partition order, at any
+        // codegen thread count; link all of them.
+        bool compileToMemory(std::vector<llvm::SmallVector<char, 0> > &objects);
+
         llvm::Module *getModule() { return module.get(); }
 
+        // Hand the module and the context that owns it to a new owner (e.g. the
+        // JIT). The generator can't be used afterwards.
+        std::unique_ptr<llvm::Module> takeModule(std::unique_ptr<llvm::LLVMContext> &moduleContext);
+
         // Get list of linked libraries (for Driver to pass to linker)
         std::vector<std::string> getLinkedLibraries() const;
 
@@ -3,15 +3,22 @@
 
 #include "../Lexer/Token.h"
 #include <string>
-#include <vector>
-#include <map>
+#include <ostream>
 
 namespace flow {
+    // Source context for diagnostics comes from the SourceManager, so files
+    // ModuleGraph already loaded aren't read again
     class ErrorReporter {
-    private:
-        std::map<std::string, std::vector<std::string> > sourceLines; // filename -> lines
-
     public:
+        // Diagnostic streams for the calling thread (std::cout/std::cerr by default).
+        // Parallel builds point these at per-module buffers and replay them in order.
+        static std::ostream &output();
+
+        static std::ostream &errors();
+
+        static void redirect(std::ostream *out, std::ostream *err);
+
+        // Make sure a file's text is available for context (no-op if already loaded)
         void loadSourceFile(const std::string &filename);
 
         void reportError(const std::string &type, const std::string &message, const SourceLocation &loc);
@@ -0,0 +1,105 @@
+#ifndef FLOW_MODULE_GRAPH_H
+#define FLOW_MODULE_GRAPH_H
+
+#include "../AST/AST.h"
+#include "SourceManager.h"
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace flow {
+    // A source file and its parsed program, shared by everything that needs it
+    struct ModuleUnit {
+        std::string path;
+        std::shared_ptr<const SourceFile> file; // null if the file couldn't be read
+        std::string_view source;                // file's text
+        std::shared_ptr<Program> program; // null if the module failed to lex/parse
+        std::string error;                // why program is null
+        size_t tokenCount;
+
+        ModuleUnit() : tokenCount(0) {
+        }
+    };
+
+    // Owns every module read during a compilation session so each file is read and
+    // parsed once, no matter how many modules import it. The driver, multi-file
+    // builder, sema, codegen and LSP all go through the same graph. A module is
+    // re-parsed only when its file changes on disk (or its overlay is replaced).
+    // Thread-safe: parallel builds load different modules concurrently.
+    class ModuleGraph {
+    private:
+        // What stat says about a module's file. A file replaced by another
+        // of the same size and mtime still has a new inode.
+        struct FileStamp {
+            uintmax_t size;
+            std::filesystem::file_time_type modifiedTime;
+            uint64_t inode;
+            uint64_t device;
+
+            FileStamp() : size(0), inode(0), device(0) {
+            }
+
+            bool operator==(const FileStamp &other) const {
+                return size == other.size && modifiedTime == other.modifiedTime && inode == other.inode
+                       && device == other.device;
+            }
+        };
+
+        struct Slot {
+            std::mutex mutex;
+            std::shared_ptr<const ModuleUnit> unit;
+            FileStamp stamp;
+            uint64_t textHash;
+            // stamp was taken within a timestamp tick of the file's last
+            // write, so an edit that keeps the size could keep the stamp too;
+            // textHash decides until the file is old enough to trust stamp
+            bool racy;
+            bool overlay; // in-memory text from an editor, ignores the file on disk
+
+            Slot() : textHash(0), racy(true), overlay(false) {
+            }
+        };
+
+        std::mutex slotsMutex;
+        std::map<std::string, std::shared_ptr<Slot> > slots; // by canonical path
+        size_t parses;
+
+        std::shared_ptr<Slot> getSlot(const std::string &path);
+
+        static bool stampFile(const std::string &path, FileStamp &stamp);
+
+        static std::shared_ptr<ModuleUnit> parse(const std::string &path, std::shared_ptr<const SourceFile> file);
+
+    public:
+        ModuleGraph() : parses(0) {
+        }
+
+        static ModuleGraph &instance() {
+            static ModuleGraph graph;
+            return graph;
+        }
+
+        // Read and parse a module, or return the cached unit if the file is unchanged.
+        // Paths naming the same file share a unit; a relative path is taken from
+        // the current directory. Never returns null; check unit->program / unit->error.
+        std::shared_ptr<const ModuleUnit> load(const std::string &path);
+
+        // Use editor contents for a module instead of the file on disk
+        void setOverlay(const std::string &path, std::shared_ptr<const SourceFile> file, std::shared_ptr<Program> program);
+
+        void clearOverlay(const std::string &path);
+
+        // Resolve an import relative to the importing file's directory, then the
+        // library paths, $FLOW_PATH and ~/.river/packages
+        static std::string resolveImport(const std::string &importPath, const std::string &fromDir,
+                                         const std::vector<std::string> &libraryPaths);
+
+        // Number of parses performed (for -v statistics)
+        size_t parseCount();
+    };
+} // namespace flow
+
+#endif // FLOW_MODULE_GRAPH_H
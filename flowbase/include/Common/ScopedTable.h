@@ -0,0 +1,159 @@
+#ifndef FLOW_SCOPED_TABLE_H
+#define FLOW_SCOPED_TABLE_H
+
+#include "StringInterner.h"
+#include <cstdint>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+namespace flow {
+    // Maps interned names to values through nested scopes. An open-addressing
+    // table keyed by SymbolID points at each name's innermost definition, and
+    // every definition remembers the one it shadows, so entering a scope is
+    // O(1) and leaving one only touches the names it defined. An isolated
+    // scope (a function body) hides everything defined outside it until it
+    // is left. A value stays at the same address until its scope is left.
+    template<typename Value>
+    class ScopedTable {
+    private:
+        static constexpr uint32_t none = ~0u;
+
+        struct Slot {
+            SymbolID key;   // noSymbol = empty
+            uint32_t entry; // innermost definition, or none
+        };
+
+        struct Entry {
+            SymbolID key;
+            uint32_t shadowed; // the definition this one hides, or none
+            Value value;
+        };
+
+        struct Scope {
+            uint32_t firstEntry;
+            uint32_t visibleFrom; // the enclosing scope's visibleFrom
+        };
+
+        std::vector<Slot> slots; // power-of-two size
+        size_t usedSlots = 0;
+        std::deque<Entry> entries; // in definition order
+        std::vector<Scope> scopes;
+        uint32_t visibleFrom = 0; // entries before this are hidden
+
+        size_t slotIndex(SymbolID key) const {
+            size_t mask = slots.size() - 1;
+            size_t index = (key * 2654435769u) & mask;
+            while (slots[index].key != key && slots[index].key != noSymbol) {
+                index = (index + 1) & mask;
+            }
+            return index;
+        }
+
+        // Rebuild at a size that fits the live names; slots left behind by
+        // names no longer defined are dropped
+        void rehash() {
+            std::vector<Slot> old;
+            old.swap(slots);
+
+            size_t live = 0;
+            for (const Slot &slot: old) {
+                live += slot.entry != none;
+            }
+            size_t size = 16;
+            while (size < (live + 1) * 2) {
+                size *= 2;
+            }
+
+            slots.assign(size, Slot{noSymbol, none});
+            usedSlots = live;
+            for (const Slot &slot: old) {
+                if (slot.entry != none) {
+                    slots[slotIndex(slot.key)] = slot;
+                }
+            }
+        }
+
+    public:
+        void pushScope(bool isolated = false) {
+            uint32_t first = static_cast<uint32_t>(entries.size());
+            scopes.push_back(Scope{first, visibleFrom});
+            if (isolated) {
+                visibleFrom = first;
+            }
+        }
+
+        void popScope() {
+            if (scopes.empty()) return;
+
+            Scope scope = scopes.back();
+            scopes.pop_back();
+            while (entries.size() > scope.firstEntry) {
+                const Entry &entry = entries.back();
+                slots[slotIndex(entry.key)].entry = entry.shadowed;
+                entries.pop_back();
+            }
+            visibleFrom = scope.visibleFrom;
+        }
+
+        size_t depth() const { return scopes.size(); }
+
+        // Define key in the innermost scope, replacing a definition already
+        // made in that scope
+        void insert(SymbolID key, const Value &value) {
+            if ((usedSlots + 1) * 4 > slots.size() * 3) {
+                rehash();
+            }
+
+            Slot &slot = slots[slotIndex(key)];
+            if (slot.key == noSymbol) {
+                slot.key = key;
+                usedSlots++;
+            }
+
+            uint32_t scopeStart = scopes.empty() ? 0 : scopes.back().firstEntry;
+            if (slot.entry != none && slot.entry >= scopeStart) {
+                entries[slot.entry].value = value;
+                return;
+            }
+            entries.push_back(Entry{key, slot.entry, value});
+            slot.entry = static_cast<uint32_t>(entries.size() - 1);
+        }
+
+        void insert(std::string_view name, const Value &value) {
+            insert(StringInterner::instance().intern(name), value);
+        }
+
+        // The innermost visible definition, or null
+        Value *find(SymbolID key) {
+            if (slots.empty() || key == noSymbol) return nullptr;
+
+            const Slot &slot = slots[slotIndex(key)];
+            if (slot.key != key || slot.entry == none || slot.entry < visibleFrom) {
+                return nullptr;
+            }
+            return &entries[slot.entry].value;
+        }
+
+        Value *find(std::string_view name) {
+            return find(StringInterner::instance().find(name));
+        }
+
+        // Like find, but returns a default-constructed value if not found
+        template<typename Key>
+        Value lookup(const Key &key) {
+            Value *value = find(key);
+            return value ? *value : Value();
+        }
+
+        void clear() {
+            slots.clear();
+            usedSlots = 0;
+            entries.clear();
+            scopes.clear();
+            visibleFrom = 0;
+        }
+    };
+} // namespace flow
+
+#endif // FLOW_SCOPED_TABLE_H
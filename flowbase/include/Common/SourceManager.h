@@ -0,0 +1,98 @@
+#ifndef FLOW_SOURCE_MANAGER_H
+#define FLOW_SOURCE_MANAGER_H
+
+#include <llvm/Support/MemoryBuffer.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace flow {
+    // Compact handle for a source file path (0 = none). Stays the same when
+    // the file is reloaded, so tokens and locations only carry this number.
+    using FileID = uint32_t;
+
+    // The text of one source file: memory-mapped from disk (small files are
+    // read), or an owned copy for editor buffers. Immutable; the line table
+    // is built the first time a line is asked for.
+    class SourceFile {
+    private:
+        FileID id;
+        std::string path;
+        std::unique_ptr<llvm::MemoryBuffer> buffer;
+
+        mutable std::once_flag linesBuilt;
+        mutable std::vector<uint32_t> lineOffsets; // byte offset where each line starts
+
+        const std::vector<uint32_t> &lines() const;
+
+    public:
+        SourceFile(FileID id, const std::string &path, std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+        FileID getID() const { return id; }
+
+        const std::string &getPath() const { return path; }
+
+        std::string_view getText() const {
+            return std::string_view(buffer->getBufferStart(), buffer->getBufferSize());
+        }
+
+        size_t getLineCount() const;
+
+        // 1-based line, without its line ending ("" if out of range)
+        std::string_view getLine(size_t line) const;
+
+        // 1-based line and column to a byte offset, clamped to the end of the line
+        size_t getOffset(size_t line, size_t column) const;
+
+        // Byte offset to 1-based line and column
+        std::pair<int, int> getLineAndColumn(size_t offset) const;
+    };
+
+    // Loads every source file once and hands out views of its text, so the
+    // lexer, ModuleGraph, ErrorReporter and LSP share one copy instead of each
+    // reading or copying the file. A file that changes on disk (or an editor
+    // buffer that is replaced) gets a new SourceFile under the same FileID;
+    // anything still holding the old one keeps it alive. Thread-safe.
+    class SourceManager {
+    private:
+        std::mutex mutex;
+        std::map<std::string, FileID> ids;
+        std::deque<std::string> paths;                            // FileID - 1 -> path
+        std::vector<std::shared_ptr<const SourceFile> > current; // FileID - 1 -> newest text
+
+        FileID intern(const std::string &path);
+
+        std::shared_ptr<const SourceFile> add(const std::string &path, std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+    public:
+        static SourceManager &instance() {
+            static SourceManager manager;
+            return manager;
+        }
+
+        // Map a file from disk, replacing any earlier version of the path.
+        // Returns null (with the system's reason in error) if it can't be read.
+        std::shared_ptr<const SourceFile> loadFile(const std::string &path, std::string *error = nullptr);
+
+        // Register text that only exists in memory under a path (editor contents)
+        std::shared_ptr<const SourceFile> addBuffer(const std::string &path, std::string_view text);
+
+        // The newest version of a path, or null if it was never loaded
+        std::shared_ptr<const SourceFile> lookup(const std::string &path);
+
+        std::shared_ptr<const SourceFile> getFile(FileID id);
+
+        // The ID for a path, assigned on first use
+        FileID getFileID(const std::string &path);
+
+        // "" for 0 or an unknown ID
+        const std::string &getPath(FileID id);
+    };
+} // namespace flow
+
+#endif // FLOW_SOURCE_MANAGER_H
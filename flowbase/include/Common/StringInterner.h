@@ -0,0 +1,42 @@
+#ifndef FLOW_STRING_INTERNER_H
+#define FLOW_STRING_INTERNER_H
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace flow {
+    // Small dense number standing for an interned name
+    using SymbolID = uint32_t;
+
+    constexpr SymbolID noSymbol = ~0u;
+
+    // Gives every distinct name in the process one SymbolID, so symbol tables
+    // can hash and compare a number instead of a string. IDs are handed out
+    // in order from 0 and never reused. Thread-safe.
+    class StringInterner {
+    private:
+        mutable std::shared_mutex mutex;
+        std::deque<std::string> strings; // indexed by ID; never moves
+        std::unordered_map<std::string_view, SymbolID> ids; // views into strings
+
+    public:
+        static StringInterner &instance() {
+            static StringInterner interner;
+            return interner;
+        }
+
+        // The ID for name, assigned on first use
+        SymbolID intern(std::string_view name);
+
+        // The ID for name, or noSymbol if it was never interned
+        SymbolID find(std::string_view name) const;
+
+        const std::string &getString(SymbolID id) const;
+    };
+} // namespace flow
+
+#endif // FLOW_STRING_INTERNER_H
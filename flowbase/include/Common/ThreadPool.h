@@ -0,0 +1,65 @@
+#ifndef FLOW_THREAD_POOL_H
+#define FLOW_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace flow {
+    // Work-stealing thread pool. Each worker owns a deque: tasks submitted from a
+    // worker go to the back of its own deque (LIFO, cache-friendly), idle workers
+    // steal from the front of the others. Tasks submitted from outside the pool
+    // are spread round-robin.
+    class ThreadPool {
+    private:
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<std::function<void()> > tasks;
+        };
+
+        std::vector<std::unique_ptr<WorkQueue> > queues;
+        std::vector<std::thread> workers;
+
+        std::mutex stateMutex;
+        std::condition_variable workAvailable;
+        std::condition_variable allDone;
+        long queued;    // tasks sitting in a deque
+        size_t pending; // tasks queued or running
+        bool stopping;
+        std::exception_ptr firstError;
+
+        std::atomic<unsigned> nextQueue;
+
+        void workerLoop(unsigned index);
+
+        bool popTask(unsigned index, std::function<void()> &task);
+
+    public:
+        // threadCount == 0 uses one worker per hardware thread
+        explicit ThreadPool(unsigned threadCount = 0);
+
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        void submit(std::function<void()> task);
+
+        // Block until every submitted task (including ones they submit) has run.
+        // Rethrows the first exception a task threw. Must not be called from a worker.
+        void wait();
+
+        unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+        static unsigned hardwareThreads();
+    };
+} // namespace flow
+
+#endif // FLOW_THREAD_POOL_H
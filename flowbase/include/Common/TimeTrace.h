@@ -0,0 +1,29 @@
+#ifndef FLOW_TIME_TRACE_H
+#define FLOW_TIME_TRACE_H
+
+#include <string>
+
+namespace flow {
+    // --time-trace support on top of LLVM's time profiler. Code marks spans with
+    // llvm::TimeTraceScope (a no-op unless tracing); this class owns the
+    // per-process setup, per-thread registration and writing the Chrome trace.
+    class TimeTrace {
+    public:
+        // Start tracing on the calling thread. Spans shorter than granularity
+        // (microseconds) are dropped.
+        static void start(const std::string &processName, unsigned granularity);
+
+        static bool active();
+
+        // Worker threads call these around their lifetime so their spans appear
+        // as separate rows in the trace
+        static void startThread();
+
+        static void finishThread();
+
+        // Write the trace (every thread that has finished) and stop tracing
+        static bool finish(const std::string &path);
+    };
+} // namespace flow
+
+#endif // FLOW_TIME_TRACE_H
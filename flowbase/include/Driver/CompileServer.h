@@ -0,0 +1,34 @@
+#ifndef FLOW_COMPILE_SERVER_H
+#define FLOW_COMPILE_SERVER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace flow {
+    // Compiler daemon (`flowbase --server`). A long-lived process keeps LLVM's
+    // targets initialized, target machines pooled and every parsed module in
+    // the ModuleGraph, so repeated builds skip the cold-start work. Clients
+    // (`flowbase --client ...`) send their arguments, working directory and
+    // stdio descriptors over a Unix domain socket. The server runs the compile
+    // with the client's stdio and replies with the exit status.
+    class CompileServer {
+    public:
+        // Compiles one request's arguments (as after the program name) and
+        // returns the exit status
+        using Handler = std::function<int(const std::vector<std::string> &)>;
+
+        // $FLOW_SERVER_SOCKET, else $XDG_RUNTIME_DIR/flowbase.sock, else
+        // /tmp/flowbase-<uid>.sock
+        static std::string defaultSocketPath();
+
+        // Serve requests one at a time until SIGINT/SIGTERM. Returns the exit status.
+        static int serve(const std::string &socketPath, const Handler &handler, bool verbose);
+
+        // Send a compile to a running server. Returns false if no server
+        // answered, so the caller can compile locally.
+        static bool forward(const std::string &socketPath, const std::vector<std::string> &args, int &exitCode);
+    };
+} // namespace flow
+
+#endif // FLOW_COMPILE_SERVER_H
@@ -12,9 +12,23 @@ namespace flow {
         bool emitAST;
         bool optimize;
         int optimizationLevel;
+        int sizeLevel; // 0 = none, 1 = -Os, 2 = -Oz
+        std::string targetCPU;      // empty = generic, "native" = host CPU
+        std::string targetFeatures; // e.g. "+avx2,+fma"
         bool verbose;
         bool objectOnly;
         bool multiFile;
+        unsigned jobs; // parallel module compiles, or function bodies of one file (0 = one per hardware thread)
+        unsigned codegenThreads; // backend threads for a large module's partitions (0 = all cores)
+        int ltoMode;   // multi-file builds: 0 = off, 1 = ThinLTO, 2 = full LTO
+        bool stringRegions; // --string-memory: free strings and arrays when the function or loop iteration that built them ends
+        bool run;      // `flowbase run`: JIT and execute instead of writing an executable
+        std::vector<std::string> runArgs; // arguments passed to the program's main
+        std::string profileGenerateFile;  // --profile-generate: instrument; the program writes this .profraw
+        std::string profileUseFile;       // --profile-use: optimize with this merged .profdata
+        bool timeTrace;                   // write a Chrome trace of compile phases
+        std::string timeTraceFile;        // empty = <output>.time-trace.json
+        unsigned timeTraceGranularity;    // drop spans shorter than this (microseconds)
         std::vector<std::string> libraryPaths;
         std::vector<std::string> objectFiles;
 
@@ -25,9 +39,17 @@ namespace flow {
               emitAST(false),
               optimize(false),
               optimizationLevel(0),
+              sizeLevel(0),
               verbose(false),
               objectOnly(false),
-              multiFile(true) {
+              multiFile(true),
+              jobs(1),
+              codegenThreads(1),
+              ltoMode(0),
+              stringRegions(true),
+              run(false),
+              timeTrace(false),
+              timeTraceGranularity(500) {
         }
     };
 
@@ -38,8 +60,6 @@ namespace flow {
 
         void reportError(const std::string &message);
 
-        std::string readFile(const std::string &filename);
-
     public:
         Driver(const CompilerOptions &opts) : options(opts) {
         }
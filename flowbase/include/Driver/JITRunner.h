@@ -0,0 +1,59 @@
+#ifndef FLOW_JIT_RUNNER_H
+#define FLOW_JIT_RUNNER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+    namespace orc {
+        class LLJIT;
+    }
+}
+
+namespace flow {
+    class CodeGenerator;
+
+    // Runs Flow programs in-process with ORC LLJIT (`flowbase run`), skipping
+    // object emission and linking. Stdlib builtins resolve to the copies linked
+    // into the compiler, C functions and `link` libraries to the host process.
+    class JITRunner {
+    private:
+        std::unique_ptr<llvm::orc::LLJIT> jit;
+        std::vector<std::string> libraryPaths;
+        std::string error;
+
+        // Signature of the program's main, recorded when its module is added
+        bool hasMain;
+        unsigned mainParams;
+        bool mainReturnsInt;
+
+        bool initialize();
+
+        void defineBuiltins();
+
+    public:
+        JITRunner();
+
+        ~JITRunner();
+
+        JITRunner(const JITRunner &) = delete;
+
+        JITRunner &operator=(const JITRunner &) = delete;
+
+        void addLibraryPath(const std::string &path);
+
+        // Make a `link "name"` library's symbols visible to JIT'd code
+        bool addLibrary(const std::string &name);
+
+        // Takes ownership of the generator's module and context
+        bool addModule(CodeGenerator &codegen);
+
+        // Call main, as `main()` or `main(argc, argv)`; returns its exit code
+        int runMain(const std::string &programName, const std::vector<std::string> &args);
+
+        const std::string &getError() const { return error; }
+    };
+} // namespace flow
+
+#endif // FLOW_JIT_RUNNER_H
@@ -0,0 +1,51 @@
+#ifndef FLOW_LTO_BACKEND_H
+#define FLOW_LTO_BACKEND_H
+
+#include <string>
+#include <vector>
+
+namespace flow {
+    class Linker;
+
+    // Link-time optimization for multi-file builds (--lto=thin|full). Takes the
+    // bitcode each module was compiled to, runs LLVM's (Thin)LTO with
+    // cross-module inlining and dead-symbol stripping, and hands the resulting
+    // native objects to the linker. ThinLTO backends are cached, so unchanged
+    // modules skip codegen on the next build.
+    class LTOBackend {
+    private:
+        int mode; // 1 = ThinLTO, 2 = full LTO
+        std::string targetCPU;
+        std::string targetFeatures;
+        int optimizationLevel;
+        unsigned jobs;
+        std::string cacheDirectory;
+        bool exportAllSymbols;
+        std::vector<std::string> bitcodeFiles;
+
+    public:
+        explicit LTOBackend(int mode);
+
+        void setTarget(const std::string &cpu, const std::string &features) {
+            targetCPU = cpu;
+            targetFeatures = features;
+        }
+
+        void setOptimizationLevel(int level) { optimizationLevel = level; }
+
+        // Parallel ThinLTO backends (0 = one per hardware thread)
+        void setJobs(unsigned count) { jobs = count; }
+
+        void setCacheDirectory(const std::string &path) { cacheDirectory = path; }
+
+        // Keep every definition even if no LTO'd code uses it, e.g. when native
+        // objects that may call into them are linked too
+        void setExportAllSymbols(bool enabled) { exportAllSymbols = enabled; }
+
+        void addBitcodeFile(const std::string &path);
+
+        bool run(Linker &linker);
+    };
+} // namespace flow
+
+#endif // FLOW_LTO_BACKEND_H
@@ -0,0 +1,71 @@
+#ifndef FLOW_LINKER_H
+#define FLOW_LINKER_H
+
+#include <llvm/ADT/StringRef.h>
+#include <string>
+#include <vector>
+
+namespace flow {
+    // Links object files into an executable. On ELF hosts built with LLD
+    // (FLOW_HAS_LLD) the link runs in-process; otherwise, or if LLD can't be
+    // used, it falls back to the system compiler driver (g++/clang++).
+    class Linker {
+    private:
+        std::string outputFile;
+        std::vector<std::string> inputs;      // object paths, in link order
+        std::vector<std::string> libraries;   // -l names
+        std::vector<std::string> libraryPaths;
+        std::vector<std::string> runtimeArchives; // linked after everything else
+        std::vector<std::string> undefinedSymbols; // -u: force archive members in
+        std::vector<std::string> tempFiles;   // only when in-memory files are unavailable
+        std::vector<int> memoryFiles;         // memfd descriptors backing in-memory objects
+        bool verbose;
+
+        double linkMilliseconds;
+        std::string linkerUsed;
+
+        bool linkWithLLD(std::string &diagnostics);
+
+        bool linkWithDriver();
+
+    public:
+        explicit Linker(const std::string &outputFile);
+
+        ~Linker();
+
+        Linker(const Linker &) = delete;
+
+        Linker &operator=(const Linker &) = delete;
+
+        void addObjectFile(const std::string &path);
+
+        // Link an object that only exists in memory. On Linux it's handed to the
+        // linker through a memfd, so nothing is written to disk.
+        bool addObjectBuffer(const std::string &name, llvm::StringRef data);
+
+        // "foo" or "libfoo" -> -lfoo
+        void addLibrary(const std::string &name);
+
+        void addLibraryPath(const std::string &path);
+
+        // Link Flow's runtime library (libflowrt: strings and the stdlib),
+        // found at $FLOW_RUNTIME or where CMake built it
+        bool addFlowRuntime();
+
+        // Link LLVM's profile runtime (compiler-rt's libclang_rt.profile) for
+        // --profile-generate builds. Found at $FLOW_PROFILE_RUNTIME or where
+        // CMake saw it next to LLVM.
+        bool addProfileRuntime();
+
+        void setVerbose(bool enabled) { verbose = enabled; }
+
+        bool link();
+
+        double getLinkMilliseconds() const { return linkMilliseconds; }
+
+        // "lld" or the external driver that produced the output
+        const std::string &getLinkerUsed() const { return linkerUsed; }
+    };
+} // namespace flow
+
+#endif // FLOW_LINKER_H
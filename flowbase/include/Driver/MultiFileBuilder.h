@@ -1,18 +1,32 @@
 #ifndef FLOW_MULTIFILE_BUILDER_H
 #define FLOW_MULTIFILE_BUILDER_H
 
+#include "Driver.h"
 #include <string>
 #include <vector>
 #include <set>
 #include <map>
+#include <cstdint>
+#include <memory>
 
 namespace flow {
+    class CodeGenerator;
+
     struct ModuleInfo {
         std::string sourcePath;
         std::string objectPath;
+        std::vector<std::string> partPaths; // objects after objectPath when codegen split the module
         size_t sourceSize;
         size_t objectSize;
         bool compiled;
+        std::vector<std::string> imports; // resolved paths of imported modules
+        std::string log;                  // diagnostics captured while compiling
+
+        // Incremental build cache
+        uint64_t sourceHash;    // hash of the source text
+        uint64_t interfaceHash; // hash of the declarations importers can see
+        uint64_t cacheKey;      // source + transitive import interfaces + flags
+        bool upToDate;          // cached object matches cacheKey
     };
 
     class MultiFileBuilder {
@@ -21,18 +35,46 @@ namespace flow {
         std::string outputFile;
         std::string buildDir;
         bool verbose;
+        CompilerOptions options;
 
         std::map<std::string, ModuleInfo> modules;
         std::set<std::string> processedModules;
 
+        // Build manifest (.flow_build/manifest): cache keys of the last successful
+        // compile of each module and of each linked output
+        std::map<std::string, uint64_t> manifestModules;
+        std::map<std::string, uint64_t> manifestOutputs;
+
+        void loadManifest();
+
+        void saveManifest();
+
+        void computeCacheKeys();
+
+        uint64_t transitiveInterfaceHash(const std::string &modulePath, std::map<std::string, uint64_t> &memo,
+                                         std::set<std::string> &visiting);
+
+        // Compiler version, executable and flags that affect generated code
+        std::string compilerFingerprint() const;
+
+        uint64_t linkKey() const;
+
         void discoverImports(const std::string &filePath);
 
         std::string resolveImportPath(const std::string &importPath, const std::string &currentDir);
 
+        // Sema + IR generation for one module; null (with diagnostics) on failure
+        std::unique_ptr<CodeGenerator> generateModule(const std::string &modulePath, const std::string &moduleName);
+
         bool compileModule(const std::string &modulePath);
 
+        // Compile every module on a thread pool, imports before importers
+        bool compileAllModules();
+
         bool linkModules();
 
+        bool outputUpToDate() const;
+
         void printBuildHeader();
 
         void printModuleProgress(int current, int total, const std::string &moduleName);
@@ -42,10 +84,13 @@ namespace flow {
         void printBuildSummary();
 
     public:
-        MultiFileBuilder(const std::string &mainFile, const std::string &outputFile, bool verbose = false);
+        explicit MultiFileBuilder(const CompilerOptions &options);
 
         bool build();
 
+        // JIT every module and call main (`flowbase run`); returns main's exit code
+        int run();
+
         const std::map<std::string, ModuleInfo> &getModules() const { return modules; }
     };
 } // namespace flow
@@ -63,6 +63,15 @@ void flow_runtime_free(FlowRuntime *runtime);
  */
 const char *flow_runtime_get_error(FlowRuntime *runtime);
 
+/**
+ * Set the CPU and features used when JIT-compiling modules
+ * @param runtime The runtime
+ * @param cpu CPU name, or "native" for the host CPU (the default)
+ * @param features Feature string like "+avx2,-avx512f" (may be NULL)
+ * @return FLOW_OK on success
+ */
+FlowResult flow_runtime_set_target(FlowRuntime *runtime, const char *cpu, const char *features);
+
 // ============================================================
 // MODULE MANAGEMENT
 // ============================================================
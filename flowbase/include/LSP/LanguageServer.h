@@ -8,6 +8,7 @@
 #include <functional>
 #include "../Parser/Parser.h"
 #include "../Sema/SemanticAnalyzer.h"
+#include "../Common/SourceManager.h"
 
 namespace flow {
     namespace lsp {
@@ -114,6 +115,7 @@ namespace flow {
         struct DocumentState {
             std::string uri;
             std::string text;
+            std::shared_ptr<const SourceFile> source; // text as of the last analysis
             int version;
             std::shared_ptr<Program> ast;
             std::vector<Diagnostic> diagnostics;
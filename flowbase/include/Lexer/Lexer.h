@@ -3,17 +3,18 @@
 
 #include "Token.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 
 namespace flow {
     class Lexer {
     private:
-        std::string source;
-        std::string filename;
+        const SourceFile &file;
+        std::string_view source;
+        size_t start;   // offset where the current token begins
         size_t current;
-        int line;
-        int column;
+        std::string error; // why the last INVALID token was produced
 
         char peek() const;
 
@@ -31,8 +32,6 @@ namespace flow {
 
         void skipBlockComment();
 
-        Token makeToken(TokenType type, const std::string &lexeme);
-
         Token makeToken(TokenType type);
 
         Token errorToken(const std::string &message);
@@ -43,15 +42,24 @@ namespace flow {
 
         Token scanIdentifier();
 
-        TokenType identifierType(const std::string &text);
+        TokenType identifierType(std::string_view text);
 
     public:
-        Lexer(const std::string &src, const std::string &fname = "<input>");
+        // Tokens point into the file's text, so keep the file alive while they're used
+        explicit Lexer(const SourceFile &file);
 
 
         Token nextToken();
 
+        // Lex the whole file up front (tools); the parser pulls nextToken() instead
         std::vector<Token> tokenize();
+
+        const SourceFile &getFile() const { return file; }
+
+        const std::string &getError() const { return error; }
+
+        // Contents of a STRING_LITERAL token (quotes included) with escapes resolved
+        static std::string unescapeString(std::string_view quoted);
     };
 } // namespace flow
 
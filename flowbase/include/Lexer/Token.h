@@ -1,11 +1,14 @@
 #ifndef FLOW_TOKEN_H
 #define FLOW_TOKEN_H
 
+#include "../Common/SourceManager.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <ostream>
 
 namespace flow {
-    enum class TokenType {
+    enum class TokenType : uint8_t {
         // Keywords
         KW_LET,
         KW_MUT,
@@ -96,39 +99,53 @@ namespace flow {
     };
 
     struct SourceLocation {
-        std::string filename;
+        FileID file;
         int line;
         int column;
 
-        SourceLocation() : filename(""), line(0), column(0) {
+        SourceLocation() : file(0), line(0), column(0) {
         }
 
-        SourceLocation(const std::string &file, int l, int c)
-            : filename(file), line(l), column(c) {
+        SourceLocation(FileID f, int l, int c)
+            : file(f), line(l), column(c) {
         }
+
+        // Path of the file, via the SourceManager ("" if unknown)
+        const std::string &getFilename() const;
     };
 
+    // 16 bytes and trivially copyable: the lexeme is the [offset, offset +
+    // length) slice of the file's text and the line and column are looked up
+    // only when a location is needed. String literal tokens span the quotes
+    // and still contain their escape sequences.
     class Token {
     public:
         TokenType type;
-        std::string lexeme;
-        SourceLocation location;
+        FileID file;
+        uint32_t offset;
+        uint32_t length;
 
-        Token() : type(TokenType::INVALID), lexeme(""), location() {
+        Token() : type(TokenType::INVALID), file(0), offset(0), length(0) {
         }
 
-        Token(TokenType t, const std::string &lex, const SourceLocation &loc)
-            : type(t), lexeme(lex), location(loc) {
+        Token(TokenType t, FileID f, uint32_t off, uint32_t len)
+            : type(t), file(f), offset(off), length(len) {
         }
 
         bool is(TokenType t) const { return type == t; }
         bool isNot(TokenType t) const { return type != t; }
 
+        std::string_view getText(std::string_view source) const { return source.substr(offset, length); }
+
+        // Looks the text and location up through the SourceManager; for
+        // debugging output, not the hot path
         std::string toString() const;
 
         static std::string tokenTypeToString(TokenType type);
     };
 
+    static_assert(sizeof(Token) == 16, "Token should stay 16 bytes");
+
     std::ostream &operator<<(std::ostream &os, const Token &token);
 } // namespace flow
 
@@ -25,102 +25,137 @@ namespace flow {
         }
     };
 
+    // The lexer produced an INVALID token; the parse stops there
+    class LexError : public std::runtime_error {
+    public:
+        SourceLocation location;
+
+        LexError(const std::string &msg, const SourceLocation &loc)
+            : std::runtime_error(msg), location(loc) {
+        }
+    };
+
     class Parser {
     private:
-        std::vector<Token> tokens;
-        size_t current;
+        // Tokens are pulled from the lexer on demand into a small ring buffer.
+        // The parser looks at most one token ahead and backtracks at most one,
+        // so the window only has to cover current - 1 .. current.
+        static constexpr size_t tokenWindow = 8;
+
+        Lexer &lexer;
+        const SourceFile &file; // the tokens' text and line table
+        std::string_view source;
+        Token window[tokenWindow];
+        size_t pulled;  // tokens taken from the lexer so far
+        size_t current; // index of the next token
+        ASTArena *arena; // the Program being parsed owns every node
+        TypeContext &types;
         
         // Error collector for LSP (optional)
         lsp::LSPErrorCollector* errorCollector;
 
-        Token peek() const;
+        // Take the next token from the lexer into the window; reports and
+        // throws LexError on an INVALID token
+        void pullToken();
+
+        // Tokens are returned by value: the window slot they came from is
+        // reused as parsing moves on
+        Token peek();
 
         Token previous() const;
 
-        bool isAtEnd() const;
+        bool isAtEnd();
 
         Token advance();
 
-        bool check(TokenType type) const;
+        bool check(TokenType type);
 
         bool match(TokenType type);
 
         Token consume(TokenType type, const std::string &message);
 
+        // Text of a token as the AST stores it (string literals unescaped)
+        std::string lexeme(const Token &token) const;
+
+        SourceLocation location(const Token &token) const;
+
         ParseError error(const Token &token, const std::string &message);
 
         void synchronize();
 
         std::shared_ptr<Program> parseProgram();
 
-        std::shared_ptr<Decl> parseDeclaration();
+        Decl *parseDeclaration();
 
-        std::shared_ptr<FunctionDecl> parseFunctionDecl();
+        FunctionDecl *parseFunctionDecl();
 
-        std::shared_ptr<StructDecl> parseStructDecl();
+        StructDecl *parseStructDecl();
 
-        std::shared_ptr<ImplDecl> parseImplDecl();
+        ImplDecl *parseImplDecl();
 
-        std::shared_ptr<TypeDefDecl> parseTypeDefDecl();
+        TypeDefDecl *parseTypeDefDecl();
 
-        std::shared_ptr<LinkDecl> parseLinkDecl();
+        LinkDecl *parseLinkDecl();
 
-        std::shared_ptr<ImportDecl> parseImportDecl();
+        ImportDecl *parseImportDecl();
 
-        std::shared_ptr<ModuleDecl> parseModuleDecl();
+        ModuleDecl *parseModuleDecl();
 
-        std::shared_ptr<Stmt> parseStatement();
+        Stmt *parseStatement();
 
-        std::shared_ptr<VarDeclStmt> parseVarDecl();
+        VarDeclStmt *parseVarDecl();
 
-        std::shared_ptr<ReturnStmt> parseReturnStmt();
+        ReturnStmt *parseReturnStmt();
 
-        std::shared_ptr<IfStmt> parseIfStmt();
+        IfStmt *parseIfStmt();
 
-        std::shared_ptr<ForStmt> parseForStmt();
+        ForStmt *parseForStmt();
 
-        std::shared_ptr<WhileStmt> parseWhileStmt();
+        WhileStmt *parseWhileStmt();
 
-        std::shared_ptr<BlockStmt> parseBlockStmt();
+        BlockStmt *parseBlockStmt();
 
-        std::shared_ptr<Stmt> parseExprStmt();
+        Stmt *parseExprStmt();
 
-        std::shared_ptr<Expr> parseExpression();
+        Expr *parseExpression();
 
-        std::shared_ptr<Expr> parseAssignment();
+        Expr *parseAssignment();
 
-        std::shared_ptr<Expr> parseLogicalOr();
+        Expr *parseLogicalOr();
 
-        std::shared_ptr<Expr> parseLogicalAnd();
+        Expr *parseLogicalAnd();
 
-        std::shared_ptr<Expr> parseBitwiseOr();
+        Expr *parseBitwiseOr();
 
-        std::shared_ptr<Expr> parseBitwiseXor();
+        Expr *parseBitwiseXor();
 
-        std::shared_ptr<Expr> parseBitwiseAnd();
+        Expr *parseBitwiseAnd();
 
-        std::shared_ptr<Expr> parseEquality();
+        Expr *parseEquality();
 
-        std::shared_ptr<Expr> parseComparison();
+        Expr *parseComparison();
 
-        std::shared_ptr<Expr> parseBitwiseShift();
+        Expr *parseBitwiseShift();
 
-        std::shared_ptr<Expr> parseTerm();
+        Expr *parseTerm();
 
-        std::shared_ptr<Expr> parseFactor();
+        Expr *parseFactor();
 
-        std::shared_ptr<Expr> parseUnary();
+        Expr *parseUnary();
 
-        std::shared_ptr<Expr> parseCall();
+        Expr *parseCall();
 
-        std::shared_ptr<Expr> parsePrimary();
+        Expr *parsePrimary();
 
-        std::shared_ptr<Type> parseType();
+        const Type *parseType();
 
         Parameter parseParameter();
 
     public:
-        Parser(const std::vector<Token> &toks) : tokens(toks), current(0), errorCollector(nullptr) {
+        // Parses the lexer's file, pulling tokens as it goes
+        explicit Parser(Lexer &lexer)
+            : lexer(lexer), file(lexer.getFile()), source(file.getText()), pulled(0), current(0),
+              arena(nullptr), types(TypeContext::instance()), errorCollector(nullptr) {
         }
         
         void setErrorCollector(lsp::LSPErrorCollector* collector) {
@@ -128,6 +163,9 @@ namespace flow {
         }
 
         std::shared_ptr<Program> parse();
+
+        // Number of tokens the lexer has produced so far
+        size_t getTokenCount() const { return pulled; }
     };
 } // namespace flow
 
@@ -2,8 +2,10 @@
 #define FLOW_SEMANTIC_ANALYZER_H
 
 #include "../AST/AST.h"
+#include "../Common/ScopedTable.h"
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 #include <stdexcept>
@@ -29,21 +31,21 @@ namespace flow {
     class SymbolTable {
     public:
         struct Symbol {
-            std::string name;
-            std::shared_ptr<Type> type;
+            SymbolID name;
+            const Type *type;
             bool isMutable;
             bool isFunction;
 
-            Symbol() : name(""), type(nullptr), isMutable(false), isFunction(false) {
+            Symbol() : name(noSymbol), type(nullptr), isMutable(false), isFunction(false) {
             }
 
-            Symbol(const std::string &n, std::shared_ptr<Type> t, bool mut = false, bool func = false)
+            Symbol(SymbolID n, const Type *t, bool mut = false, bool func = false)
                 : name(n), type(t), isMutable(mut), isFunction(func) {
             }
         };
 
     private:
-        std::vector<std::map<std::string, Symbol> > scopes;
+        ScopedTable<Symbol> scopes;
 
     public:
         SymbolTable() { enterScope(); }
@@ -52,7 +54,7 @@ namespace flow {
 
         void exitScope();
 
-        void define(const std::string &name, std::shared_ptr<Type> type, bool isMutable = false,
+        void define(const std::string &name, const Type *type, bool isMutable = false,
                     bool isFunction = false);
 
         Symbol *lookup(const std::string &name);
@@ -65,17 +67,29 @@ namespace flow {
     class SemanticAnalyzer : public ASTVisitor {
     private:
         SymbolTable symbolTable;
-        std::shared_ptr<Type> currentFunctionReturnType;
+        const Type *currentFunctionReturnType;
         std::vector<std::string> errors;
 
-        // Struct field tracking: structName -> (fieldName -> fieldType)
-        std::map<std::string, std::map<std::string, std::shared_ptr<Type> > > structFields;
+        // A declared struct. Its type is resolved once at the declaration,
+        // so checking bodies doesn't go back to the shared TypeContext.
+        struct StructInfo {
+            const Type *type;
+            std::map<std::string, const Type *> fields; // fieldName -> fieldType
+        };
+
+        // structName -> struct
+        std::map<std::string, StructInfo> structs;
 
         // Type aliases: aliasName -> actualType
-        std::map<std::string, std::shared_ptr<Type> > typeAliases;
+        std::map<std::string, const Type *> typeAliases;
+
+        // Types already run through resolveTypeAlias; cleared when an alias is added
+        std::unordered_map<const Type *, const Type *> resolvedAliases;
+
+        TypeContext &types;
 
-        // Current struct context for methods (used for 'this')
-        std::string currentStructContext;
+        // Type of 'this' in the method being checked, or null outside one
+        const Type *currentStructType;
 
         // Module tracking: modulePath -> parsed Program
         std::map<std::string, std::shared_ptr<Program> > loadedModules;
@@ -89,22 +103,53 @@ namespace flow {
         // Error collector for LSP (optional)
         lsp::LSPErrorCollector* errorCollector;
 
+        // Print import progress
+        bool verbose;
+
+        // Threads for checking function bodies (0 = one per hardware thread)
+        unsigned jobs;
+
+        // Set on the copies that check bodies in parallel: diagnostics are
+        // kept here and reported by the original analyzer in source order
+        std::vector<std::pair<std::string, SourceLocation> > *pendingErrors;
+
         void reportError(const std::string &message, const SourceLocation &loc);
 
-        bool typesMatch(std::shared_ptr<Type> t1, std::shared_ptr<Type> t2);
+        // A function or method signature, checked before any body
+        void declareFunction(FunctionDecl &node);
+
+        bool declareMethod(ImplDecl &node);
 
-        std::shared_ptr<Type> resolveTypeAlias(std::shared_ptr<Type> type);
+        void checkBody(FunctionDecl &node);
+
+        void checkBody(ImplDecl &node);
+
+        // Check function and method bodies, split across threads when there
+        // are enough of them
+        void checkBodies(const std::vector<Decl *> &bodies);
+
+        bool typesMatch(const Type *t1, const Type *t2);
+
+        // Arguments of len(array) and push(array, value)
+        void checkArrayBuiltin(const std::string &name, CallExpr &node);
+
+        const Type *resolveTypeAlias(const Type *type);
 
         // Module loading helpers
         std::shared_ptr<Program> loadModule(const std::string &modulePath);
 
         std::string resolveModulePath(const std::string &importPath);
 
+        // Declare an imported module's signatures without re-checking its bodies
+        void declareModuleInterface(Program &module);
+
         void importSymbolsFrom(std::shared_ptr<Program> module, const std::vector<std::string> &symbols,
                                const std::string &alias);
 
     public:
-        SemanticAnalyzer() : currentFunctionReturnType(nullptr), currentDirectory("."), errorCollector(nullptr) {
+        SemanticAnalyzer() : currentFunctionReturnType(nullptr), types(TypeContext::instance()),
+                             currentStructType(nullptr), currentDirectory("."),
+                             errorCollector(nullptr), verbose(false), jobs(1), pendingErrors(nullptr) {
         }
 
         void analyze(std::shared_ptr<Program> program);
@@ -117,6 +162,10 @@ namespace flow {
         
         void setErrorCollector(lsp::LSPErrorCollector* collector);
 
+        void setVerbose(bool enabled) { verbose = enabled; }
+
+        void setJobs(unsigned count) { jobs = count; }
+
         const std::vector<std::string> &getErrors() const { return errors; }
         bool hasErrors() const { return !errors.empty(); }
 
@@ -5,12 +5,7 @@
 
 namespace flow {
     namespace stdlib {
-        // Note: These allocate memory using 'new' - caller must free!
-        int strlen_impl(const char *str);
-
-        const char *substr_impl(const char *str, int start, int len);
-
-        const char *concat_impl(const char *a, const char *b);
+        // String operations live in the string runtime (FlowString.h)
 
         int abs_impl(int x);
 
@@ -22,7 +17,8 @@ namespace flow {
 
         int max_impl(int a, int b);
 
-        // Note: readLine and readFile allocate memory - caller must free!
+        // readLine and readFile return strings in the current string region
+        // (FlowString.h), released with it
         const char *readLine_impl();
 
         int readInt_impl();
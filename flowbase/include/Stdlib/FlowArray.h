@@ -0,0 +1,41 @@
+#ifndef FLOW_ARRAY_H
+#define FLOW_ARRAY_H
+
+#include <cstdint>
+
+namespace flow {
+    // A Flow array as compiled code sees it: a pointer to this header, the
+    // LLVM struct { ptr, i64, i64, i64 }. Arrays are passed by reference, so
+    // a callee that pushes onto an array grows the caller's array too. The
+    // header and elements live in a string region (Stdlib/FlowString.h) and
+    // are freed with it; the header doesn't record the element size, as each
+    // push or index knows it from the array's static type.
+    struct FlowArray {
+        void *data;
+        int64_t length;
+        int64_t capacity; // elements data has room for
+        int64_t region;   // where the header, elements and their strings live
+    };
+
+    // The array runtime (flowrt), linked into every Flow executable and
+    // registered with the JIT. Compiled code reads length and indexes data
+    // itself, and only calls in to create, grow or keep an array.
+    extern "C" {
+        // A new array of length zeroed elements of elementSize bytes each, in
+        // the current region
+        FlowArray *flow_array_new(int64_t elementSize, int64_t length);
+
+        // Make room for at least one more element, doubling the capacity so
+        // pushing n elements copies O(n) bytes in total. len() and indices
+        // are ints, so growing past INT32_MAX elements is a runtime error.
+        void flow_array_grow(FlowArray *array, int64_t elementSize);
+
+        // An array that must outlive the regions from mark up (a return
+        // value, or an element of an array in a lower region): copied into
+        // the region below mark if it lives in one of them, else returned as
+        // is. Compiled code then keeps the copy's elements the same way.
+        FlowArray *flow_array_keep(FlowArray *array, int64_t elementSize, int64_t mark);
+    }
+} // namespace flow
+
+#endif // FLOW_ARRAY_H
@@ -0,0 +1,95 @@
+#ifndef FLOW_STRING_H
+#define FLOW_STRING_H
+
+#include <cstdint>
+
+namespace flow {
+    // A Flow string as compiled code sees it: the LLVM struct { ptr, i64 }.
+    // data[length] is always readable, since every string is a literal, a
+    // NUL-terminated allocation or a slice of one, so a string that ends
+    // where its buffer does is already a C string. A zero-initialized string
+    // (null data, length 0) is empty.
+    struct FlowString {
+        const char *data;
+        int64_t length;
+    };
+
+    // Buffer sizes for flow_format_int ("-2147483648") and flow_format_float
+    // (17 significant digits, sign, point, exponent and a NUL, with room)
+    constexpr int flowIntBufferSize = 16;
+    constexpr int flowFloatBufferSize = 32;
+
+    // The string runtime (flowrt), linked into every Flow executable and
+    // registered with the JIT. The names are unmangled so generated code can
+    // call them directly. Strings come in as (data, length) pairs and go out
+    // as FlowString by value, which the SysV and AArch64 ABIs return in two
+    // registers, the same as the { ptr, i64 } the code generator expects.
+    extern "C" {
+        // Wrap a C string, measuring it once (null gives "")
+        FlowString flow_string_from_cstr(const char *str);
+
+        // data if the string is already NUL-terminated, else a terminated copy
+        const char *flow_string_to_cstr(const char *data, int64_t length);
+
+        // A buffer of size bytes from malloc, calloc or realloc as a string:
+        // its first length bytes (at most size - 1) with a NUL written after
+        // them, so C functions are handed the buffer itself. Null or size 0
+        // gives "".
+        FlowString flow_string_from_buffer(char *buffer, int64_t size, int64_t length);
+
+        // substr(s, start, count) as a slice sharing s's bytes. A count that
+        // is <= 0 or runs past the end takes the rest; a start outside the
+        // string gives "".
+        FlowString flow_string_substr(const char *data, int64_t length, int32_t start, int32_t count);
+
+        FlowString flow_string_concat(const char *left, int64_t leftLength,
+                                      const char *right, int64_t rightLength);
+
+        // Join count pieces into one allocation; a chain of `+` lowers to this
+        FlowString flow_string_concat_n(const FlowString *pieces, int64_t count);
+
+        // Write value's decimal digits and a NUL to buffer, which must hold
+        // flowIntBufferSize bytes; returns the length. Codegen points these
+        // at stack buffers, so a number in a concatenation isn't allocated.
+        int64_t flow_format_int(int32_t value, char *buffer);
+
+        // The shortest decimal that reads back as value, with ".0" added to
+        // whole numbers; buffer must hold flowFloatBufferSize bytes
+        int64_t flow_format_float(double value, char *buffer);
+
+        // 1 if both strings hold the same bytes, else 0
+        int32_t flow_string_equals(const char *left, int64_t leftLength,
+                                   const char *right, int64_t rightLength);
+
+        // A buffer for length bytes plus the NUL (already written) in the
+        // current region; every string the runtime builds comes from here
+        char *flow_string_alloc(int64_t length);
+
+        // String regions. Each thread has a stack of bump-allocated regions,
+        // and the bottom one is never released. Compiled code enters a region
+        // when a function (or a loop iteration) that builds strings or arrays
+        // starts and leaves it when that scope ends, freeing what was built
+        // inside at once. enter returns the new region's mark; leave releases
+        // it and any region entered after it.
+        int64_t flow_region_enter();
+
+        void flow_region_leave(int64_t mark);
+
+        // A string that must outlive the regions from mark up (a return
+        // value): copied into the region below mark if it lives in one of
+        // them, else returned as is
+        FlowString flow_region_keep(const char *data, int64_t length, int64_t mark);
+
+        // Region memory for the array runtime (Stdlib/FlowArray.h): the
+        // index of the newest region, bytes aligned for any element type in
+        // region, and such a block resized (copied when it can't grow in
+        // place, leaving the old block to be freed with its region)
+        int64_t flow_region_current();
+
+        void *flow_region_alloc(int64_t region, int64_t bytes);
+
+        void *flow_region_realloc(int64_t region, void *memory, int64_t bytes, int64_t newBytes);
+    }
+} // namespace flow
+
+#endif // FLOW_STRING_H
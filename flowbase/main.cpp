@@ -1,10 +1,16 @@
 #include "include/Driver/Driver.h"
+#include "include/Driver/CompileServer.h"
+#include "include/Common/TimeTrace.h"
 #include <iostream>
-#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
 
 void printUsage(const char *programName) {
     std::cout << "Flow Compiler v0.1.0\n"
             << "Usage: " << programName << " [options] <input-file>\n"
+            << "       " << programName << " run [options] <input-file> [args...]\n"
             << "\nOptions:\n"
             << "  -o <file>        Write output to <file>\n"
             << "  -c, --lib        Compile to object file only (for libraries)\n"
@@ -12,31 +18,61 @@ void printUsage(const char *programName) {
             << "  <file>.o         Link with object file\n"
             << "  --emit-llvm      Emit LLVM IR (.ll file)\n"
             << "  --emit-ast       Print AST\n"
-            << "  -O<level>        Optimization level (0-3)\n"
+            << "  -O<level>        Optimization level (0-3, s, z)\n"
+            << "  --target-cpu <cpu>       Generate code for <cpu> (or \"native\")\n"
+            << "  --target-features <f>    Enable/disable CPU features (e.g. +avx2,-avx512f)\n"
+            << "  -march=<cpu>     Same as --target-cpu (-march=native uses the host CPU)\n"
+            << "  -j <n>           Compile up to <n> modules (or one file's functions) in parallel (0 = all cores)\n"
+            << "  --codegen-threads=<n>    Run the backend for a large module's partitions on <n> threads (0 = all cores)\n"
+            << "  --lto=<thin|full>        Link-time optimize multi-file builds (-flto is thin)\n"
+            << "  --string-memory=<regions|none>   Free strings and arrays when the call or loop iteration that built them ends (default regions)\n"
+            << "  --profile-generate[=<file>]      Instrument for PGO; the program writes <file> (default_%m.profraw)\n"
+            << "  --profile-use=<file>     Optimize with a profile merged by llvm-profdata\n"
+            << "  --time-trace     Write a Chrome trace of compile time (<output>.time-trace.json)\n"
+            << "  --time-trace-file=<file>         Write the trace to <file>\n"
+            << "  --time-trace-granularity=<us>    Minimum span length to record (default 500)\n"
             << "  -v, --verbose    Verbose output\n"
+            << "\nCompile server (must come first):\n"
+            << "  --server         Keep a warm compiler running, serving requests on a socket\n"
+            << "  --client         Send this compile to the server (compiles locally if none is running)\n"
+            << "  --socket <path>  Server socket (default: $FLOW_SERVER_SOCKET or a per-user path)\n"
             << "  -h, --help       Display this help message\n"
             << std::endl;
 }
 
-int main(int argc, char **argv) {
+// Parse one command line (without the program name) and compile it
+static int compile(const std::vector<std::string> &args, const char *programName) {
     flow::CompilerOptions options;
     std::vector<std::string> objectFiles;
     std::vector<std::string> libraryPaths;
 
+    // `run` JIT-compiles and executes the program; arguments after the input
+    // file belong to the program
+    size_t firstArg = 0;
+    if (!args.empty() && args[0] == "run") {
+        options.run = true;
+        firstArg = 1;
+    }
+
     // Parse command-line arguments
-    for (int i = 1; i < argc; i++) {
-        std::string arg = argv[i];
+    for (size_t i = firstArg; i < args.size(); i++) {
+        const std::string &arg = args[i];
+
+        if (options.run && !options.inputFile.empty()) {
+            options.runArgs.push_back(arg);
+            continue;
+        }
 
         if (arg == "-h" || arg == "--help") {
-            printUsage(argv[0]);
+            printUsage(programName);
             return 0;
         } else if (arg == "-v" || arg == "--verbose") {
             options.verbose = true;
         } else if (arg == "-c" || arg == "--lib") {
             options.objectOnly = true;
         } else if (arg == "-L") {
-            if (i + 1 < argc) {
-                libraryPaths.push_back(argv[++i]);
+            if (i + 1 < args.size()) {
+                libraryPaths.push_back(args[++i]);
             } else {
                 std::cerr << "Error: -L requires an argument" << std::endl;
                 return 1;
@@ -46,22 +82,97 @@ int main(int argc, char **argv) {
         } else if (arg == "--emit-ast") {
             options.emitAST = true;
         } else if (arg == "-o") {
-            if (i + 1 < argc) {
-                options.outputFile = argv[++i];
+            if (i + 1 < args.size()) {
+                options.outputFile = args[++i];
             } else {
                 std::cerr << "Error: -o requires an argument" << std::endl;
                 return 1;
             }
         } else if (arg.substr(0, 2) == "-O") {
             options.optimize = true;
-            if (arg.length() > 2) {
+            options.optimizationLevel = 1;
+            options.sizeLevel = 0;
+            if (arg == "-Os" || arg == "-Oz") {
+                // Size levels optimize like -O2 but favour smaller code
+                options.optimizationLevel = 2;
+                options.sizeLevel = arg == "-Os" ? 1 : 2;
+            } else if (arg.length() == 3 && arg[2] >= '0' && arg[2] <= '3') {
                 options.optimizationLevel = arg[2] - '0';
+            } else if (arg.length() > 2) {
+                std::cerr << "Error: Invalid optimization level: " << arg << std::endl;
+                return 1;
+            }
+        } else if (arg.substr(0, 2) == "-j") {
+            std::string count = arg.length() > 2 ? arg.substr(2) : (i + 1 < args.size() ? args[++i] : "");
+            if (count.empty() || count.find_first_not_of("0123456789") != std::string::npos) {
+                std::cerr << "Error: -j requires a number" << std::endl;
+                return 1;
+            }
+            options.jobs = static_cast<unsigned>(std::stoul(count));
+        } else if (arg.substr(0, 18) == "--codegen-threads=") {
+            std::string count = arg.substr(18);
+            if (count.empty() || count.find_first_not_of("0123456789") != std::string::npos) {
+                std::cerr << "Error: --codegen-threads requires a number" << std::endl;
+                return 1;
+            }
+            options.codegenThreads = static_cast<unsigned>(std::stoul(count));
+        } else if (arg.substr(0, 16) == "--string-memory=") {
+            std::string mode = arg.substr(16);
+            if (mode != "regions" && mode != "none") {
+                std::cerr << "Error: Unknown string memory mode: " << mode << " (expected regions or none)" << std::endl;
+                return 1;
             }
+            options.stringRegions = mode == "regions";
+        } else if (arg == "--target-cpu" || arg == "--target-features") {
+            if (i + 1 < args.size()) {
+                (arg == "--target-cpu" ? options.targetCPU : options.targetFeatures) = args[++i];
+            } else {
+                std::cerr << "Error: " << arg << " requires an argument" << std::endl;
+                return 1;
+            }
+        } else if (arg.substr(0, 7) == "-march=" || arg.substr(0, 6) == "-mcpu=") {
+            options.targetCPU = arg.substr(arg.find('=') + 1);
+        } else if (arg.substr(0, 5) == "--lto" || arg.substr(0, 5) == "-flto") {
+            std::string mode = arg.find('=') != std::string::npos ? arg.substr(arg.find('=') + 1) : "thin";
+            if (arg == "--lto") {
+                mode = i + 1 < args.size() ? args[++i] : "";
+            } else if (arg != "-flto" && arg.find('=') == std::string::npos) {
+                std::cerr << "Error: Unknown option: " << arg << std::endl;
+                return 1;
+            }
+            if (mode == "thin") {
+                options.ltoMode = 1;
+            } else if (mode == "full") {
+                options.ltoMode = 2;
+            } else if (mode == "off" || mode == "none") {
+                options.ltoMode = 0;
+            } else {
+                std::cerr << "Error: Invalid LTO mode: " << mode << " (expected thin or full)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--profile-generate" || arg.substr(0, 19) == "--profile-generate=") {
+            options.profileGenerateFile = arg.length() > 19 ? arg.substr(19) : "default_%m.profraw";
+        } else if (arg.substr(0, 14) == "--profile-use=") {
+            options.profileUseFile = arg.substr(14);
+        } else if (arg == "--time-trace") {
+            options.timeTrace = true;
+        } else if (arg.substr(0, 18) == "--time-trace-file=") {
+            options.timeTrace = true;
+            options.timeTraceFile = arg.substr(18);
+        } else if (arg.substr(0, 25) == "--time-trace-granularity=") {
+            std::string value = arg.substr(25);
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+                std::cerr << "Error: --time-trace-granularity requires a number" << std::endl;
+                return 1;
+            }
+            options.timeTraceGranularity = static_cast<unsigned>(std::stoul(value));
+        } else if (arg.substr(0, 7) == "-mattr=") {
+            options.targetFeatures = arg.substr(7);
         } else if (arg.length() > 2 && arg.substr(arg.length() - 2) == ".o") {
             objectFiles.push_back(arg);
         } else if (arg[0] == '-') {
             std::cerr << "Error: Unknown option: " << arg << std::endl;
-            printUsage(argv[0]);
+            printUsage(programName);
             return 1;
         } else {
             // Input file
@@ -75,11 +186,93 @@ int main(int argc, char **argv) {
     // Check if input file was provided
     if (options.inputFile.empty()) {
         std::cerr << "Error: No input file specified" << std::endl;
-        printUsage(argv[0]);
+        printUsage(programName);
         return 1;
     }
 
+    if (!options.profileGenerateFile.empty()) {
+        if (!options.profileUseFile.empty()) {
+            std::cerr << "Error: --profile-generate and --profile-use can't be combined" << std::endl;
+            return 1;
+        }
+        if (options.run) {
+            std::cerr << "Error: --profile-generate needs a linked executable; it can't be used with run" << std::endl;
+            return 1;
+        }
+    }
+    if (!options.profileUseFile.empty()) {
+        std::error_code ec;
+        if (!std::filesystem::exists(options.profileUseFile, ec)) {
+            std::cerr << "Error: Profile not found: " << options.profileUseFile << std::endl;
+            return 1;
+        }
+        if (options.optimizationLevel == 0) {
+            std::cerr << "Warning: --profile-use has no effect at -O0" << std::endl;
+        }
+    }
+
+    if (options.timeTrace) {
+        flow::TimeTrace::start(programName, options.timeTraceGranularity);
+    }
+
     // Create driver and compile
     flow::Driver driver(options);
-    return driver.compile();
-}
\ No newline at end of file
+    int result = driver.compile();
+
+    if (options.timeTrace) {
+        std::string traceFile = options.timeTraceFile.empty()
+                                    ? options.outputFile + ".time-trace.json"
+                                    : options.timeTraceFile;
+        if (flow::TimeTrace::finish(traceFile) && options.verbose) {
+            std::cout << "Time trace written to: " << traceFile << std::endl;
+        }
+    }
+    return result;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> args;
+    bool serverMode = false;
+    bool clientMode = false;
+    std::string socketPath = flow::CompileServer::defaultSocketPath();
+
+    int i = 1;
+    for (; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--server") {
+            serverMode = true;
+        } else if (arg == "--client") {
+            clientMode = true;
+        } else if (arg == "--socket") {
+            if (i + 1 < argc) {
+                socketPath = argv[++i];
+            } else {
+                std::cerr << "Error: --socket requires an argument" << std::endl;
+                return 1;
+            }
+        } else {
+            break;
+        }
+    }
+    args.assign(argv + i, argv + argc);
+
+    if (serverMode) {
+        bool verbose = std::find(args.begin(), args.end(), "-v") != args.end() ||
+                       std::find(args.begin(), args.end(), "--verbose") != args.end();
+        const char *programName = argv[0];
+        return flow::CompileServer::serve(socketPath, [programName](const std::vector<std::string> &request) {
+            return compile(request, programName);
+        }, verbose);
+    }
+
+    // `run` executes the program in-process, which belongs in this process
+    // rather than the server's
+    if (clientMode && !(args.size() > 0 && args[0] == "run")) {
+        int exitCode = 0;
+        if (flow::CompileServer::forward(socketPath, args, exitCode)) {
+            return exitCode;
+        }
+    }
+
+    return compile(args, argv[0]);
+}
@@ -3,46 +3,15 @@
 
 namespace flow
 {
-    std::string Type::toString() const
+    ASTArena::~ASTArena()
     {
-        switch (kind)
+        // Nodes only point at each other, so the order doesn't matter
+        for (ASTNode* node : nodes)
         {
-        case TypeKind::INT: return "int";
-        case TypeKind::FLOAT: return "float";
-        case TypeKind::STRING: return "string";
-        case TypeKind::BOOL: return "bool";
-        case TypeKind::VOID: return "void";
-        case TypeKind::STRUCT:
-            if (!typeParams.empty())
-            {
-                std::string result = name + "<";
-                for (size_t i = 0; i < typeParams.size(); i++)
-                {
-                    if (i > 0) result += ", ";
-                    // Add null check to prevent crash
-                    if (typeParams[i]) {
-                        result += typeParams[i]->toString();
-                    } else {
-                        result += "null";
-                    }
-                }
-                result += ">";
-                return result;
-            }
-            return name;
-        case TypeKind::FUNCTION: return "function";
-        case TypeKind::ARRAY:
-            if (!typeParams.empty() && typeParams[0])
-            {
-                return typeParams[0]->toString() + "[]";
-            }
-            return "array";
-        case TypeKind::UNKNOWN: return "unknown";
-        default: return "?";
+            node->~ASTNode();
         }
     }
 
-
     void IntLiteralExpr::accept(ASTVisitor& visitor) { visitor.visit(*this); }
     void FloatLiteralExpr::accept(ASTVisitor& visitor) { visitor.visit(*this); }
     void StringLiteralExpr::accept(ASTVisitor& visitor) { visitor.visit(*this); }
@@ -0,0 +1,108 @@
+#include "../../include/AST/TypeContext.h"
+#include <functional>
+#include <mutex>
+
+namespace flow
+{
+    namespace
+    {
+        std::string spell(TypeKind kind, const std::string& name, const std::vector<const Type*>& params)
+        {
+            switch (kind)
+            {
+            case TypeKind::INT: return "int";
+            case TypeKind::FLOAT: return "float";
+            case TypeKind::STRING: return "string";
+            case TypeKind::BOOL: return "bool";
+            case TypeKind::VOID: return "void";
+            case TypeKind::STRUCT:
+                if (!params.empty())
+                {
+                    std::string result = name + "<";
+                    for (size_t i = 0; i < params.size(); i++)
+                    {
+                        if (i > 0) result += ", ";
+                        result += params[i] ? params[i]->toString() : "null";
+                    }
+                    result += ">";
+                    return result;
+                }
+                return name;
+            case TypeKind::FUNCTION: return "function";
+            case TypeKind::ARRAY:
+                if (!params.empty() && params[0])
+                {
+                    return params[0]->toString() + "[]";
+                }
+                return "array";
+            case TypeKind::UNKNOWN: return "unknown";
+            default: return "?";
+            }
+        }
+
+        size_t hashKey(TypeKind kind, std::string_view name, const std::vector<const Type*>& params)
+        {
+            size_t hash = std::hash<std::string_view>()(name) ^ static_cast<size_t>(kind);
+            for (const Type* param : params)
+            {
+                hash = hash * 31 + std::hash<const Type*>()(param);
+            }
+            return hash;
+        }
+    } // namespace
+
+    Type::Type(TypeKind k, const std::string& n, std::vector<const Type*> params)
+        : spelling(spell(k, n, params)), kind(k), name(n), typeParams(std::move(params))
+    {
+    }
+
+    TypeContext::TypeContext()
+    {
+        intType = get(TypeKind::INT, "int");
+        floatType = get(TypeKind::FLOAT, "float");
+        stringType = get(TypeKind::STRING, "string");
+        boolType = get(TypeKind::BOOL, "bool");
+        voidType = get(TypeKind::VOID, "void");
+    }
+
+    TypeContext& TypeContext::instance()
+    {
+        static TypeContext context;
+        return context;
+    }
+
+    const Type* TypeContext::get(TypeKind kind, const std::string& name, const std::vector<const Type*>& params)
+    {
+        Key key{kind, name, &params, hashKey(kind, name, params)};
+        Shard& shard = shards[(key.hash >> 8) % shardCount];
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            auto it = shard.types.find(key);
+            if (it != shard.types.end())
+            {
+                return it->second.get();
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        // Another thread may have added it between the two locks
+        auto it = shard.types.find(key);
+        if (it != shard.types.end())
+        {
+            return it->second.get();
+        }
+
+        std::unique_ptr<Type> type(new Type(kind, name, params));
+        Key stored{kind, type->name, &type->typeParams, key.hash};
+        return shard.types.emplace(stored, std::move(type)).first->second.get();
+    }
+
+    const Type* TypeContext::getFunction(const Type* returnType, const std::vector<const Type*>& paramTypes)
+    {
+        std::vector<const Type*> params;
+        params.reserve(paramTypes.size() + 1);
+        params.push_back(returnType);
+        params.insert(params.end(), paramTypes.begin(), paramTypes.end());
+        return get(TypeKind::FUNCTION, "lambda", params);
+    }
+} // namespace flow
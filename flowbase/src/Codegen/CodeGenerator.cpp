@@ -1,35 +1,229 @@
 #include "../../include/Codegen/CodeGenerator.h"
-#include "../../include/Lexer/Lexer.h"
-#include "../../include/Parser/Parser.h"
+#include "../../include/Common/ErrorReporter.h"
+#include "../../include/Common/ModuleGraph.h"
+#include "../../include/Common/ThreadPool.h"
+#include "../../include/Stdlib/FlowString.h"
+#include <llvm/ADT/StringExtras.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/PassTimingInfo.h>
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/OptimizationLevel.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/PGOOptions.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/xxhash.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/MC/TargetRegistry.h>
 #include <llvm/TargetParser/Triple.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
 #include <iostream>
 #include <set>
+#include <algorithm>
+#include <optional>
+#include <mutex>
 
 namespace flow {
+    namespace {
+        // Creating a TargetMachine (target lookup, host feature detection,
+        // subtarget tables) costs more than generating a small module. They
+        // can't be shared between threads, so generators check one out for
+        // their lifetime and hand it back, and parallel builds and the compile
+        // server reuse them instead of building one per module.
+        class TargetMachinePool {
+        private:
+            std::mutex mutex;
+            std::map<std::string, std::vector<std::unique_ptr<llvm::TargetMachine> > > idle;
+
+        public:
+            static TargetMachinePool &instance() {
+                static TargetMachinePool pool;
+                return pool;
+            }
+
+            std::unique_ptr<llvm::TargetMachine> acquire(const std::string &key) {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = idle.find(key);
+                if (it == idle.end() || it->second.empty()) {
+                    return nullptr;
+                }
+                std::unique_ptr<llvm::TargetMachine> machine = std::move(it->second.back());
+                it->second.pop_back();
+                return machine;
+            }
+
+            void release(const std::string &key, std::unique_ptr<llvm::TargetMachine> machine) {
+                std::lock_guard<std::mutex> lock(mutex);
+                idle[key].push_back(std::move(machine));
+            }
+        };
+
+        // Calls visit on expr and every expression inside it, except in
+        // lambda bodies (a lambda is a function of its own)
+        template<typename Visit>
+        void forEachExpr(Expr *expr, Visit &visit) {
+            if (!expr) return;
+            visit(expr);
+
+            if (auto *binary = dyn_cast<BinaryExpr>(expr)) {
+                forEachExpr(binary->left, visit);
+                forEachExpr(binary->right, visit);
+            } else if (auto *unary = dyn_cast<UnaryExpr>(expr)) {
+                forEachExpr(unary->operand, visit);
+            } else if (auto *call = dyn_cast<CallExpr>(expr)) {
+                forEachExpr(call->callee, visit);
+                for (Expr *arg: call->arguments) forEachExpr(arg, visit);
+            } else if (auto *member = dyn_cast<MemberAccessExpr>(expr)) {
+                forEachExpr(member->object, visit);
+            } else if (auto *init = dyn_cast<StructInitExpr>(expr)) {
+                for (Expr *field: init->fieldValues) forEachExpr(field, visit);
+            } else if (auto *array = dyn_cast<ArrayLiteralExpr>(expr)) {
+                for (Expr *element: array->elements) forEachExpr(element, visit);
+            } else if (auto *index = dyn_cast<IndexExpr>(expr)) {
+                forEachExpr(index->array, visit);
+                forEachExpr(index->index, visit);
+            }
+        }
+
+        // Calls visit on every statement in stmts, nested ones included
+        template<typename Visit>
+        void forEachStmt(const std::vector<Stmt *> &stmts, Visit &visit) {
+            for (Stmt *stmt: stmts) {
+                if (!stmt) continue;
+                visit(stmt);
+
+                if (auto *ifStmt = dyn_cast<IfStmt>(stmt)) {
+                    forEachStmt(ifStmt->thenBranch, visit);
+                    forEachStmt(ifStmt->elseBranch, visit);
+                } else if (auto *forStmt = dyn_cast<ForStmt>(stmt)) {
+                    forEachStmt(forStmt->body, visit);
+                } else if (auto *whileStmt = dyn_cast<WhileStmt>(stmt)) {
+                    forEachStmt(whileStmt->body, visit);
+                } else if (auto *block = dyn_cast<BlockStmt>(stmt)) {
+                    forEachStmt(block->statements, visit);
+                }
+            }
+        }
+
+        template<typename Visit>
+        void forEachExpr(const std::vector<Stmt *> &stmts, Visit &visit) {
+            auto visitStmt = [&](Stmt *stmt) {
+                if (auto *exprStmt = dyn_cast<ExprStmt>(stmt)) {
+                    forEachExpr(exprStmt->expression, visit);
+                } else if (auto *varDecl = dyn_cast<VarDeclStmt>(stmt)) {
+                    forEachExpr(varDecl->initializer, visit);
+                } else if (auto *assignment = dyn_cast<AssignmentStmt>(stmt)) {
+                    forEachExpr(assignment->value, visit);
+                } else if (auto *ret = dyn_cast<ReturnStmt>(stmt)) {
+                    forEachExpr(ret->value, visit);
+                } else if (auto *ifStmt = dyn_cast<IfStmt>(stmt)) {
+                    forEachExpr(ifStmt->condition, visit);
+                } else if (auto *forStmt = dyn_cast<ForStmt>(stmt)) {
+                    forEachExpr(forStmt->rangeStart, visit);
+                    forEachExpr(forStmt->rangeEnd, visit);
+                    forEachExpr(forStmt->iterable, visit);
+                } else if (auto *whileStmt = dyn_cast<WhileStmt>(stmt)) {
+                    forEachExpr(whileStmt->condition, visit);
+                }
+            };
+            forEachStmt(stmts, visitStmt);
+        }
+
+        // Calls visit on each assignment in stmts whose target wasn't
+        // declared in stmts. declared holds the names in scope so far;
+        // nested blocks are treated as scopes, which can only make a local
+        // look like an outer variable, never the reverse.
+        template<typename Visit>
+        void forEachOuterAssignment(const std::vector<Stmt *> &stmts, std::vector<std::string> &declared,
+                                    Visit &visit) {
+            auto nested = [&](const std::vector<Stmt *> &body, const std::string *var = nullptr) {
+                size_t start = declared.size();
+                if (var) declared.push_back(*var);
+                forEachOuterAssignment(body, declared, visit);
+                declared.resize(start);
+            };
+
+            for (Stmt *stmt: stmts) {
+                if (!stmt) continue;
+
+                if (auto *varDecl = dyn_cast<VarDeclStmt>(stmt)) {
+                    declared.push_back(varDecl->name);
+                } else if (auto *assignment = dyn_cast<AssignmentStmt>(stmt)) {
+                    if (std::find(declared.begin(), declared.end(), assignment->target) == declared.end()) {
+                        visit(*assignment);
+                    }
+                } else if (auto *ifStmt = dyn_cast<IfStmt>(stmt)) {
+                    nested(ifStmt->thenBranch);
+                    nested(ifStmt->elseBranch);
+                } else if (auto *forStmt = dyn_cast<ForStmt>(stmt)) {
+                    nested(forStmt->body, &forStmt->iteratorVar);
+                } else if (auto *whileStmt = dyn_cast<WhileStmt>(stmt)) {
+                    nested(whileStmt->body);
+                } else if (auto *block = dyn_cast<BlockStmt>(stmt)) {
+                    nested(block->statements);
+                }
+            }
+        }
+
+        // SplitModule makes local symbols hidden globals so the parts can
+        // reach each other, and names the unnamed ones __llvmsplit_unnamed.
+        // Every module has a __lambda_0 and a print format, so two split
+        // modules linked together would define the same names; prefixing
+        // them with a hash of the module's source keeps them apart.
+        void qualifyLocals(llvm::Module &module) {
+            std::string id = module.getSourceFileName() + '\0' + module.getModuleIdentifier();
+            std::string prefix = "__flow" + llvm::utohexstr(llvm::xxh3_64bits(llvm::StringRef(id))) + ".";
+            for (llvm::GlobalValue &value: module.global_values()) {
+                if (value.hasLocalLinkage() && !value.isDeclaration()) {
+                    value.setName(prefix + (value.hasName() ? value.getName().str() : "anon"));
+                }
+            }
+        }
+    }
+
     CodeGenerator::CodeGenerator(const std::string &moduleName)
-        : currentValue(nullptr), currentDirectory(".") {
+        : currentValue(nullptr), currentDirectory("."), optimizationLevel(0), sizeLevel(0),
+          ltoMode(0), moduleOptimized(false), lambdaCounter(0), jobs(1), codegenThreads(1), stringRegions(true),
+          bodiesFailed(false), functionRegion(nullptr), functionReturnType(nullptr) {
         context = std::make_unique<llvm::LLVMContext>();
         module = std::make_unique<llvm::Module>(moduleName, *context);
         builder = std::make_unique<llvm::IRBuilder<> >(*context);
+        stringType = llvm::StructType::create(
+            *context, {llvm::PointerType::get(*context, 0), llvm::Type::getInt64Ty(*context)}, "flow.string");
+        arrayType = llvm::StructType::create(
+            *context,
+            {
+                llvm::PointerType::get(*context, 0), llvm::Type::getInt64Ty(*context), llvm::Type::getInt64Ty(*context),
+                llvm::Type::getInt64Ty(*context)
+            },
+            "flow.array");
 
 
         declareBuiltinFunctions();
     }
 
+    CodeGenerator::~CodeGenerator() {
+        if (targetMachine) {
+            TargetMachinePool::instance().release(targetMachineKey, std::move(targetMachine));
+        }
+    }
+
     void CodeGenerator::declareBuiltinFunctions() {
         // We use weak linkage to allow multiple definitions without conflicts
 
@@ -139,7 +333,7 @@ namespace flow {
 
         llvm::FunctionType *printType = llvm::FunctionType::get(
             llvm::Type::getVoidTy(*context),
-            {llvm::PointerType::get(*context, 0)},
+            {stringType},
             false
         );
         llvm::Function *printFunc = llvm::Function::Create(
@@ -158,8 +352,14 @@ namespace flow {
         arg->setName("str");
 
 
+        // Strings aren't NUL-terminated in general, so print by length
         llvm::Function *printfFunc = module->getFunction("printf");
-        builder->CreateCall(printfFunc, {arg});
+        llvm::Value *printFormat = builder->CreateGlobalString("%.*s", "", 0, module.get());
+        builder->CreateCall(printfFunc, {
+                                printFormat,
+                                builder->CreateTrunc(builder->CreateExtractValue(arg, 1), llvm::Type::getInt32Ty(*context)),
+                                builder->CreateExtractValue(arg, 0)
+                            });
 
         // Return void
         builder->CreateRetVoid();
@@ -181,17 +381,20 @@ namespace flow {
         printlnArg->setName("str");
 
 
-        llvm::Value *formatStr = builder->CreateGlobalString("%s\n", "", 0, module.get());
+        llvm::Value *formatStr = builder->CreateGlobalString("%.*s\n", "", 0, module.get());
 
 
-        builder->CreateCall(printfFunc, {formatStr, printlnArg});
+        builder->CreateCall(printfFunc, {
+                                formatStr,
+                                builder->CreateTrunc(builder->CreateExtractValue(printlnArg, 1),
+                                                     llvm::Type::getInt32Ty(*context)),
+                                builder->CreateExtractValue(printlnArg, 0)
+                            });
 
         // Return void
         builder->CreateRetVoid();
 
 
-        // @TODO actually support length
-
         llvm::FunctionType *lenType = llvm::FunctionType::get(
             llvm::Type::getInt32Ty(*context),
             {llvm::PointerType::get(*context, 0)},
@@ -204,35 +407,81 @@ namespace flow {
             module.get()
         );
 
-        // For now, len() just returns 0 (placeholder)
-
+        // Calls by name are inlined; this body serves everything else
         llvm::BasicBlock *lenEntry = llvm::BasicBlock::Create(*context, "entry", lenFunc);
         builder->SetInsertPoint(lenEntry);
-        llvm::Value *lenResult = llvm::ConstantInt::get(*context, llvm::APInt(32, 0));
-        builder->CreateRet(lenResult);
+        lenFunc->getArg(0)->setName("array");
+        builder->CreateRet(arrayLength(lenFunc->getArg(0)));
 
+        // String runtime (Stdlib/FlowString.h): strings go in as (data, length)
+        // and come back as the string struct. strlen needs no call.
+        llvm::Type *dataType = llvm::PointerType::get(*context, 0);
+        llvm::Type *lengthType = llvm::Type::getInt64Ty(*context);
+        llvm::Function::Create(
+            llvm::FunctionType::get(stringType, {dataType}, false),
+            llvm::Function::ExternalLinkage, "flow_string_from_cstr", module.get());
 
+        llvm::Function::Create(
+            llvm::FunctionType::get(dataType, {dataType, lengthType}, false),
+            llvm::Function::ExternalLinkage, "flow_string_to_cstr", module.get());
 
+        llvm::Function::Create(
+            llvm::FunctionType::get(stringType, {dataType, lengthType, lengthType}, false),
+            llvm::Function::ExternalLinkage, "flow_string_from_buffer", module.get());
 
-        // String: strlen
         llvm::Function::Create(
-            llvm::FunctionType::get(llvm::Type::getInt32Ty(*context), {llvm::PointerType::get(*context, 0)}, false),
-            llvm::Function::ExternalLinkage, "_ZN4flow6stdlib11strlen_implEPKc", module.get());
+            llvm::FunctionType::get(stringType,
+                                    {dataType, lengthType, llvm::Type::getInt32Ty(*context), llvm::Type::getInt32Ty(*context)},
+                                    false),
+            llvm::Function::ExternalLinkage, "flow_string_substr", module.get());
 
-        // String: substr
         llvm::Function::Create(
-            llvm::FunctionType::get(llvm::PointerType::get(*context, 0),
-                                    {
-                                        llvm::PointerType::get(*context, 0), llvm::Type::getInt32Ty(*context),
-                                        llvm::Type::getInt32Ty(*context)
-                                    }, false),
-            llvm::Function::ExternalLinkage, "_ZN4flow6stdlib11substr_implEPKcii", module.get());
-
-        // String: concat
+            llvm::FunctionType::get(stringType, {dataType, lengthType, dataType, lengthType}, false),
+            llvm::Function::ExternalLinkage, "flow_string_concat", module.get());
+
         llvm::Function::Create(
-            llvm::FunctionType::get(llvm::PointerType::get(*context, 0),
-                                    {llvm::PointerType::get(*context, 0), llvm::PointerType::get(*context, 0)}, false),
-            llvm::Function::ExternalLinkage, "_ZN4flow6stdlib11concat_implEPKcS2_", module.get());
+            llvm::FunctionType::get(stringType, {dataType, lengthType}, false),
+            llvm::Function::ExternalLinkage, "flow_string_concat_n", module.get());
+
+        llvm::Function::Create(
+            llvm::FunctionType::get(lengthType, {llvm::Type::getInt32Ty(*context), dataType}, false),
+            llvm::Function::ExternalLinkage, "flow_format_int", module.get());
+
+        llvm::Function::Create(
+            llvm::FunctionType::get(lengthType, {llvm::Type::getDoubleTy(*context), dataType}, false),
+            llvm::Function::ExternalLinkage, "flow_format_float", module.get());
+
+        llvm::Function::Create(
+            llvm::FunctionType::get(llvm::Type::getInt32Ty(*context), {dataType, lengthType, dataType, lengthType},
+                                    false),
+            llvm::Function::ExternalLinkage, "flow_string_equals", module.get());
+
+        llvm::Function::Create(
+            llvm::FunctionType::get(lengthType, {}, false),
+            llvm::Function::ExternalLinkage, "flow_region_enter", module.get());
+
+        llvm::Function::Create(
+            llvm::FunctionType::get(llvm::Type::getVoidTy(*context), {lengthType}, false),
+            llvm::Function::ExternalLinkage, "flow_region_leave", module.get());
+
+        llvm::Function::Create(
+            llvm::FunctionType::get(stringType, {dataType, lengthType, lengthType}, false),
+            llvm::Function::ExternalLinkage, "flow_region_keep", module.get());
+
+        // Array runtime (Stdlib/FlowArray.h): creating an array, growing a
+        // full one and keeping one past its region; lengths and elements are
+        // read in place
+        llvm::Function::Create(
+            llvm::FunctionType::get(dataType, {lengthType, lengthType}, false),
+            llvm::Function::ExternalLinkage, "flow_array_new", module.get());
+
+        llvm::Function::Create(
+            llvm::FunctionType::get(llvm::Type::getVoidTy(*context), {dataType, lengthType}, false),
+            llvm::Function::ExternalLinkage, "flow_array_grow", module.get());
+
+        llvm::Function::Create(
+            llvm::FunctionType::get(dataType, {dataType, lengthType, lengthType}, false),
+            llvm::Function::ExternalLinkage, "flow_array_keep", module.get());
 
         // Math: abs, sqrt, pow, min, max
         llvm::Function::Create(
@@ -277,13 +526,21 @@ namespace flow {
             llvm::Function::ExternalLinkage, "_ZN4flow6stdlib13readFile_implEPKc", module.get());
     }
 
-    llvm::Type *CodeGenerator::getLLVMType(std::shared_ptr<Type> flowType) {
+    llvm::Type *CodeGenerator::getLLVMType(const Type *flowType) {
         if (!flowType) {
             return llvm::Type::getVoidTy(*context);
         }
 
-        flowType = resolveTypeAlias(flowType);
+        auto cached = llvmTypes.find(flowType);
+        if (cached != llvmTypes.end()) {
+            return cached->second;
+        }
+        llvm::Type *lowered = lowerType(resolveTypeAlias(flowType));
+        llvmTypes[flowType] = lowered;
+        return lowered;
+    }
 
+    llvm::Type *CodeGenerator::lowerType(const Type *flowType) {
         switch (flowType->kind) {
             case TypeKind::INT:
                 return llvm::Type::getInt32Ty(*context);
@@ -292,13 +549,13 @@ namespace flow {
             case TypeKind::BOOL:
                 return llvm::Type::getInt1Ty(*context);
             case TypeKind::STRING:
-                return llvm::PointerType::get(*context, 0);
+                return stringType;
             case TypeKind::VOID:
                 return llvm::Type::getVoidTy(*context);
             case TypeKind::STRUCT:
                 // Special handling for builtin Option<T> struct
                 if (flowType->name == "Option" && !flowType->typeParams.empty()) {
-                    std::string optionKey = "Option<" + flowType->typeParams[0]->toString() + ">";
+                    const std::string &optionKey = flowType->toString(); // Option<T>
                     if (structTypes.find(optionKey) != structTypes.end()) {
                         return structTypes[optionKey];
                     }
@@ -311,6 +568,7 @@ namespace flow {
                     // Register field indices for Option<T>
                     structFieldIndices[optionKey]["hasValue"] = 0;
                     structFieldIndices[optionKey]["value"] = 1;
+                    structFieldTypes[optionKey] = {nullptr, flowType->typeParams[0]};
                     return optionType;
                 }
 
@@ -319,11 +577,7 @@ namespace flow {
                 }
                 return llvm::StructType::create(*context, flowType->name);
             case TypeKind::ARRAY:
-                if (!flowType->typeParams.empty()) {
-                    llvm::Type *elemType = getLLVMType(flowType->typeParams[0]);
-                    return llvm::PointerType::get(elemType, 0);
-                }
-                return llvm::PointerType::get(llvm::Type::getInt8Ty(*context), 0);
+                return llvm::PointerType::get(*context, 0); // to the flow.array header
             case TypeKind::FUNCTION:
                 return llvm::PointerType::get(*context, 0);
             case TypeKind::UNKNOWN:
@@ -332,7 +586,7 @@ namespace flow {
         }
     }
 
-    std::shared_ptr<Type> CodeGenerator::resolveTypeAlias(std::shared_ptr<Type> type) {
+    const Type *CodeGenerator::resolveTypeAlias(const Type *type) {
         if (!type) return type;
 
         // Check if this type name is an alias
@@ -356,11 +610,427 @@ namespace flow {
         return llvm::FunctionType::get(returnType, paramTypes, false);
     }
 
+    llvm::FunctionType *CodeGenerator::getForeignFunctionType(FunctionDecl &funcDecl) {
+        auto lower = [this](const Type *type) -> llvm::Type *{
+            const Type *resolved = resolveTypeAlias(type);
+            if (resolved && resolved->kind == TypeKind::STRING) {
+                return llvm::PointerType::get(*context, 0);
+            }
+            return getLLVMType(type);
+        };
+
+        std::vector<llvm::Type *> paramTypes;
+        for (const auto &param: funcDecl.parameters) {
+            paramTypes.push_back(lower(param.type));
+        }
+        return llvm::FunctionType::get(lower(funcDecl.returnType), paramTypes, false);
+    }
+
+    llvm::Value *CodeGenerator::createString(llvm::Value *data, llvm::Value *length) {
+        llvm::Value *str = llvm::PoisonValue::get(stringType);
+        str = builder->CreateInsertValue(str, data, 0);
+        return builder->CreateInsertValue(str, length, 1, "str");
+    }
+
+    llvm::Value *CodeGenerator::toCString(llvm::Value *str) {
+        return callStringRuntime("flow_string_to_cstr", {str});
+    }
+
+    llvm::Value *CodeGenerator::fromCString(llvm::Value *ptr) {
+        return builder->CreateCall(module->getFunction("flow_string_from_cstr"), {ptr}, "str");
+    }
+
+    llvm::Value *CodeGenerator::callStringRuntime(const std::string &name, const std::vector<llvm::Value *> &strings,
+                                                  const std::vector<llvm::Value *> &extra) {
+        std::vector<llvm::Value *> args;
+        for (llvm::Value *str: strings) {
+            args.push_back(builder->CreateExtractValue(str, 0, "data"));
+            args.push_back(builder->CreateExtractValue(str, 1, "len"));
+        }
+        args.insert(args.end(), extra.begin(), extra.end());
+        return builder->CreateCall(module->getFunction(name), args);
+    }
+
+    llvm::Value *CodeGenerator::stringify(llvm::Value *value, const Type *valueType) {
+        llvm::Type *type = value->getType();
+        if (type == stringType) {
+            return value;
+        }
+        if (type->isIntegerTy(1)) {
+            value = builder->CreateZExt(value, llvm::Type::getInt32Ty(*context));
+            type = value->getType();
+        }
+
+        // Numbers are formatted into a stack buffer rather than the heap; the
+        // concatenation copies the digits out before the buffer is reused
+        const char *formatter = nullptr;
+        int bufferSize = 0;
+        if (type->isIntegerTy(32)) {
+            formatter = "flow_format_int";
+            bufferSize = flowIntBufferSize;
+        } else if (type->isDoubleTy()) {
+            formatter = "flow_format_float";
+            bufferSize = flowFloatBufferSize;
+        }
+        if (formatter) {
+            llvm::Value *buffer = createEntryAlloca(
+                llvm::ArrayType::get(llvm::Type::getInt8Ty(*context), bufferSize), "numbuf");
+            llvm::Value *length = builder->CreateCall(module->getFunction(formatter), {value, buffer}, "numlen");
+            return createString(buffer, length);
+        }
+
+        ErrorReporter::errors() << "Cannot concatenate a value of type "
+                << (valueType ? valueType->toString() : "unknown") << " to a string" << std::endl;
+        return llvm::Constant::getNullValue(stringType);
+    }
+
+    bool CodeGenerator::isStringConcat(BinaryExpr &node) {
+        if (node.op != TokenType::PLUS) {
+            return false;
+        }
+        const Type *leftType = resolveTypeAlias(node.left->type);
+        const Type *rightType = resolveTypeAlias(node.right->type);
+        return (leftType && leftType->kind == TypeKind::STRING) ||
+               (rightType && rightType->kind == TypeKind::STRING);
+    }
+
+    void CodeGenerator::flattenConcat(Expr *expr, std::vector<Expr *> &operands) {
+        auto *binary = dyn_cast<BinaryExpr>(expr);
+        if (binary && isStringConcat(*binary)) {
+            flattenConcat(binary->left, operands);
+            flattenConcat(binary->right, operands);
+        } else {
+            operands.push_back(expr);
+        }
+    }
+
+    llvm::Value *CodeGenerator::concatStrings(const std::vector<llvm::Value *> &pieces) {
+        if (pieces.size() == 2) {
+            return callStringRuntime("flow_string_concat", pieces);
+        }
+
+        llvm::Type *piecesType = llvm::ArrayType::get(stringType, pieces.size());
+        llvm::AllocaInst *array = createEntryAlloca(piecesType, "pieces");
+        for (size_t i = 0; i < pieces.size(); i++) {
+            builder->CreateStore(pieces[i], builder->CreateConstInBoundsGEP2_32(piecesType, array, 0, i));
+        }
+        return builder->CreateCall(module->getFunction("flow_string_concat_n"), {
+                                       array,
+                                       llvm::ConstantInt::get(llvm::Type::getInt64Ty(*context), pieces.size())
+                                   }, "str");
+    }
+
+    llvm::Type *CodeGenerator::arrayElementType(const Type *type) {
+        const Type *resolved = resolveTypeAlias(type);
+        if (isArrayType(resolved) && !resolved->typeParams.empty()) {
+            return getLLVMType(resolved->typeParams[0]);
+        }
+        return llvm::Type::getInt32Ty(*context); // Default to int
+    }
+
+    bool CodeGenerator::isArrayType(const Type *type) {
+        const Type *resolved = resolveTypeAlias(type);
+        return resolved && resolved->kind == TypeKind::ARRAY;
+    }
+
+    llvm::Value *CodeGenerator::arrayData(llvm::Value *array) {
+        return builder->CreateLoad(llvm::PointerType::get(*context, 0), builder->CreateStructGEP(arrayType, array, 0),
+                                   "data");
+    }
+
+    llvm::Value *CodeGenerator::arrayLength(llvm::Value *array) {
+        // The runtime won't grow an array past INT32_MAX elements, so this
+        // can't wrap
+        llvm::Value *length = builder->CreateLoad(llvm::Type::getInt64Ty(*context),
+                                                  builder->CreateStructGEP(arrayType, array, 1), "length");
+        return builder->CreateTrunc(length, llvm::Type::getInt32Ty(*context), "len");
+    }
+
+    llvm::Value *CodeGenerator::arrayElement(llvm::Value *array, llvm::Value *index, llvm::Type *elementType) {
+        // One unsigned comparison catches negative indices too
+        llvm::Value *length = builder->CreateLoad(llvm::Type::getInt64Ty(*context),
+                                                  builder->CreateStructGEP(arrayType, array, 1), "length");
+        llvm::Value *wideIndex = builder->CreateSExt(index, llvm::Type::getInt64Ty(*context), "index");
+        llvm::Value *isOutOfBounds = builder->CreateICmpUGE(wideIndex, length, "oob");
+
+        llvm::Function *currentFunc = builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock *trapBlock = llvm::BasicBlock::Create(*context, "trap", currentFunc);
+        llvm::BasicBlock *okBlock = llvm::BasicBlock::Create(*context, "indexok", currentFunc);
+        builder->CreateCondBr(isOutOfBounds, trapBlock, okBlock);
+
+        // Trap block: report and abort
+        builder->SetInsertPoint(trapBlock);
+        llvm::Function *printfFunc = module->getFunction("printf");
+        if (printfFunc) {
+            llvm::Value *errorMsg = builder->CreateGlobalString("Runtime Error: Array index out of bounds!\n",
+                                                                 "errmsg");
+            builder->CreateCall(printfFunc, {errorMsg});
+        }
+        llvm::Function *trapFunc = llvm::Intrinsic::getDeclaration(module.get(), llvm::Intrinsic::trap);
+        builder->CreateCall(trapFunc);
+        builder->CreateUnreachable();
+
+        builder->SetInsertPoint(okBlock);
+        return builder->CreateInBoundsGEP(elementType, arrayData(array), wideIndex, "elemptr");
+    }
+
+    void CodeGenerator::pushElement(llvm::Value *array, llvm::Value *value, const Type *elementFlowType) {
+        llvm::Type *elementType = value->getType();
+        llvm::Type *int64Type = llvm::Type::getInt64Ty(*context);
+
+        // The array may live in a lower region than the value, as when a
+        // loop pushes onto an array declared before it
+        if (stringRegions && holdsRegionMemory(elementFlowType)) {
+            llvm::Value *region = builder->CreateLoad(int64Type, builder->CreateStructGEP(arrayType, array, 3),
+                                                      "region");
+            value = keepValue(value, elementFlowType,
+                              builder->CreateAdd(region, llvm::ConstantInt::get(int64Type, 1), "above"));
+        }
+
+        // Only a full array calls into the runtime to grow
+        llvm::Value *lengthPtr = builder->CreateStructGEP(arrayType, array, 1);
+        llvm::Value *length = builder->CreateLoad(int64Type, lengthPtr, "length");
+        llvm::Value *capacity = builder->CreateLoad(int64Type, builder->CreateStructGEP(arrayType, array, 2),
+                                                    "capacity");
+
+        llvm::Function *currentFunc = builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock *growBlock = llvm::BasicBlock::Create(*context, "grow", currentFunc);
+        llvm::BasicBlock *storeBlock = llvm::BasicBlock::Create(*context, "pushstore", currentFunc);
+        builder->CreateCondBr(builder->CreateICmpEQ(length, capacity, "full"), growBlock, storeBlock);
+
+        builder->SetInsertPoint(growBlock);
+        builder->CreateCall(module->getFunction("flow_array_grow"), {
+                                array, llvm::ConstantExpr::getSizeOf(elementType)
+                            });
+        builder->CreateBr(storeBlock);
+
+        builder->SetInsertPoint(storeBlock);
+        builder->CreateStore(value, builder->CreateInBoundsGEP(elementType, arrayData(array), length, "slot"));
+        builder->CreateStore(builder->CreateAdd(length, llvm::ConstantInt::get(int64Type, 1), "newlength"),
+                             lengthPtr);
+    }
+
+    llvm::AllocaInst *CodeGenerator::createEntryAlloca(llvm::Type *type, const std::string &name) {
+        llvm::BasicBlock &entry = builder->GetInsertBlock()->getParent()->getEntryBlock();
+        llvm::IRBuilder<> entryBuilder(&entry, entry.begin());
+        return entryBuilder.CreateAlloca(type, nullptr, name);
+    }
+
+    const std::vector<const Type *> *CodeGenerator::structFieldTypesOf(const Type *type) {
+        bool isOption = type->name == "Option" && !type->typeParams.empty();
+        auto it = structFieldTypes.find(isOption ? type->toString() : type->name);
+        return it == structFieldTypes.end() ? nullptr : &it->second;
+    }
+
+    bool CodeGenerator::holdsRegionMemory(const Type *type) {
+        const Type *resolved = resolveTypeAlias(type);
+        if (!resolved) {
+            return false;
+        }
+        switch (resolved->kind) {
+            case TypeKind::STRING:
+            case TypeKind::ARRAY:
+                return true;
+            case TypeKind::STRUCT: {
+                const std::vector<const Type *> *fields = structFieldTypesOf(resolved);
+                if (!fields) {
+                    return false;
+                }
+                for (const Type *field: *fields) {
+                    if (holdsRegionMemory(field)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool CodeGenerator::allocatesString(Expr *expr) {
+        if (auto *binary = dyn_cast<BinaryExpr>(expr)) {
+            return isStringConcat(*binary);
+        }
+        if (isa<ArrayLiteralExpr>(expr)) {
+            return true;
+        }
+        auto *call = dyn_cast<CallExpr>(expr);
+        if (!call) {
+            return false;
+        }
+
+        // These read their strings without allocating, and push keeps its
+        // value in the array's own region
+        auto *callee = dyn_cast<IdentifierExpr>(call->callee);
+        if (callee && (callee->name == "print" || callee->name == "println" ||
+                       (callee->name == "strlen" && call->arguments.size() == 1) ||
+                       (callee->name == "substr" && call->arguments.size() == 3) ||
+                       (callee->name == "len" && call->arguments.size() == 1) ||
+                       (callee->name == "push" && call->arguments.size() == 2))) {
+            return false;
+        }
+
+        // A callee's string or array result is kept in our region, and a
+        // string passed to C may be copied to add its NUL (an array grows in
+        // its own region, wherever it's passed)
+        bool builds = holdsRegionMemory(call->type);
+        for (Expr *arg: call->arguments) {
+            builds |= arg && !isArrayType(arg->type) && holdsRegionMemory(arg->type);
+        }
+        return builds;
+    }
+
+    bool CodeGenerator::buildsStrings(const std::vector<Stmt *> &body) {
+        // A returned string or array is built in the caller's region when
+        // there's no region of our own, so building only the return value
+        // needs none
+        std::set<Expr *> returned;
+        auto collect = [&](Stmt *stmt) {
+            if (auto *ret = dyn_cast<ReturnStmt>(stmt)) {
+                returned.insert(ret->value);
+            }
+        };
+        forEachStmt(body, collect);
+
+        bool builds = false;
+        auto visit = [&](Expr *expr) {
+            builds |= !returned.count(expr) && allocatesString(expr);
+        };
+        forEachExpr(body, visit);
+        return builds;
+    }
+
+    llvm::Value *CodeGenerator::enterRegion(const std::vector<Stmt *> &body, bool loopBody) {
+        if (!stringRegions || !buildsStrings(body)) {
+            return nullptr;
+        }
+
+        // A string or array assigned to a variable declared outside the loop
+        // outlives the iteration, so the assignment keeps it past the
+        // outermost iteration region the variable is declared outside of.
+        // Whatever makes a loop build strings makes its function build them
+        // too, so a return from inside the loop leaves both regions.
+        std::vector<AssignmentStmt *> escaping;
+        if (loopBody) {
+            bool untyped = false;
+            auto visit = [&](AssignmentStmt &assignment) {
+                if (!assignment.value || !assignment.value->type) {
+                    untyped = true;
+                } else if (holdsRegionMemory(assignment.value->type) && !loopAssignmentMarks.count(&assignment)) {
+                    escaping.push_back(&assignment);
+                }
+            };
+            std::vector<std::string> declared;
+            forEachOuterAssignment(body, declared, visit);
+            if (untyped) {
+                return nullptr;
+            }
+        }
+
+        llvm::Value *mark = builder->CreateCall(module->getFunction("flow_region_enter"), {}, "region");
+        for (AssignmentStmt *assignment: escaping) {
+            loopAssignmentMarks[assignment] = mark;
+        }
+        return mark;
+    }
+
+    void CodeGenerator::leaveLoopRegion(llvm::Value *mark) {
+        for (auto it = loopAssignmentMarks.begin(); it != loopAssignmentMarks.end();) {
+            it = it->second == mark ? loopAssignmentMarks.erase(it) : std::next(it);
+        }
+        leaveRegion(mark);
+    }
+
+    void CodeGenerator::leaveRegion(llvm::Value *mark) {
+        if (mark && !builder->GetInsertBlock()->getTerminator()) {
+            builder->CreateCall(module->getFunction("flow_region_leave"), {mark});
+        }
+    }
+
+    llvm::Value *CodeGenerator::keepValue(llvm::Value *value, const Type *type, llvm::Value *mark) {
+        const Type *resolved = resolveTypeAlias(type);
+        if (!resolved) {
+            return value;
+        }
+
+        if (resolved->kind == TypeKind::STRING) {
+            return callStringRuntime("flow_region_keep", {value}, {mark});
+        }
+
+        if (resolved->kind == TypeKind::ARRAY) {
+            return keepArray(value, resolved, mark);
+        }
+
+        if (resolved->kind == TypeKind::STRUCT) {
+            const std::vector<const Type *> *fields = structFieldTypesOf(resolved);
+            for (unsigned i = 0; fields && i < fields->size(); i++) {
+                if (holdsRegionMemory((*fields)[i])) {
+                    llvm::Value *field = keepValue(builder->CreateExtractValue(value, i), (*fields)[i], mark);
+                    value = builder->CreateInsertValue(value, field, i);
+                }
+            }
+        }
+        return value;
+    }
+
+    llvm::Value *CodeGenerator::keepArray(llvm::Value *array, const Type *type, llvm::Value *mark) {
+        const Type *elementFlowType = type->typeParams.empty() ? nullptr : type->typeParams[0];
+        llvm::Type *elementType = arrayElementType(type);
+        llvm::Type *int64Type = llvm::Type::getInt64Ty(*context);
+        llvm::Value *kept = builder->CreateCall(module->getFunction("flow_array_keep"), {
+                                                    array, llvm::ConstantExpr::getSizeOf(elementType), mark
+                                                }, "kept");
+        if (!holdsRegionMemory(elementFlowType)) {
+            return kept;
+        }
+
+        // A copy's elements still point into the regions being left, so
+        // keep each of them; an array that wasn't copied holds none
+        llvm::Function *currentFunc = builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock *before = builder->GetInsertBlock();
+        llvm::BasicBlock *loopBlock = llvm::BasicBlock::Create(*context, "keepelem", currentFunc);
+        llvm::BasicBlock *doneBlock = llvm::BasicBlock::Create(*context, "keptelems", currentFunc);
+        llvm::Value *length = builder->CreateLoad(int64Type, builder->CreateStructGEP(arrayType, kept, 1), "length");
+        llvm::Value *copied = builder->CreateICmpNE(kept, array, "copied");
+        llvm::Value *nonEmpty = builder->CreateICmpSGT(length, llvm::ConstantInt::get(int64Type, 0), "nonempty");
+        builder->CreateCondBr(builder->CreateAnd(copied, nonEmpty), loopBlock, doneBlock);
+
+        builder->SetInsertPoint(loopBlock);
+        llvm::PHINode *index = builder->CreatePHI(int64Type, 2, "i");
+        index->addIncoming(llvm::ConstantInt::get(int64Type, 0), before);
+        llvm::Value *slot = builder->CreateInBoundsGEP(elementType, arrayData(kept), index, "slot");
+        llvm::Value *element = builder->CreateLoad(elementType, slot, "elem");
+        builder->CreateStore(keepValue(element, elementFlowType, mark), slot);
+        llvm::Value *next = builder->CreateAdd(index, llvm::ConstantInt::get(int64Type, 1), "next");
+        index->addIncoming(next, builder->GetInsertBlock());
+        builder->CreateCondBr(builder->CreateICmpSLT(next, length, "more"), loopBlock, doneBlock);
+
+        builder->SetInsertPoint(doneBlock);
+        return kept;
+    }
+
+    void CodeGenerator::createReturn(llvm::Value *value) {
+        if (functionRegion) {
+            if (value) {
+                value = keepValue(value, functionReturnType, functionRegion);
+            }
+            leaveRegion(functionRegion);
+        }
+
+        if (value) {
+            builder->CreateRet(value);
+        } else {
+            builder->CreateRetVoid();
+        }
+    }
+
     void CodeGenerator::declareExternalFunction(FunctionDecl &funcDecl) {
         // Check if function already exists
         if (module->getFunction(funcDecl.name)) {
             return; // Already declared
         }
+        externalDecls.push_back(&funcDecl);
 
         // Create LLVM function type
         llvm::FunctionType *FT = getFunctionType(funcDecl);
@@ -374,105 +1044,574 @@ namespace flow {
         );
     }
 
-    void CodeGenerator::generate(std::shared_ptr<Program> program) {
-        if (program) {
-            // Set current directory to the program's source file directory if available
-            if (!program->declarations.empty() && program->declarations[0]) {
-                if (!program->declarations[0]->location.filename.empty()) {
-                    namespace fs = std::filesystem;
-                    currentDirectory = fs::path(program->declarations[0]->location.filename)
-                            .parent_path().string();
-                    if (currentDirectory.empty()) {
-                        currentDirectory = ".";
-                    }
+    llvm::FunctionType *CodeGenerator::getMethodType(ImplDecl &node) {
+        // Build parameter types (first parameter is 'this' pointer to struct)
+        std::vector<llvm::Type *> paramTypes;
+        
+        // Add 'this' parameter (pointer to struct)
+        if (structTypes.find(node.structName) == structTypes.end()) {
+            return nullptr;
+        }
+        paramTypes.push_back(llvm::PointerType::get(*context, 0));
+
+        // Add other parameters
+        for (const auto &param : node.parameters) {
+            paramTypes.push_back(getLLVMType(param.type));
+        }
+
+        // Determine return type
+        llvm::Type *returnType = getLLVMType(node.returnType);
+
+        return llvm::FunctionType::get(returnType, paramTypes, false);
+    }
+
+    void CodeGenerator::declarePrototype(Decl &decl) {
+        llvm::FunctionType *type = nullptr;
+        std::string name;
+        if (auto *funcDecl = dyn_cast<FunctionDecl>(&decl)) {
+            type = getFunctionType(*funcDecl);
+            name = funcDecl->name;
+        } else if (auto *implDecl = dyn_cast<ImplDecl>(&decl)) {
+            type = getMethodType(*implDecl);
+            name = implDecl->structName + "_" + implDecl->methodName;
+        }
+
+        // Leave builtins and earlier declarations of the name alone
+        if (!type || module->getFunction(name)) {
+            return;
+        }
+        prototypes.insert(llvm::Function::Create(type, llvm::Function::ExternalLinkage, name, module.get()));
+    }
+
+    llvm::Function *CodeGenerator::createFunction(llvm::FunctionType *type, const std::string &name) {
+        llvm::Function *function = module->getFunction(name);
+        if (function && prototypes.count(function) && function->isDeclaration() &&
+            function->getFunctionType() == type) {
+            return function;
+        }
+        return llvm::Function::Create(type, llvm::Function::ExternalLinkage, name, module.get());
+    }
+
+    bool CodeGenerator::generateBodies(const std::vector<Decl *> &declarations, const std::vector<Decl *> &bodies) {
+        // Small modules aren't worth a second context and the link
+        const size_t minBodiesPerPartition = 64;
+        unsigned threads = jobs == 0 ? ThreadPool::hardwareThreads() : jobs;
+        size_t partitions = std::min<size_t>(threads, bodies.size() / minBodiesPerPartition);
+        if (partitions >= 2) {
+            return generatePartitions(declarations, bodies, partitions);
+        }
+
+        for (Decl *decl: bodies) {
+            decl->accept(*this);
+        }
+        return true;
+    }
+
+    bool CodeGenerator::generatePartitions(const std::vector<Decl *> &declarations,
+                                           const std::vector<Decl *> &bodies, size_t partitions) {
+        llvm::TimeTraceScope timeScope("CodegenPartitions", std::to_string(partitions) + " partitions");
+
+        // Each partition is a generator with its own context that sees every
+        // declaration and prototype but only generates a contiguous run of
+        // bodies. Its module comes back as bitcode, since modules can only be
+        // linked within one context.
+        std::vector<llvm::SmallVector<char, 0> > bitcode(partitions);
+        std::vector<std::string> logs(partitions);
+        {
+            ThreadPool pool(static_cast<unsigned>(partitions));
+            for (size_t index = 0; index < partitions; index++) {
+                pool.submit([&, index] {
+                    std::ostringstream log;
+                    ErrorReporter::redirect(&log, &log);
+
+                    CodeGenerator partition(module->getModuleIdentifier());
+                    partition.currentDirectory = currentDirectory;
+                    partition.libraryPaths = libraryPaths;
+                    partition.stringRegions = stringRegions;
+                    for (FunctionDecl *funcDecl: externalDecls) {
+                        partition.declareExternalFunction(*funcDecl);
+                    }
+                    for (Decl *decl: declarations) {
+                        decl->accept(partition);
+                    }
+                    for (Decl *decl: bodies) {
+                        partition.declarePrototype(*decl);
+                    }
+
+                    size_t begin = bodies.size() * index / partitions;
+                    size_t end = bodies.size() * (index + 1) / partitions;
+                    for (size_t i = begin; i < end; i++) {
+                        bodies[i]->accept(partition);
+                    }
+
+                    llvm::raw_svector_ostream stream(bitcode[index]);
+                    llvm::WriteBitcodeToFile(*partition.module, stream);
+
+                    ErrorReporter::redirect(nullptr, nullptr);
+                    logs[index] = log.str();
+                });
+            }
+            pool.wait();
+        }
+
+        // Replay diagnostics and link in partition order, so the module and
+        // the output don't depend on thread timing
+        for (const auto &log: logs) {
+            ErrorReporter::errors() << log;
+        }
+
+        for (size_t index = 0; index < partitions; index++) {
+            llvm::MemoryBufferRef buffer(llvm::StringRef(bitcode[index].data(), bitcode[index].size()),
+                                         module->getModuleIdentifier());
+            auto partitionModule = llvm::parseBitcodeFile(buffer, *context);
+            if (!partitionModule) {
+                ErrorReporter::errors() << "Error: Could not read partition " << index << ": "
+                        << llvm::toString(partitionModule.takeError()) << std::endl;
+                return false;
+            }
+            if (llvm::Linker::linkModules(*module, std::move(*partitionModule))) {
+                ErrorReporter::errors() << "Error: Could not link partition " << index << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool CodeGenerator::generate(std::shared_ptr<Program> program) {
+        llvm::TimeTraceScope timeScope("Codegen", module->getModuleIdentifier());
+        if (program) {
+            // Set current directory to the program's source file directory if available
+            if (!program->declarations.empty() && program->declarations[0]) {
+                if (!program->declarations[0]->location.getFilename().empty()) {
+                    namespace fs = std::filesystem;
+                    fs::path source(program->declarations[0]->location.getFilename());
+                    currentDirectory = source.parent_path().string();
+                    if (currentDirectory.empty()) {
+                        currentDirectory = ".";
+                    }
+                    // Module ids are file stems, which repeat across directories
+                    std::error_code ec;
+                    fs::path absolute = fs::absolute(source, ec);
+                    module->setSourceFileName((ec ? source : absolute).lexically_normal().string());
+                }
+            }
+            program->accept(*this);
+        }
+        return !bodiesFailed;
+    }
+
+    void CodeGenerator::dumpIR() {
+        module->print(llvm::outs(), nullptr);
+    }
+
+    void CodeGenerator::writeIRToFile(const std::string &filename) {
+        std::error_code EC;
+        llvm::raw_fd_ostream dest(filename, EC, llvm::sys::fs::OF_None);
+
+        if (EC) {
+            ErrorReporter::errors() << "Could not open file: " << EC.message() << std::endl;
+            return;
+        }
+
+        module->print(dest, nullptr);
+    }
+
+    std::unique_ptr<llvm::Module> CodeGenerator::takeModule(std::unique_ptr<llvm::LLVMContext> &moduleContext) {
+        builder.reset();
+        namedValues.clear();
+        lambdaValues.clear();
+        currentValue = nullptr;
+
+        moduleContext = std::move(context);
+        return std::move(module);
+    }
+
+    std::string CodeGenerator::resolveTargetCPU(const std::string &cpu) {
+        if (cpu.empty()) {
+            return "generic";
+        }
+        if (cpu == "native") {
+            return llvm::sys::getHostCPUName().str();
+        }
+        return cpu;
+    }
+
+    std::string CodeGenerator::resolveTargetFeatures(const std::string &cpu, const std::string &features) {
+        if (cpu != "native") {
+            return features;
+        }
+
+        // Host CPU names don't imply every feature (e.g. AVX-512 may be fused off)
+        std::vector<std::string> hostFeatures;
+        for (const auto &feature: llvm::sys::getHostCPUFeatures()) {
+            hostFeatures.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+        }
+        std::sort(hostFeatures.begin(), hostFeatures.end());
+
+        std::string result;
+        for (const auto &feature: hostFeatures) {
+            if (!result.empty()) result += ",";
+            result += feature;
+        }
+
+        // Explicit features come last so they override detected ones
+        if (!features.empty()) {
+            if (!result.empty()) result += ",";
+            result += features;
+        }
+        return result;
+    }
+
+    void CodeGenerator::initializeTargets() {
+        // Target registration isn't thread-safe; parallel builds share it
+        static std::once_flag targetInitFlag;
+        std::call_once(targetInitFlag, [] {
+            llvm::InitializeNativeTarget();
+            llvm::InitializeNativeTargetAsmPrinter();
+            llvm::InitializeNativeTargetAsmParser();
+        });
+    }
+
+    std::unique_ptr<llvm::TargetMachine> CodeGenerator::createTargetMachine(const std::string &triple) {
+        // Look up the target
+        std::string error;
+        const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+
+        if (!target) {
+            ErrorReporter::errors() << "Error: " << error << std::endl;
+            return nullptr;
+        }
+
+        llvm::CodeGenOptLevel codegenLevel = llvm::CodeGenOptLevel::Default;
+        switch (optimizationLevel) {
+            case 0: codegenLevel = llvm::CodeGenOptLevel::None;
+                break;
+            case 1: codegenLevel = llvm::CodeGenOptLevel::Less;
+                break;
+            case 3: codegenLevel = llvm::CodeGenOptLevel::Aggressive;
+                break;
+            default: break;
+        }
+
+        llvm::TargetOptions opt;
+        std::unique_ptr<llvm::TargetMachine> machine(target->createTargetMachine(
+            llvm::Triple(triple),
+            resolveTargetCPU(targetCPU),
+            resolveTargetFeatures(targetCPU, targetFeatures),
+            opt,
+            llvm::Reloc::PIC_,
+            std::nullopt,
+            codegenLevel
+        ));
+
+        if (!machine) {
+            ErrorReporter::errors() << "Error: could not create target machine for " << triple << std::endl;
+        }
+        return machine;
+    }
+
+    llvm::TargetMachine *CodeGenerator::getTargetMachine() {
+        if (targetMachine) {
+            return targetMachine.get();
+        }
+
+        initializeTargets();
+
+        std::string targetTripleStr = module->getTargetTriple().getTriple();
+
+        if (targetTripleStr.empty()) {
+            targetTripleStr = llvm::sys::getDefaultTargetTriple();
+            module->setTargetTriple(llvm::Triple(targetTripleStr));
+        }
+
+        targetMachineKey = targetTripleStr + "|" + targetCPU + "|" + targetFeatures + "|" +
+                           std::to_string(optimizationLevel);
+        targetMachine = TargetMachinePool::instance().acquire(targetMachineKey);
+        if (!targetMachine) {
+            targetMachine = createTargetMachine(targetTripleStr);
+            if (!targetMachine) {
+                return nullptr;
+            }
+        }
+
+        module->setDataLayout(targetMachine->createDataLayout());
+
+        // Record the target on each function so the inliner and vectorizer agree with codegen
+        std::string cpuName = std::string(targetMachine->getTargetCPU());
+        std::string featureString = std::string(targetMachine->getTargetFeatureString());
+        for (llvm::Function &func: *module) {
+            if (func.isDeclaration()) continue;
+            func.addFnAttr("target-cpu", cpuName);
+            if (!featureString.empty()) {
+                func.addFnAttr("target-features", featureString);
+            }
+        }
+        return targetMachine.get();
+    }
+
+    void CodeGenerator::optimizeModule() {
+        if (moduleOptimized) {
+            return;
+        }
+        moduleOptimized = true;
+
+        llvm::TimeTraceScope timeScope("Optimize", module->getModuleIdentifier());
+
+        // The optimizer needs the target's data layout and cost model
+        llvm::TargetMachine *machine = getTargetMachine();
+        if (!machine) {
+            return;
+        }
+
+        // Optimizing malformed IR can crash LLVM; keep the unoptimized module instead
+        if (llvm::verifyModule(*module, &llvm::errs())) {
+            ErrorReporter::errors() << "Warning: module failed verification, skipping optimization" << std::endl;
+            return;
+        }
+
+        llvm::OptimizationLevel level = llvm::OptimizationLevel::O0;
+        if (sizeLevel == 1) {
+            level = llvm::OptimizationLevel::Os;
+        } else if (sizeLevel >= 2) {
+            level = llvm::OptimizationLevel::Oz;
+        } else if (optimizationLevel == 1) {
+            level = llvm::OptimizationLevel::O1;
+        } else if (optimizationLevel == 2) {
+            level = llvm::OptimizationLevel::O2;
+        } else if (optimizationLevel >= 3) {
+            level = llvm::OptimizationLevel::O3;
+        }
+
+        // Most size-sensitive passes key off function attributes rather than the level
+        if (sizeLevel > 0) {
+            for (llvm::Function &func: *module) {
+                if (func.isDeclaration()) continue;
+                func.addFnAttr(llvm::Attribute::OptimizeForSize);
+                if (sizeLevel >= 2) {
+                    func.addFnAttr(llvm::Attribute::MinSize);
                 }
             }
-            program->accept(*this);
         }
+
+        // Match clang's vectorizer defaults: loops at -O2/-O3/-Os, SLP also at -Oz
+        llvm::PipelineTuningOptions tuning;
+        tuning.LoopUnrolling = optimizationLevel > 1;
+        tuning.LoopInterleaving = optimizationLevel > 1 && sizeLevel < 2;
+        tuning.LoopVectorization = optimizationLevel > 1 && sizeLevel < 2;
+        tuning.SLPVectorization = optimizationLevel > 1;
+
+        // One span per pass under --time-trace (does nothing otherwise)
+        llvm::PassInstrumentationCallbacks instrumentation;
+        llvm::TimeProfilingPassesHandler passTimer;
+        passTimer.registerCallbacks(instrumentation);
+
+        // IR-level PGO; also instruments at -O0 so profiles can come from debug builds
+        std::optional<llvm::PGOOptions> profile;
+        if (!profileGenerateFile.empty()) {
+            profile = llvm::PGOOptions(profileGenerateFile, "", "", "", llvm::vfs::getRealFileSystem(),
+                                       llvm::PGOOptions::IRInstr);
+        } else if (!profileUseFile.empty()) {
+            profile = llvm::PGOOptions(profileUseFile, "", "", "", llvm::vfs::getRealFileSystem(),
+                                       llvm::PGOOptions::IRUse);
+        }
+
+        llvm::LoopAnalysisManager LAM;
+        llvm::FunctionAnalysisManager FAM;
+        llvm::CGSCCAnalysisManager CGAM;
+        llvm::ModuleAnalysisManager MAM;
+
+        llvm::PassBuilder passBuilder(machine, tuning, profile, &instrumentation);
+        passBuilder.registerModuleAnalyses(MAM);
+        passBuilder.registerCGSCCAnalyses(CGAM);
+        passBuilder.registerFunctionAnalyses(FAM);
+        passBuilder.registerLoopAnalyses(LAM);
+        passBuilder.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+        // LTO modules get the pre-link pipeline; inlining across modules and
+        // the rest of the optimization happen at link time
+        llvm::ThinOrFullLTOPhase ltoPhase = llvm::ThinOrFullLTOPhase::None;
+        if (ltoMode == 1) {
+            ltoPhase = llvm::ThinOrFullLTOPhase::ThinLTOPreLink;
+        } else if (ltoMode == 2) {
+            ltoPhase = llvm::ThinOrFullLTOPhase::FullLTOPreLink;
+        }
+
+        llvm::ModulePassManager MPM;
+        if (level == llvm::OptimizationLevel::O0) {
+            MPM = passBuilder.buildO0DefaultPipeline(level, ltoPhase);
+        } else if (ltoMode == 1) {
+            MPM = passBuilder.buildThinLTOPreLinkDefaultPipeline(level);
+        } else if (ltoMode == 2) {
+            MPM = passBuilder.buildLTOPreLinkDefaultPipeline(level);
+        } else {
+            MPM = passBuilder.buildPerModuleDefaultPipeline(level);
+        }
+        MPM.run(*module, MAM);
     }
 
-    void CodeGenerator::dumpIR() {
-        module->print(llvm::outs(), nullptr);
+    bool CodeGenerator::emitObject(llvm::raw_pwrite_stream &dest) {
+        llvm::TargetMachine *machine = getTargetMachine();
+        if (!machine) {
+            return false;
+        }
+
+        optimizeModule();
+
+        // The legacy pass manager adds a span per codegen pass itself
+        llvm::TimeTraceScope timeScope("EmitObject", module->getModuleIdentifier());
+
+        llvm::legacy::PassManager pass;
+        if (machine->addPassesToEmitFile(pass, dest, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+            ErrorReporter::errors() << "TargetMachine can't emit a file of this type" << std::endl;
+            return false;
+        }
+
+        pass.run(*module);
+        return true;
     }
 
-    void CodeGenerator::writeIRToFile(const std::string &filename) {
+    void CodeGenerator::compileToObject(const std::string &filename) {
+        // Open output file
         std::error_code EC;
         llvm::raw_fd_ostream dest(filename, EC, llvm::sys::fs::OF_None);
 
         if (EC) {
-            std::cerr << "Could not open file: " << EC.message() << std::endl;
+            ErrorReporter::errors() << "Could not open file: " << EC.message() << std::endl;
             return;
         }
 
-        module->print(dest, nullptr);
+        emitObject(dest);
+        dest.flush();
     }
 
-    void CodeGenerator::compileToObject(const std::string &filename) {
-
-        llvm::InitializeNativeTarget();
-        llvm::InitializeNativeTargetAsmPrinter();
-        llvm::InitializeNativeTargetAsmParser();
-
-
-        std::string targetTripleStr = module->getTargetTriple().getTriple();
+    bool CodeGenerator::compileToBitcode(const std::string &filename) {
+        // Sets the data layout and target attributes the LTO backend codegens with
+        if (!getTargetMachine()) {
+            return false;
+        }
 
-        if (targetTripleStr.empty()) {
-#ifdef __APPLE__
-            targetTripleStr = "arm64-apple-darwin"; // macOS ARM
-#elif __linux__
-            targetTripleStr = "x86_64-unknown-linux-gnu";
-#elif _WIN32
-            targetTripleStr = "x86_64-pc-windows-msvc";
-#else
-            targetTripleStr = "x86_64-unknown-unknown";
-#endif
-            module->setTargetTriple(llvm::Triple(targetTripleStr));
+        if (ltoMode == 2) {
+            // Marks the module for the regular (monolithic) LTO partition
+            module->addModuleFlag(llvm::Module::Error, "ThinLTO", uint32_t(0));
         }
 
-        // Create Triple object for target lookup
-        llvm::Triple targetTriple(targetTripleStr);
+        optimizeModule();
 
-        // Look up the target
-        std::string error;
-        const llvm::Target *target = llvm::TargetRegistry::lookupTarget(targetTripleStr, error);
+        llvm::TimeTraceScope timeScope("EmitBitcode", module->getModuleIdentifier());
 
-        if (!target) {
-            std::cerr << "Error: " << error << std::endl;
-            return;
+        std::error_code EC;
+        llvm::raw_fd_ostream dest(filename, EC, llvm::sys::fs::OF_None);
+        if (EC) {
+            ErrorReporter::errors() << "Could not open file: " << EC.message() << std::endl;
+            return false;
         }
 
+        if (ltoMode == 1) {
+            // The summary drives ThinLTO's import and internalization decisions
+            llvm::ProfileSummaryInfo profileSummary(*module);
+            llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(*module, nullptr, &profileSummary);
+            llvm::WriteBitcodeToFile(*module, dest, false, &index);
+        } else {
+            llvm::WriteBitcodeToFile(*module, dest);
+        }
+        dest.flush();
+        return !dest.has_error();
+    }
 
-        llvm::TargetOptions opt;
-        llvm::TargetMachine *targetMachine = target->createTargetMachine(
-            targetTriple,
-            "generic",
-            "",
-            opt,
-            llvm::Reloc::PIC_
-        );
+    bool CodeGenerator::emitPartitions(std::vector<llvm::SmallVector<char, 0> > &objects, size_t partitions) {
+        llvm::TimeTraceScope timeScope("EmitPartitions", std::to_string(partitions) + " partitions");
+
+        // SplitModule clones each part into this module's context, which only
+        // one thread may use, so the parts move to their own contexts as
+        // bitcode. Which part a function lands in depends only on the module.
+        std::vector<llvm::SmallVector<char, 0> > bitcode;
+        qualifyLocals(*module);
+        llvm::SplitModule(*module, static_cast<unsigned>(partitions), [&](std::unique_ptr<llvm::Module> part) {
+            bitcode.emplace_back();
+            llvm::raw_svector_ostream stream(bitcode.back());
+            llvm::WriteBitcodeToFile(*part, stream);
+        });
+
+        std::string triple = module->getTargetTriple().getTriple();
+        objects.assign(bitcode.size(), {});
+        std::vector<std::string> logs(bitcode.size());
+        std::vector<char> emitted(bitcode.size(), 0);
+        {
+            unsigned threads = codegenThreads == 0 ? ThreadPool::hardwareThreads() : codegenThreads;
+            ThreadPool pool(static_cast<unsigned>(std::min<size_t>(threads, bitcode.size())));
+            for (size_t index = 0; index < bitcode.size(); index++) {
+                pool.submit([&, index] {
+                    std::ostringstream log;
+                    ErrorReporter::redirect(&log, &log);
+                    llvm::TimeTraceScope partitionScope("EmitPartition", std::to_string(index));
+
+                    llvm::LLVMContext partitionContext;
+                    llvm::MemoryBufferRef buffer(llvm::StringRef(bitcode[index].data(), bitcode[index].size()),
+                                                 module->getModuleIdentifier());
+                    auto part = llvm::parseBitcodeFile(buffer, partitionContext);
+                    std::unique_ptr<llvm::TargetMachine> machine;
+                    if (!part) {
+                        ErrorReporter::errors() << "Error: Could not read partition " << index << ": "
+                                << llvm::toString(part.takeError()) << std::endl;
+                    } else {
+                        machine = TargetMachinePool::instance().acquire(targetMachineKey);
+                        if (!machine) {
+                            machine = createTargetMachine(triple);
+                        }
+                    }
 
-        module->setDataLayout(targetMachine->createDataLayout());
+                    if (machine) {
+                        llvm::legacy::PassManager pass;
+                        llvm::raw_svector_ostream dest(objects[index]);
+                        if (machine->addPassesToEmitFile(pass, dest, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+                            ErrorReporter::errors() << "TargetMachine can't emit a file of this type" << std::endl;
+                        } else {
+                            pass.run(**part);
+                            emitted[index] = 1;
+                        }
+                        TargetMachinePool::instance().release(targetMachineKey, std::move(machine));
+                    }
 
-        // Open output file
-        std::error_code EC;
-        llvm::raw_fd_ostream dest(filename, EC, llvm::sys::fs::OF_None);
+                    ErrorReporter::redirect(nullptr, nullptr);
+                    logs[index] = log.str();
+                });
+            }
+            pool.wait();
+        }
 
-        if (EC) {
-            std::cerr << "Could not open file: " << EC.message() << std::endl;
-            return;
+        // Replay diagnostics in partition order, as if emitted by one thread
+        for (const auto &log: logs) {
+            ErrorReporter::errors() << log;
         }
+        return std::find(emitted.begin(), emitted.end(), 0) == emitted.end();
+    }
 
-        // Emit object file
-        llvm::legacy::PassManager pass;
-        if (targetMachine->addPassesToEmitFile(pass, dest, nullptr, llvm::CodeGenFileType::ObjectFile)) {
-            std::cerr << "TargetMachine can't emit a file of this type" << std::endl;
-            return;
+    bool CodeGenerator::compileToMemory(std::vector<llvm::SmallVector<char, 0> > &objects) {
+        objects.clear();
+
+        if (!getTargetMachine()) {
+            return false;
         }
+        optimizeModule();
 
-        pass.run(*module);
-        dest.flush();
+        // The partition count comes from the module's size alone, so every
+        // thread count gives the same objects; one thread emits the
+        // partitions in turn. Small modules aren't worth the split and the
+        // extra objects.
+        const size_t minFunctionsPerPartition = 32;
+        const size_t maxPartitions = 16;
+        size_t definitions = 0;
+        for (const llvm::Function &func: *module) {
+            definitions += !func.isDeclaration();
+        }
+        size_t partitions = std::min(maxPartitions, definitions / minFunctionsPerPartition);
+        if (partitions >= 2) {
+            return emitPartitions(objects, partitions);
+        }
 
-        delete targetMachine;
+        objects.emplace_back();
+        llvm::raw_svector_ostream dest(objects.back());
+        return emitObject(dest);
     }
 
 
@@ -488,8 +1627,13 @@ namespace flow {
     }
 
     void CodeGenerator::visit(StringLiteralExpr &node) {
-
-        currentValue = builder->CreateGlobalString(node.value, "", 0, module.get());
+        // The length is known here, so it never has to be measured at runtime
+        llvm::Constant *data = builder->CreateGlobalString(node.value, "", 0, module.get());
+        currentValue = llvm::ConstantStruct::get(stringType, {
+                                                     data,
+                                                     llvm::ConstantInt::get(llvm::Type::getInt64Ty(*context),
+                                                                            node.value.size())
+                                                 });
     }
 
     void CodeGenerator::visit(BoolLiteralExpr &node) {
@@ -497,111 +1641,43 @@ namespace flow {
     }
 
     void CodeGenerator::visit(IdentifierExpr &node) {
-        auto it = namedValues.find(node.name);
-        if (it != namedValues.end()) {
-            currentValue = builder->CreateLoad(getLLVMType(node.type), it->second, node.name);
+        if (llvm::Value *variable = namedValues.lookup(node.name)) {
+            currentValue = builder->CreateLoad(getLLVMType(node.type), variable, node.name);
         } else {
-            std::cerr << "Unknown variable: " << node.name << std::endl;
+            ErrorReporter::errors() << "Unknown variable: " << node.name << std::endl;
             currentValue = nullptr;
         }
     }
 
     void CodeGenerator::visit(ThisExpr &node) {
         // 'this' is already a pointer to the struct, so just load it
-        auto it = namedValues.find("this");
-        if (it != namedValues.end()) {
-            currentValue = it->second;
+        if (llvm::Value *thisValue = namedValues.lookup("this")) {
+            currentValue = thisValue;
         } else {
-            std::cerr << "'this' not found in current context" << std::endl;
+            ErrorReporter::errors() << "'this' not found in current context" << std::endl;
             currentValue = nullptr;
         }
     }
 
     void CodeGenerator::visit(BinaryExpr &node) {
-        // Handle string concatenation specially
-        if (node.op == TokenType::PLUS) {
-            // Resolve type aliases before checking types
-            auto leftType = resolveTypeAlias(node.left->type);
-            auto rightType = resolveTypeAlias(node.right->type);
-
-            // Check if either operand is a string type
-            bool leftIsString = (leftType && leftType->kind == TypeKind::STRING);
-            bool rightIsString = (rightType && rightType->kind == TypeKind::STRING);
-
-            if (leftIsString || rightIsString) {
-                // Generate string concatenation code
-                node.left->accept(*this);
-                llvm::Value *L = currentValue;
-                llvm::Type *LType = L->getType();
-
-                node.right->accept(*this);
-                llvm::Value *R = currentValue;
-                llvm::Type *RType = R->getType();
-
-                // Get format string and call sprintf
-                llvm::Function *sprintfFunc = module->getFunction("sprintf");
-                llvm::Function *mallocFunc = module->getFunction("malloc");
-                llvm::Function *strlenFunc = module->getFunction("strlen");
-
-                // Allocate buffer for result (512 bytes should be enough)
-                llvm::Value *bufferSize = llvm::ConstantInt::get(*context, llvm::APInt(64, 512));
-                llvm::Value *buffer = builder->CreateCall(mallocFunc, {bufferSize}, "strbuf");
-
-                // Create format string based on types
-                std::string formatStr;
-                std::vector<llvm::Value *> sprintfArgs;
-                sprintfArgs.push_back(buffer);
-
-                if (LType->isPointerTy() && RType->isPointerTy()) {
-                    // String + String
-                    formatStr = "%s%s";
-                    sprintfArgs.push_back(builder->CreateGlobalString(formatStr, "", 0, module.get()));
-                    sprintfArgs.push_back(L);
-                    sprintfArgs.push_back(R);
-                } else if (LType->isPointerTy() && RType->isIntegerTy(32)) {
-                    // String + Int
-                    formatStr = "%s%d";
-                    sprintfArgs.push_back(builder->CreateGlobalString(formatStr, "", 0, module.get()));
-                    sprintfArgs.push_back(L);
-                    sprintfArgs.push_back(R);
-                } else if (LType->isPointerTy() && RType->isDoubleTy()) {
-                    // String + Float
-                    formatStr = "%s%f";
-                    sprintfArgs.push_back(builder->CreateGlobalString(formatStr, "", 0, module.get()));
-                    sprintfArgs.push_back(L);
-                    sprintfArgs.push_back(R);
-                } else if (LType->isIntegerTy(32) && RType->isPointerTy()) {
-                    // Int + String
-                    formatStr = "%d%s";
-                    sprintfArgs.push_back(builder->CreateGlobalString(formatStr, "", 0, module.get()));
-                    sprintfArgs.push_back(L);
-                    sprintfArgs.push_back(R);
-                } else if (LType->isDoubleTy() && RType->isPointerTy()) {
-                    // Float + String
-                    formatStr = "%f%s";
-                    sprintfArgs.push_back(builder->CreateGlobalString(formatStr, "", 0, module.get()));
-                    sprintfArgs.push_back(L);
-                    sprintfArgs.push_back(R);
-                } else {
-                    // Fallback
-                    formatStr = "%s%s";
-                    sprintfArgs.push_back(builder->CreateGlobalString(formatStr, "", 0, module.get()));
-                    sprintfArgs.push_back(L);
-                    sprintfArgs.push_back(R);
-                }
-
-                // Rearrange args: buffer, format, then values
-                std::vector<llvm::Value *> finalArgs;
-                finalArgs.push_back(buffer);
-                finalArgs.push_back(sprintfArgs[1]); // format string
-                for (size_t i = 2; i < sprintfArgs.size(); i++) {
-                    finalArgs.push_back(sprintfArgs[i]);
+        // A chain of string `+` (a + b + c ...) is joined in one step: each
+        // operand is evaluated once, then the total length is allocated once
+        if (isStringConcat(node)) {
+            std::vector<Expr *> operands;
+            flattenConcat(&node, operands);
+
+            std::vector<llvm::Value *> pieces;
+            for (Expr *operand: operands) {
+                operand->accept(*this);
+                if (!currentValue) {
+                    return;
                 }
-
-                builder->CreateCall(sprintfFunc, finalArgs);
-                currentValue = buffer;
-                return;
+                // Numbers are formatted first, so every piece has a known length
+                pieces.push_back(stringify(currentValue, resolveTypeAlias(operand->type)));
             }
+
+            currentValue = concatStrings(pieces);
+            return;
         }
 
         // Regular numeric operations
@@ -616,6 +1692,17 @@ namespace flow {
             return;
         }
 
+        // Strings compare by content
+        if (L->getType() == stringType && R->getType() == stringType &&
+            (node.op == TokenType::EQ || node.op == TokenType::NE)) {
+            llvm::Value *equal = callStringRuntime("flow_string_equals", {L, R});
+            llvm::Value *zero = llvm::ConstantInt::get(*context, llvm::APInt(32, 0));
+            currentValue = node.op == TokenType::EQ
+                               ? builder->CreateICmpNE(equal, zero, "streq")
+                               : builder->CreateICmpEQ(equal, zero, "strne");
+            return;
+        }
+
         // Basic arithmetic operations
         bool isFloat = L->getType()->isFloatingPointTy();
 
@@ -690,7 +1777,7 @@ namespace flow {
                 currentValue = builder->CreateAShr(L, R, "ashr");
                 break;
             default:
-                std::cerr << "Unknown binary operator" << std::endl;
+                ErrorReporter::errors() << "Unknown binary operator" << std::endl;
                 currentValue = nullptr;
         }
     }
@@ -714,7 +1801,7 @@ namespace flow {
                 } else if (operand->getType()->isDoubleTy()) {
                     currentValue = builder->CreateFNeg(operand, "negtmp");
                 } else {
-                    std::cerr << "Cannot negate non-numeric type" << std::endl;
+                    ErrorReporter::errors() << "Cannot negate non-numeric type" << std::endl;
                     currentValue = nullptr;
                 }
                 break;
@@ -730,7 +1817,7 @@ namespace flow {
                                                                  "tobool");
                     currentValue = builder->CreateNot(boolVal, "nottmp");
                 } else {
-                    std::cerr << "Cannot apply NOT to non-boolean type" << std::endl;
+                    ErrorReporter::errors() << "Cannot apply NOT to non-boolean type" << std::endl;
                     currentValue = nullptr;
                 }
                 break;
@@ -739,24 +1826,22 @@ namespace flow {
                 if (operand->getType()->isIntegerTy()) {
                     currentValue = builder->CreateNot(operand, "bitnot");
                 } else {
-                    std::cerr << "Cannot apply bitwise NOT to non-integer type" << std::endl;
+                    ErrorReporter::errors() << "Cannot apply bitwise NOT to non-integer type" << std::endl;
                     currentValue = nullptr;
                 }
                 break;
             default:
-                std::cerr << "Unknown unary operator" << std::endl;
+                ErrorReporter::errors() << "Unknown unary operator" << std::endl;
                 currentValue = nullptr;
         }
     }
 
     void CodeGenerator::visit(CallExpr &node) {
         // Check if this is a lambda call (calling a function pointer stored in a variable)
-        if (auto *idExpr = dynamic_cast<IdentifierExpr *>(node.callee.get())) {
+        if (auto *idExpr = dyn_cast<IdentifierExpr>(node.callee)) {
             // Check if this identifier is a tracked lambda
-            auto lambdaIt = lambdaValues.find(idExpr->name);
-            if (lambdaIt != lambdaValues.end()) {
+            if (llvm::Function *lambdaFunc = lambdaValues.lookup(idExpr->name)) {
                 // This is a lambda call!
-                llvm::Function *lambdaFunc = lambdaIt->second;
                 
                 // Evaluate arguments
                 std::vector<llvm::Value *> args;
@@ -779,10 +1864,10 @@ namespace flow {
         
         // Get function name for regular function calls
         std::string funcName;
-        if (auto *idExpr = dynamic_cast<IdentifierExpr *>(node.callee.get())) {
+        if (auto *idExpr = dyn_cast<IdentifierExpr>(node.callee)) {
             funcName = idExpr->name;
         } else {
-            std::cerr << "Complex function calls not yet supported" << std::endl;
+            ErrorReporter::errors() << "Complex function calls not yet supported" << std::endl;
             currentValue = nullptr;
             return;
         }
@@ -790,68 +1875,111 @@ namespace flow {
         // Check if this is a foreign function call
         auto foreignIt = foreignFunctions.find(funcName);
         if (foreignIt != foreignFunctions.end()) {
+            // Look up the foreign function in the module
+            llvm::Function *foreignFunc = module->getFunction(funcName);
+            if (!foreignFunc) {
+                ErrorReporter::errors() << "Error: Foreign function '" << funcName << "' not declared in module" << std::endl;
+                currentValue = nullptr;
+                return;
+            }
 
-
-
-            // Evaluate arguments
+            // Evaluate arguments; strings cross into C as NUL-terminated
+            // pointers and arrays as a pointer to their elements
             std::vector<llvm::Value *> args;
             for (auto &arg: node.arguments) {
                 arg->accept(*this);
                 if (currentValue) {
+                    if (currentValue->getType() == stringType && args.size() < foreignFunc->arg_size() &&
+                        foreignFunc->getArg(args.size())->getType()->isPointerTy()) {
+                        currentValue = toCString(currentValue);
+                    } else if (isArrayType(arg->type)) {
+                        currentValue = arrayData(currentValue);
+                    }
                     args.push_back(currentValue);
                 }
             }
 
-            // Look up the foreign function in the module
-            llvm::Function *foreignFunc = module->getFunction(funcName);
-            if (!foreignFunc) {
-                std::cerr << "Error: Foreign function '" << funcName << "' not declared in module" << std::endl;
-                currentValue = nullptr;
-                return;
-            }
-
-
-
             if (foreignFunc->getReturnType()->isVoidTy()) {
                 builder->CreateCall(foreignFunc, args);
                 currentValue = nullptr;
             } else {
                 currentValue = builder->CreateCall(foreignFunc, args, funcName + "_result");
+                const Type *resultType = resolveTypeAlias(node.type);
+                if (resultType && resultType->kind == TypeKind::STRING && currentValue->getType()->isPointerTy()) {
+                    currentValue = fromCString(currentValue);
+                }
             }
             return;
         }
 
-        // Special handling for len() function
-        if (funcName == "len" && node.arguments.size() == 1) {
+        // Array builtins read and grow the header in place: len(array) and
+        // push(array, value)
+        if ((funcName == "len" && node.arguments.size() == 1) ||
+            (funcName == "push" && node.arguments.size() == 2)) {
+            const Type *arrayFlowType = node.arguments[0]->type;
+            if (!isArrayType(arrayFlowType)) {
+                ErrorReporter::errors() << "Error: " << funcName << " expects an array" << std::endl;
+                currentValue = nullptr;
+                return;
+            }
+
             node.arguments[0]->accept(*this);
-            llvm::Value *arrayValue = currentValue;
+            llvm::Value *array = currentValue;
+            if (!array) {
+                return;
+            }
 
-            // If it's a variable, load it first
-            if (auto *idExpr = dynamic_cast<IdentifierExpr *>(node.arguments[0].get())) {
-                auto it = namedValues.find(idExpr->name);
-                if (it != namedValues.end()) {
-                    arrayValue = it->second; // Use the alloca pointer
-                }
+            if (funcName == "len") {
+                currentValue = arrayLength(array);
+                return;
             }
 
-            // Look up the length from our tracking map
-            auto lengthIt = arrayLengths.find(arrayValue);
-            if (lengthIt != arrayLengths.end()) {
-                currentValue = llvm::ConstantInt::get(*context, llvm::APInt(32, lengthIt->second));
+            node.arguments[1]->accept(*this);
+            if (!currentValue) {
                 return;
-            } else {
+            }
+            if (currentValue->getType() != arrayElementType(arrayFlowType)) {
+                ErrorReporter::errors() << "Error: push value doesn't match the array's element type" << std::endl;
+                currentValue = nullptr;
+                return;
+            }
+            pushElement(array, currentValue, resolveTypeAlias(arrayFlowType)->typeParams[0]);
+            currentValue = nullptr;
+            return;
+        }
 
-                std::cerr << "Warning: Array length not tracked for len() call" << std::endl;
-                currentValue = llvm::ConstantInt::get(*context, llvm::APInt(32, 0));
+        // String builtins work on the length-carrying value directly:
+        // strlen reads the length, substr is a slice without a copy
+        if ((funcName == "strlen" && node.arguments.size() == 1) ||
+            (funcName == "substr" && node.arguments.size() == 3) ||
+            (funcName == "concat" && node.arguments.size() == 2)) {
+            std::vector<llvm::Value *> args;
+            for (auto &arg: node.arguments) {
+                arg->accept(*this);
+                if (!currentValue) {
+                    return;
+                }
+                args.push_back(currentValue);
+            }
+            if (args[0]->getType() != stringType || (funcName == "concat" && args[1]->getType() != stringType)) {
+                ErrorReporter::errors() << "Error: " << funcName << " expects string arguments" << std::endl;
+                currentValue = nullptr;
                 return;
             }
+
+            if (funcName == "strlen") {
+                currentValue = builder->CreateTrunc(builder->CreateExtractValue(args[0], 1),
+                                                    llvm::Type::getInt32Ty(*context), "strlen");
+            } else if (funcName == "substr") {
+                currentValue = callStringRuntime("flow_string_substr", {args[0]}, {args[1], args[2]});
+            } else {
+                currentValue = callStringRuntime("flow_string_concat", {args[0], args[1]});
+            }
+            return;
         }
 
         // Map Flow stdlib names to C++ mangled names
-        static std::map<std::string, std::string> stdlibMap = {
-            {"strlen", "_ZN4flow6stdlib11strlen_implEPKc"},
-            {"substr", "_ZN4flow6stdlib11substr_implEPKcii"},
-            {"concat", "_ZN4flow6stdlib11concat_implEPKcS2_"},
+        static const std::map<std::string, std::string> stdlibMap = {
             {"abs", "_ZN4flow6stdlib8abs_implEi"},
             {"sqrt", "_ZN4flow6stdlib9sqrt_implEd"},
             {"pow", "_ZN4flow6stdlib8pow_implEdd"},
@@ -864,31 +1992,54 @@ namespace flow {
         };
 
         std::string lookupName = funcName;
-        if (stdlibMap.find(funcName) != stdlibMap.end()) {
-            lookupName = stdlibMap[funcName];
+        auto stdlibIt = stdlibMap.find(funcName);
+        if (stdlibIt != stdlibMap.end()) {
+            lookupName = stdlibIt->second;
         }
 
         // Look up the function
         llvm::Function *function = module->getFunction(lookupName);
         if (!function) {
-            std::cerr << "Unknown function: " << funcName << std::endl;
+            ErrorReporter::errors() << "Unknown function: " << funcName << std::endl;
             currentValue = nullptr;
             return;
         }
 
+        // C builtins that treat a string as raw memory get its bytes in place.
+        // The writers change the text of their first argument, so a string
+        // variable passed there is measured again afterwards.
+        static const std::set<std::string> rawMemoryArguments = {
+            "free", "realloc", "memcpy", "memset", "memmove", "memcmp", "strcpy", "strcat"
+        };
+        static const std::set<std::string> rawMemoryWriters = {
+            "memcpy", "memset", "memmove", "strcpy", "strcat"
+        };
+
         // Evaluate arguments and convert types if needed
         std::vector<llvm::Value *> args;
+        std::vector<llvm::Value *> argValues; // as Flow values, before conversion
         unsigned paramIdx = 0;
         for (auto &arg: node.arguments) {
             arg->accept(*this);
             if (currentValue) {
+                argValues.push_back(currentValue);
                 // Check if we need to convert the argument type
                 if (paramIdx < function->arg_size()) {
                     llvm::Type *paramType = function->getArg(paramIdx)->getType();
                     llvm::Type *argType = currentValue->getType();
                     
+                    // A string passed to a C function
+                    if (argType == stringType && paramType->isPointerTy()) {
+                        currentValue = rawMemoryArguments.count(funcName)
+                                           ? builder->CreateExtractValue(currentValue, 0, "data")
+                                           : toCString(currentValue);
+                    }
+                    // An array's elements as raw memory
+                    else if (isArrayType(arg->type) && rawMemoryArguments.count(funcName)) {
+                        currentValue = arrayData(currentValue);
+                    }
                     // Convert i32 to i64 if needed (for size_t parameters)
-                    if (argType->isIntegerTy(32) && paramType->isIntegerTy(64)) {
+                    else if (argType->isIntegerTy(32) && paramType->isIntegerTy(64)) {
                         currentValue = builder->CreateZExt(currentValue, paramType, "argconv");
                     }
                     // Convert i64 to i32 if needed
@@ -906,6 +2057,37 @@ namespace flow {
             currentValue = builder->CreateCall(function, args);
         } else {
             currentValue = builder->CreateCall(function, args, "calltmp");
+
+            // A char pointer from C becoming a Flow string. A new buffer
+            // holds no text yet, and a reallocated one keeps what fits of
+            // the old string; both get a NUL so C sees the buffer itself.
+            const Type *resultType = resolveTypeAlias(node.type);
+            if (resultType && resultType->kind == TypeKind::STRING && currentValue->getType()->isPointerTy()) {
+                llvm::Type *int64Type = llvm::Type::getInt64Ty(*context);
+                llvm::Function *fromBuffer = module->getFunction("flow_string_from_buffer");
+                llvm::Value *none = llvm::ConstantInt::get(int64Type, 0);
+                if (funcName == "malloc" && args.size() == 1) {
+                    currentValue = builder->CreateCall(fromBuffer, {currentValue, args[0], none}, "str");
+                } else if (funcName == "calloc" && args.size() == 2) {
+                    llvm::Value *size = builder->CreateMul(args[0], args[1], "size");
+                    currentValue = builder->CreateCall(fromBuffer, {currentValue, size, none}, "str");
+                } else if (funcName == "realloc" && args.size() == 2 && argValues[0]->getType() == stringType) {
+                    llvm::Value *kept = builder->CreateExtractValue(argValues[0], 1, "len");
+                    currentValue = builder->CreateCall(fromBuffer, {currentValue, args[1], kept}, "str");
+                } else {
+                    currentValue = fromCString(currentValue);
+                }
+            }
+        }
+
+        if (rawMemoryWriters.count(funcName) && !node.arguments.empty() && !argValues.empty() &&
+            argValues[0]->getType() == stringType) {
+            auto *target = dyn_cast<IdentifierExpr>(node.arguments[0]);
+            llvm::Value *variable = target ? namedValues.lookup(target->name) : nullptr;
+            if (variable) {
+                llvm::Value *data = builder->CreateExtractValue(argValues[0], 0, "data");
+                builder->CreateStore(fromCString(data), variable);
+            }
         }
     }
 
@@ -916,7 +2098,7 @@ namespace flow {
 
         // Get the struct type
         if (!node.object->type || node.object->type->kind != TypeKind::STRUCT) {
-            std::cerr << "Member access on non-struct type" << std::endl;
+            ErrorReporter::errors() << "Member access on non-struct type" << std::endl;
             currentValue = nullptr;
             return;
         }
@@ -925,7 +2107,7 @@ namespace flow {
 
         // Look up the struct type
         if (structTypes.find(structName) == structTypes.end()) {
-            std::cerr << "Unknown struct type: " << structName << std::endl;
+            ErrorReporter::errors() << "Unknown struct type: " << structName << std::endl;
             currentValue = nullptr;
             return;
         }
@@ -942,7 +2124,7 @@ namespace flow {
         }
 
         if (fieldIndex == -1) {
-            std::cerr << "Unknown field: " << node.member << " in struct " << structName << std::endl;
+            ErrorReporter::errors() << "Unknown field: " << node.member << " in struct " << structName << std::endl;
             currentValue = nullptr;
             return;
         }
@@ -964,7 +2146,7 @@ namespace flow {
         // Look up struct type
         auto it = structTypes.find(node.structName);
         if (it == structTypes.end()) {
-            std::cerr << "Error: Unknown struct type: " << node.structName << std::endl;
+            ErrorReporter::errors() << "Error: Unknown struct type: " << node.structName << std::endl;
             currentValue = nullptr;
             return;
         }
@@ -972,7 +2154,7 @@ namespace flow {
         llvm::StructType *structType = it->second;
 
         // Allocate struct on stack
-        llvm::AllocaInst *structAlloca = builder->CreateAlloca(structType, nullptr, "struct");
+        llvm::AllocaInst *structAlloca = createEntryAlloca(structType, "struct");
 
         // Initialize fields
         auto &fieldIndices = structFieldIndices[node.structName];
@@ -993,33 +2175,27 @@ namespace flow {
     }
 
     void CodeGenerator::visit(ArrayLiteralExpr &node) {
-        // Get element type from node type
-        llvm::Type *elemType = nullptr;
-        if (node.type && !node.type->typeParams.empty()) {
-            elemType = getLLVMType(node.type->typeParams[0]);
-        } else {
-            elemType = llvm::Type::getInt32Ty(*context); // Default to int
-        }
-
-        // Allocate array on the stack
-        int arrayLength = static_cast<int>(node.elements.size());
-        llvm::Value *arraySize = llvm::ConstantInt::get(*context, llvm::APInt(32, arrayLength));
-        llvm::AllocaInst *array = builder->CreateAlloca(elemType, arraySize, "array");
-
-        // Track array length for len() function
-        arrayLengths[array] = arrayLength;
-
-        // Initialize array elements
+        llvm::Type *elemType = arrayElementType(node.type);
+        llvm::Type *int64Type = llvm::Type::getInt64Ty(*context);
+
+        // The header and elements go in the current region, like a string
+        // built here, and are kept the same way if the array is returned
+        llvm::Value *array = builder->CreateCall(module->getFunction("flow_array_new"), {
+                                                     llvm::ConstantExpr::getSizeOf(elemType),
+                                                     llvm::ConstantInt::get(int64Type, node.elements.size())
+                                                 }, "array");
+
+        // Initialize array elements; each lives in this region or a lower
+        // one, so it outlives the array without being kept
+        llvm::Value *data = node.elements.empty() ? nullptr : arrayData(array);
         for (size_t i = 0; i < node.elements.size(); i++) {
             if (node.elements[i]) {
                 node.elements[i]->accept(*this);
                 llvm::Value *elemValue = currentValue;
-
-                // Calculate element pointer
-                llvm::Value *indices[] = {llvm::ConstantInt::get(*context, llvm::APInt(32, i))};
-                llvm::Value *elemPtr = builder->CreateGEP(elemType, array, indices, "elemptr");
-
-                // Store element value
+                if (!elemValue) {
+                    continue;
+                }
+                llvm::Value *elemPtr = builder->CreateConstInBoundsGEP1_64(elemType, data, i, "elemptr");
                 builder->CreateStore(elemValue, elemPtr);
             }
         }
@@ -1028,88 +2204,26 @@ namespace flow {
     }
 
     void CodeGenerator::visit(IndexExpr &node) {
-        // Generate code for the array
+        // Generate code for the array and the index
         node.array->accept(*this);
-        llvm::Value *arrayPtr = currentValue;
-
-        // If it's a variable reference, get the alloca for bounds checking
-        llvm::Value *arrayAlloca = arrayPtr;
-        if (auto *idExpr = dynamic_cast<IdentifierExpr *>(node.array.get())) {
-            auto it = namedValues.find(idExpr->name);
-            if (it != namedValues.end()) {
-                arrayAlloca = it->second;
-            }
-        }
-
-        // Generate code for the index
+        llvm::Value *array = currentValue;
         node.index->accept(*this);
         llvm::Value *indexValue = currentValue;
-
-        // Array bounds checking
-        auto lengthIt = arrayLengths.find(arrayAlloca);
-        if (lengthIt != arrayLengths.end()) {
-            int arrayLength = lengthIt->second;
-            llvm::Value *lengthValue = llvm::ConstantInt::get(*context, llvm::APInt(32, arrayLength));
-
-            // Check if index < 0
-            llvm::Value *isNegative = builder->CreateICmpSLT(
-                indexValue, llvm::ConstantInt::get(*context, llvm::APInt(32, 0)), "isneg");
-
-            // Check if index >= length
-            llvm::Value *isTooLarge = builder->CreateICmpSGE(indexValue, lengthValue, "istoolarge");
-
-            // Combine checks: out of bounds = negative OR too large
-            llvm::Value *isOutOfBounds = builder->CreateOr(isNegative, isTooLarge, "oob");
-
-            // Create basic blocks for the bounds check
-            llvm::Function *currentFunc = builder->GetInsertBlock()->getParent();
-            llvm::BasicBlock *trapBlock = llvm::BasicBlock::Create(*context, "trap", currentFunc);
-            llvm::BasicBlock *okBlock = llvm::BasicBlock::Create(*context, "indexok", currentFunc);
-
-            // Branch based on bounds check
-            builder->CreateCondBr(isOutOfBounds, trapBlock, okBlock);
-
-            // Trap block: abort execution
-            builder->SetInsertPoint(trapBlock);
-
-            // Print error message using printf
-            llvm::Function *printfFunc = module->getFunction("printf");
-            if (printfFunc) {
-                llvm::Value *errorMsg = builder->CreateGlobalString("Runtime Error: Array index out of bounds!\n",
-                                                                     "errmsg");
-                builder->CreateCall(printfFunc, {errorMsg});
-            }
-
-            // Call trap intrinsic to abort
-            llvm::Function *trapFunc = llvm::Intrinsic::getDeclaration(module.get(), llvm::Intrinsic::trap);
-            builder->CreateCall(trapFunc);
-            builder->CreateUnreachable();
-
-            // Continue in OK block
-            builder->SetInsertPoint(okBlock);
+        if (!array || !indexValue) {
+            currentValue = nullptr;
+            return;
         }
 
         // Get element type
-        llvm::Type *elemType = nullptr;
-        if (node.type) {
-            elemType = getLLVMType(node.type);
-        } else if (node.array->type && !node.array->type->typeParams.empty()) {
-            elemType = getLLVMType(node.array->type->typeParams[0]);
-        } else {
-            elemType = llvm::Type::getInt32Ty(*context);
-        }
+        llvm::Type *elemType = node.type ? getLLVMType(node.type) : arrayElementType(node.array->type);
 
-        // Calculate element pointer using GEP
-        llvm::Value *indices[] = {indexValue};
-        llvm::Value *elemPtr = builder->CreateGEP(elemType, arrayPtr, indices, "indexptr");
-
-        // Load the element value
+        // Bounds-checked against the length at run time, then loaded
+        llvm::Value *elemPtr = arrayElement(array, indexValue, elemType);
         currentValue = builder->CreateLoad(elemType, elemPtr, "indexval");
     }
 
     void CodeGenerator::visit(LambdaExpr &node) {
-        // Generate a unique name for the lambda function
-        static int lambdaCounter = 0;
+        // Generate a unique name for the lambda function (internal linkage, so per-module is enough)
         std::string lambdaName = "__lambda_" + std::to_string(lambdaCounter++);
 
         // Build parameter types
@@ -1132,18 +2246,16 @@ namespace flow {
             module.get()
         );
 
-        // Save current insertion point, named values, and lambda values
+        // Save current insertion point
         llvm::BasicBlock *savedInsertBlock = builder->GetInsertBlock();
-        auto savedNamedValues = namedValues;
-        auto savedLambdaValues = lambdaValues;
 
         // Create entry block for the lambda
         llvm::BasicBlock *entryBlock = llvm::BasicBlock::Create(*context, "entry", lambdaFunc);
         builder->SetInsertPoint(entryBlock);
 
-        // Clear named values and lambda values for the lambda's scope
-        namedValues.clear();
-        lambdaValues.clear();
+        // The lambda can't see the enclosing function's variables
+        namedValues.pushScope(true);
+        lambdaValues.pushScope(true);
 
         // Set up parameters
         unsigned idx = 0;
@@ -1154,12 +2266,16 @@ namespace flow {
             // Create alloca for the parameter
             llvm::AllocaInst *alloca = builder->CreateAlloca(arg.getType(), nullptr, param.name);
             builder->CreateStore(&arg, alloca);
-            namedValues[param.name] = alloca;
+            namedValues.insert(param.name, alloca);
             
             idx++;
         }
 
-        // Generate code for the lambda body
+        // Generate code for the lambda body, in a region of its own
+        llvm::Value *enclosingRegion = functionRegion;
+        const Type *enclosingReturnType = functionReturnType;
+        functionRegion = enterRegion(node.body, false);
+        functionReturnType = node.returnType;
         for (auto &stmt : node.body) {
             if (stmt) {
                 stmt->accept(*this);
@@ -1169,22 +2285,24 @@ namespace flow {
         // If there's no explicit return and return type is void, add a void return
         if (!builder->GetInsertBlock()->getTerminator()) {
             if (returnType->isVoidTy()) {
-                builder->CreateRetVoid();
+                createReturn(nullptr);
             } else {
                 // Return a default value
                 if (returnType->isIntegerTy()) {
-                    builder->CreateRet(llvm::ConstantInt::get(returnType, 0));
+                    createReturn(llvm::ConstantInt::get(returnType, 0));
                 } else if (returnType->isFloatingPointTy()) {
-                    builder->CreateRet(llvm::ConstantFP::get(returnType, 0.0));
+                    createReturn(llvm::ConstantFP::get(returnType, 0.0));
                 } else {
-                    builder->CreateRet(llvm::Constant::getNullValue(returnType));
+                    createReturn(llvm::Constant::getNullValue(returnType));
                 }
             }
         }
 
         // Restore previous context
-        namedValues = savedNamedValues;
-        lambdaValues = savedLambdaValues;
+        functionRegion = enclosingRegion;
+        functionReturnType = enclosingReturnType;
+        namedValues.popScope();
+        lambdaValues.popScope();
         if (savedInsertBlock) {
             builder->SetInsertPoint(savedInsertBlock);
         }
@@ -1216,11 +2334,12 @@ namespace flow {
         }
 
         if (!varType) {
-            std::cerr << "Error: Cannot determine type for variable: " << node.name << std::endl;
+            ErrorReporter::errors() << "Error: Cannot determine type for variable: " << node.name << std::endl;
             return;
         }
 
-        llvm::AllocaInst *alloca = builder->CreateAlloca(varType, nullptr, node.name);
+        // In the entry block, so a declaration in a loop reuses one slot
+        llvm::AllocaInst *alloca = createEntryAlloca(varType, node.name);
 
         if (node.initializer) {
             // If we already evaluated it for type inference, use that value
@@ -1233,26 +2352,21 @@ namespace flow {
                 // Check if this is a lambda (function pointer)
                 if (auto *lambdaFunc = llvm::dyn_cast<llvm::Function>(initValue)) {
                     // Track this as a lambda variable
-                    lambdaValues[node.name] = lambdaFunc;
+                    lambdaValues.insert(node.name, lambdaFunc);
                 }
                 
                 builder->CreateStore(initValue, alloca);
-
-                // If the initializer was an array, track its length for this variable
-                if (arrayLengths.find(initValue) != arrayLengths.end()) {
-                    arrayLengths[alloca] = arrayLengths[initValue];
-                }
             }
         }
 
-        namedValues[node.name] = alloca;
+        namedValues.insert(node.name, alloca);
     }
 
     void CodeGenerator::visit(AssignmentStmt &node) {
         // Look up the variable
-        auto it = namedValues.find(node.target);
-        if (it == namedValues.end()) {
-            std::cerr << "Error: Undefined variable in assignment: " << node.target << std::endl;
+        llvm::Value *variable = namedValues.lookup(node.target);
+        if (!variable) {
+            ErrorReporter::errors() << "Error: Undefined variable in assignment: " << node.target << std::endl;
             currentValue = nullptr;
             return;
         }
@@ -1261,7 +2375,12 @@ namespace flow {
         if (node.value) {
             node.value->accept(*this);
             if (currentValue) {
-                builder->CreateStore(currentValue, it->second);
+                // A variable from outside the loop outlives the iteration
+                auto escaping = loopAssignmentMarks.find(&node);
+                if (escaping != loopAssignmentMarks.end()) {
+                    currentValue = keepValue(currentValue, node.value->type, escaping->second);
+                }
+                builder->CreateStore(currentValue, variable);
             }
         }
     }
@@ -1269,9 +2388,9 @@ namespace flow {
     void CodeGenerator::visit(ReturnStmt &node) {
         if (node.value) {
             node.value->accept(*this);
-            builder->CreateRet(currentValue);
+            createReturn(currentValue);
         } else {
-            builder->CreateRetVoid();
+            createReturn(nullptr);
         }
     }
 
@@ -1343,75 +2462,102 @@ namespace flow {
 
     void CodeGenerator::visit(ForStmt &node) {
         llvm::Function *function = builder->GetInsertBlock()->getParent();
-
-        // For now, only handle range-based for loops (i in start..end)
-        if (auto *rangeExpr = dynamic_cast<BinaryExpr *>(node.iterable.get())) {
+        llvm::Type *int32Type = llvm::Type::getInt32Ty(*context);
+
+        // Range loops (i in start..end) and array loops (item in array). The
+        // parser splits a range into rangeStart and rangeEnd; an iterable
+        // that is itself a `..` expression is a range too.
+        Expr *rangeStart = node.rangeStart;
+        Expr *rangeEnd = node.rangeEnd;
+        if (auto *rangeExpr = llvm::dyn_cast_if_present<BinaryExpr>(node.iterable)) {
             if (rangeExpr->op == TokenType::DOUBLE_DOT) {
-                // Create loop variable
-                llvm::AllocaInst *loopVar = builder->CreateAlloca(
-                    llvm::Type::getInt32Ty(*context), nullptr, node.iteratorVar);
-
-                // Evaluate start value
-                rangeExpr->left->accept(*this);
-                llvm::Value *startVal = currentValue;
-                builder->CreateStore(startVal, loopVar);
-
-                // Evaluate end value
-                rangeExpr->right->accept(*this);
-                llvm::Value *endVal = currentValue;
-
-                // Create loop blocks
-                llvm::BasicBlock *loopBB = llvm::BasicBlock::Create(*context, "loop", function);
-                llvm::BasicBlock *bodyBB = llvm::BasicBlock::Create(*context, "loopbody", function);
-                llvm::BasicBlock *afterBB = llvm::BasicBlock::Create(*context, "afterloop", function);
-
-                // Branch to loop
-                builder->CreateBr(loopBB);
-
-                // Loop condition block
-                builder->SetInsertPoint(loopBB);
-                llvm::Value *currentVal = builder->CreateLoad(
-                    llvm::Type::getInt32Ty(*context), loopVar, "loopvar");
-                llvm::Value *cond = builder->CreateICmpSLT(currentVal, endVal, "loopcond");
-                builder->CreateCondBr(cond, bodyBB, afterBB);
-
-                // Loop body
-                builder->SetInsertPoint(bodyBB);
-
-                // Add loop variable to scope
-                auto oldVal = namedValues[node.iteratorVar];
-                namedValues[node.iteratorVar] = loopVar;
-
-                // Generate body
-                for (auto &stmt: node.body) {
-                    if (stmt) {
-                        stmt->accept(*this);
-                    }
-                }
+                rangeStart = rangeExpr->left;
+                rangeEnd = rangeExpr->right;
+            }
+        }
 
-                // Increment loop variable
-                llvm::Value *stepVal = llvm::ConstantInt::get(*context, llvm::APInt(32, 1));
-                llvm::Value *nextVal = builder->CreateAdd(currentVal, stepVal, "nextvar");
-                builder->CreateStore(nextVal, loopVar);
+        llvm::Value *array = nullptr;
+        if (!(rangeStart && rangeEnd)) {
+            if (!node.iterable || !isArrayType(node.iterable->type)) {
+                ErrorReporter::errors() << "For loops iterate over a range (i in 0..10) or an array" << std::endl;
+                return;
+            }
+            node.iterable->accept(*this);
+            array = currentValue;
+            if (!array) {
+                return;
+            }
+        }
 
-                // Branch back to loop condition
-                builder->CreateBr(loopBB);
+        // Create the counter: the loop variable of a range, or the index of
+        // an array loop, which runs to the length it had on entry
+        llvm::AllocaInst *counter = createEntryAlloca(int32Type, array ? "index" : node.iteratorVar);
+        llvm::Value *endVal = nullptr;
+        if (array) {
+            builder->CreateStore(llvm::ConstantInt::get(int32Type, 0), counter);
+            endVal = arrayLength(array);
+        } else {
+            rangeStart->accept(*this);
+            builder->CreateStore(currentValue, counter);
+            rangeEnd->accept(*this);
+            endVal = currentValue;
+        }
 
-                // Restore old variable if it existed
-                if (oldVal) {
-                    namedValues[node.iteratorVar] = oldVal;
-                } else {
-                    namedValues.erase(node.iteratorVar);
-                }
+        // Create loop blocks
+        llvm::BasicBlock *loopBB = llvm::BasicBlock::Create(*context, "loop", function);
+        llvm::BasicBlock *bodyBB = llvm::BasicBlock::Create(*context, "loopbody", function);
+        llvm::BasicBlock *afterBB = llvm::BasicBlock::Create(*context, "afterloop", function);
 
-                // Continue after loop
-                builder->SetInsertPoint(afterBB);
-            } else {
-                std::cerr << "Only range-based for loops are supported (i in 0..10)" << std::endl;
-            }
+        // Branch to loop
+        builder->CreateBr(loopBB);
+
+        // Loop condition block
+        builder->SetInsertPoint(loopBB);
+        llvm::Value *currentVal = builder->CreateLoad(int32Type, counter, "loopvar");
+        llvm::Value *cond = builder->CreateICmpSLT(currentVal, endVal, "loopcond");
+        builder->CreateCondBr(cond, bodyBB, afterBB);
+
+        // Loop body
+        builder->SetInsertPoint(bodyBB);
+
+        // Add loop variable to scope
+        namedValues.pushScope();
+        lambdaValues.pushScope();
+        if (array) {
+            // The body may push, which can move the elements, so the data
+            // pointer is reloaded each iteration; the index is in bounds
+            llvm::Type *elemType = arrayElementType(node.iterable->type);
+            llvm::AllocaInst *item = createEntryAlloca(elemType, node.iteratorVar);
+            llvm::Value *elemPtr = builder->CreateInBoundsGEP(elemType, arrayData(array), currentVal, "elemptr");
+            builder->CreateStore(builder->CreateLoad(elemType, elemPtr, "item"), item);
+            namedValues.insert(node.iteratorVar, item);
         } else {
-            std::cerr << "Only range-based for loops are supported" << std::endl;
+            namedValues.insert(node.iteratorVar, counter);
+        }
+
+        // Generate body, releasing its strings every iteration
+        llvm::Value *iterationRegion = enterRegion(node.body, true);
+        for (auto &stmt: node.body) {
+            if (stmt) {
+                stmt->accept(*this);
+            }
+        }
+        leaveLoopRegion(iterationRegion);
+
+        // Increment the counter and branch back to the condition
+        if (!builder->GetInsertBlock()->getTerminator()) {
+            llvm::Value *stepVal = llvm::ConstantInt::get(int32Type, 1);
+            llvm::Value *nextVal = builder->CreateAdd(currentVal, stepVal, "nextvar");
+            builder->CreateStore(nextVal, counter);
+            builder->CreateBr(loopBB);
         }
+
+        // Drop the loop variable, restoring any it shadowed
+        namedValues.popScope();
+        lambdaValues.popScope();
+
+        // Continue after loop
+        builder->SetInsertPoint(afterBB);
     }
 
     void CodeGenerator::visit(WhileStmt &node) {
@@ -1425,9 +2571,20 @@ namespace flow {
         // Branch to condition
         builder->CreateBr(condBB);
 
-        // Condition block
+        // Condition block. Strings the condition builds are released before
+        // the branch, as it runs once per iteration and keeps none of them.
         builder->SetInsertPoint(condBB);
         if (node.condition) {
+            bool conditionBuilds = false;
+            auto visit = [&](Expr *expr) {
+                conditionBuilds |= allocatesString(expr);
+            };
+            forEachExpr(node.condition, visit);
+            llvm::Value *conditionRegion = stringRegions && conditionBuilds
+                                               ? builder->CreateCall(module->getFunction("flow_region_enter"), {},
+                                                                     "region")
+                                               : nullptr;
+
             node.condition->accept(*this);
             llvm::Value *condVal = currentValue;
 
@@ -1437,18 +2594,21 @@ namespace flow {
                                                 llvm::ConstantInt::get(condVal->getType(), 0), "whilecond");
             }
 
+            leaveRegion(conditionRegion);
             builder->CreateCondBr(condVal, bodyBB, afterBB);
         } else {
             builder->CreateBr(afterBB);
         }
 
-        // Body block
+        // Body block, releasing its strings every iteration
         builder->SetInsertPoint(bodyBB);
+        llvm::Value *iterationRegion = enterRegion(node.body, true);
         for (auto &stmt: node.body) {
             if (stmt) {
                 stmt->accept(*this);
             }
         }
+        leaveLoopRegion(iterationRegion);
 
         // Branch back to condition
         builder->CreateBr(condBB);
@@ -1466,18 +2626,12 @@ namespace flow {
     }
 
     void CodeGenerator::visit(FunctionDecl &node) {
+        llvm::TimeTraceScope timeScope("CodegenFunction", node.name);
         llvm::FunctionType *FT = getFunctionType(node);
 
         // For multi-file compilation, all functions need external linkage
-        // so they can be called from other modules
-        llvm::Function::LinkageTypes linkage = llvm::Function::ExternalLinkage;
-
-        llvm::Function *F = llvm::Function::Create(
-            FT,
-            linkage,
-            node.name,
-            module.get()
-        );
+        // so they can be called from other modules (createFunction uses it)
+        llvm::Function *F = createFunction(FT, node.name);
 
         // Set parameter names
         unsigned idx = 0;
@@ -1490,14 +2644,18 @@ namespace flow {
         builder->SetInsertPoint(BB);
 
         // Add function parameters to scope
-        namedValues.clear();
+        namedValues.pushScope(true);
+        lambdaValues.pushScope(true);
         for (auto &arg: F->args()) {
             llvm::AllocaInst *alloca = builder->CreateAlloca(arg.getType(), nullptr, arg.getName());
             builder->CreateStore(&arg, alloca);
-            namedValues[std::string(arg.getName())] = alloca;
+            namedValues.insert(std::string(arg.getName()), alloca);
         }
 
-        // Generate function body
+        // Generate function body; the strings and arrays it builds are
+        // released when it returns
+        functionRegion = enterRegion(node.body, false);
+        functionReturnType = node.returnType;
         for (auto &stmt: node.body) {
             if (stmt) {
                 stmt->accept(*this);
@@ -1507,19 +2665,24 @@ namespace flow {
         llvm::BasicBlock *currentBlock = builder->GetInsertBlock();
         if (currentBlock && !currentBlock->getTerminator()) {
             if (node.returnType->isVoid()) {
-                builder->CreateRetVoid();
+                createReturn(nullptr);
             } else {
                 // Fallback return for paths without explicit return
                 // Semantic analysis should catch missing returns; this ensures valid LLVM IR
-                builder->CreateRet(llvm::Constant::getNullValue(getLLVMType(node.returnType)));
+                createReturn(llvm::Constant::getNullValue(getLLVMType(node.returnType)));
             }
         }
+        functionRegion = nullptr;
+        functionReturnType = nullptr;
+
+        namedValues.popScope();
+        lambdaValues.popScope();
 
         // Verify function
         std::string errStr;
         llvm::raw_string_ostream err(errStr);
         if (llvm::verifyFunction(*F, &err)) {
-            std::cerr << "Function verification failed: " << errStr << std::endl;
+            ErrorReporter::errors() << "Function verification failed: " << errStr << std::endl;
         }
     }
 
@@ -1527,66 +2690,46 @@ namespace flow {
         // Create LLVM struct type
         std::vector<llvm::Type *> fieldTypes;
         std::map<std::string, int> fieldIndices;
+        std::vector<const Type *> fieldFlowTypes;
 
         int index = 0;
         for (const auto &field: node.fields) {
             fieldTypes.push_back(getLLVMType(field.type));
             fieldIndices[field.name] = index++;
+            fieldFlowTypes.push_back(field.type);
         }
 
         llvm::StructType *structType = llvm::StructType::create(*context, fieldTypes, node.name);
         structTypes[node.name] = structType;
         structFieldIndices[node.name] = fieldIndices;
+        structFieldTypes[node.name] = fieldFlowTypes;
+        llvmTypes.clear();
     }
 
     void CodeGenerator::visit(ImplDecl &node) {
         // Create function for the method (StructName_methodName)
         std::string mangledName = node.structName + "_" + node.methodName;
 
-        // Build parameter types (first parameter is 'this' pointer to struct)
-        std::vector<llvm::Type *> paramTypes;
-        
-        // Add 'this' parameter (pointer to struct)
-        if (structTypes.find(node.structName) != structTypes.end()) {
-            paramTypes.push_back(llvm::PointerType::get(*context, 0));
-        } else {
-            std::cerr << "Struct type not found: " << node.structName << std::endl;
+        llvm::FunctionType *funcType = getMethodType(node);
+        if (!funcType) {
+            ErrorReporter::errors() << "Struct type not found: " << node.structName << std::endl;
             return;
         }
-
-        // Add other parameters
-        for (const auto &param : node.parameters) {
-            paramTypes.push_back(getLLVMType(param.type));
-        }
-
-        // Determine return type
-        llvm::Type *returnType = getLLVMType(node.returnType);
-
-        // Create function type and function
-        llvm::FunctionType *funcType = llvm::FunctionType::get(returnType, paramTypes, false);
-        llvm::Function *func = llvm::Function::Create(
-            funcType,
-            llvm::Function::ExternalLinkage,
-            mangledName,
-            module.get()
-        );
+        llvm::Type *returnType = funcType->getReturnType();
+        llvm::Function *func = createFunction(funcType, mangledName);
 
         // Create entry block
         llvm::BasicBlock *entry = llvm::BasicBlock::Create(*context, "entry", func);
         builder->SetInsertPoint(entry);
 
-        // Save previous context
-        auto savedNamedValues = namedValues;
-        auto savedLambdaValues = lambdaValues;
-
-        // Clear for method scope
-        namedValues.clear();
-        lambdaValues.clear();
+        // The method body is its own scope
+        namedValues.pushScope(true);
+        lambdaValues.pushScope(true);
 
         // Set up 'this' parameter
         llvm::Argument *thisArg = func->arg_begin();
         thisArg->setName("this");
-        namedValues["this"] = thisArg;
+        namedValues.insert("this", thisArg);
 
         // Set up other parameters
         int argIdx = 1;
@@ -1597,11 +2740,13 @@ namespace flow {
             // Create alloca for parameter
             llvm::AllocaInst *alloca = builder->CreateAlloca(getLLVMType(param.type), nullptr, param.name);
             builder->CreateStore(arg, alloca);
-            namedValues[param.name] = alloca;
+            namedValues.insert(param.name, alloca);
             argIdx++;
         }
 
         // Generate method body
+        functionRegion = enterRegion(node.body, false);
+        functionReturnType = node.returnType;
         for (auto &stmt : node.body) {
             if (stmt) {
                 stmt->accept(*this);
@@ -1610,20 +2755,23 @@ namespace flow {
 
         // Add return if void and no explicit return
         if (returnType->isVoidTy() && (!builder->GetInsertBlock()->getTerminator())) {
-            builder->CreateRetVoid();
+            createReturn(nullptr);
         } else if (!builder->GetInsertBlock()->getTerminator()) {
             // Add default return value if missing
-            builder->CreateRet(llvm::Constant::getNullValue(returnType));
+            createReturn(llvm::Constant::getNullValue(returnType));
         }
+        functionRegion = nullptr;
+        functionReturnType = nullptr;
 
         // Restore context
-        namedValues = savedNamedValues;
-        lambdaValues = savedLambdaValues;
+        namedValues.popScope();
+        lambdaValues.popScope();
     }
 
     void CodeGenerator::visit(TypeDefDecl &node) {
         // Register type alias for type resolution
         typeAliases[node.name] = node.aliasedType;
+        llvmTypes.clear();
     }
 
     void CodeGenerator::visit(LinkDecl &node) {
@@ -1639,7 +2787,7 @@ namespace flow {
                 // Create LLVM function declaration with external linkage
                 // For C adapter, these will be resolved at link time
                 // For other adapters (Python, JS), these will go through IPC at runtime
-                llvm::FunctionType *FT = getFunctionType(*func);
+                llvm::FunctionType *FT = getForeignFunctionType(*func);
                 llvm::Function::Create(FT, llvm::Function::ExternalLinkage, func->name, module.get());
             }
         }
@@ -1662,31 +2810,7 @@ namespace flow {
     }
 
     std::string CodeGenerator::resolveModulePath(const std::string &importPath) {
-        namespace fs = std::filesystem;
-
-        if (fs::path(importPath).is_absolute()) {
-            return importPath;
-        }
-
-        // First try: resolve relative to current directory
-        fs::path fullPath = fs::path(currentDirectory) / importPath;
-
-        try {
-            return fs::canonical(fullPath).string();
-        } catch (const fs::filesystem_error &) {
-            // If that fails, try library paths
-            for (const auto &libPath : libraryPaths) {
-                fs::path libFullPath = fs::path(libPath) / importPath;
-                try {
-                    return fs::canonical(libFullPath).string();
-                } catch (const fs::filesystem_error &) {
-                    // Continue to next library path
-                }
-            }
-
-            // If all library paths fail, return the original path
-            return fullPath.string();
-        }
+        return ModuleGraph::resolveImport(importPath, currentDirectory, libraryPaths);
     }
 
     std::shared_ptr<Program> CodeGenerator::loadModule(const std::string &modulePath) {
@@ -1695,93 +2819,51 @@ namespace flow {
             return it->second;
         }
 
-        std::ifstream file(modulePath);
-        if (!file.is_open()) {
-            throw std::runtime_error("Failed to open module: " + modulePath);
+        // Shared with sema and the build driver, so this doesn't re-parse
+        auto unit = ModuleGraph::instance().load(modulePath);
+        if (!unit->program) {
+            throw std::runtime_error(unit->error);
         }
 
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string source = buffer.str();
-        file.close();
-
-        Lexer lexer(source, modulePath);
-        std::vector<Token> tokens = lexer.tokenize();
-
-        Parser parser(tokens);
-        auto program = parser.parse();
-
         // Don't add to processedModules here - done in processImportedModule
 
-        return program;
+        return unit->program;
     }
 
     void CodeGenerator::processImportedModule(const std::string &modulePath) {
         // Check if already processed to prevent circular imports
         if (processedModules.find(modulePath) != processedModules.end()) {
-            std::cerr << "[CODEGEN] Module already processed: " << modulePath << std::endl;
             return; // Already processed or currently being processed
         }
 
         try {
-            std::cerr << "[CODEGEN] Loading module: " << modulePath << std::endl;
             // Mark as being processed BEFORE loading to prevent infinite loops
             processedModules[modulePath] = nullptr;
 
-            // Load and parse the module
-            std::cerr << "[CODEGEN] Opening file..." << std::endl;
-            std::ifstream file(modulePath);
-            if (!file.is_open()) {
-                throw std::runtime_error("Failed to open module: " + modulePath);
-            }
-            std::cerr << "[CODEGEN] Reading file..." << std::endl;
-
-            std::stringstream buffer;
-            buffer << file.rdbuf();
-            std::string source = buffer.str();
-            file.close();
-            std::cerr << "[CODEGEN] File read, starting lexer..." << std::endl;
-
-            Lexer lexer(source, modulePath);
-            std::cerr << "[CODEGEN] Tokenizing..." << std::endl;
-            std::vector<Token> tokens = lexer.tokenize();
-            std::cerr << "[CODEGEN] Tokens: " << tokens.size() << ", starting parser..." << std::endl;
-
-            Parser parser(tokens);
-            std::cerr << "[CODEGEN] Parsing..." << std::endl;
-            auto program = parser.parse();
-            std::cerr << "[CODEGEN] Parsed successfully" << std::endl;
-
-            // Update with actual program
+            auto program = loadModule(modulePath);
             processedModules[modulePath] = program;
 
             // Generate full code for imported module
             // This works because we're doing it BEFORE generating main module code
-            std::cerr << "[CODEGEN] Generating code for " << program->declarations.size() << " items..." << std::endl;
             std::string savedDir = currentDirectory;
             currentDirectory = std::filesystem::path(modulePath).parent_path().string();
 
             for (auto &decl: program->declarations) {
-                if (decl && !dynamic_cast<ImportDecl *>(decl.get())) {
+                if (decl && !isa<ImportDecl>(decl)) {
                     decl->accept(*this);
                 }
             }
 
-            std::cerr << "[CODEGEN] Code generation complete for imported module" << std::endl;
             currentDirectory = savedDir;
         } catch (const std::exception &e) {
-            std::cerr << "Error loading module " << modulePath << ": " << e.what() << std::endl;
+            ErrorReporter::errors() << "Error loading module " << modulePath << ": " << e.what() << std::endl;
         }
     }
 
     void CodeGenerator::visit(ImportDecl &node) {
-        // Multi-file compilation note:
-        // For proper multi-file support, each Flow module should be compiled separately
-        // to an object file, then linked together. For now, imports are handled by
-        // semantic analysis, and imported symbols become external references.
-        std::cerr << "Note: Multi-file compilation is not fully supported yet." << std::endl;
-        std::cerr << "      Each module should be compiled separately and linked." << std::endl;
-        std::cerr << "      Import: " << node.modulePath << std::endl;
+        // Each module is compiled to its own object file. Imported functions are
+        // declared as externals by the build driver (declareExternalFunction) and
+        // resolved at link time.
         (void) node;
     }
 
@@ -1791,10 +2873,27 @@ namespace flow {
     }
 
     void CodeGenerator::visit(Program &node) {
+        // Types, aliases and foreign functions first, then a prototype for
+        // every function and method, so a body can call one defined further down
+        std::vector<Decl *> declarations;
+        std::vector<Decl *> bodies;
         for (auto &decl: node.declarations) {
-            if (decl) {
+            if (!decl) {
+                continue;
+            }
+            if (isa<FunctionDecl>(decl) || isa<ImplDecl>(decl)) {
+                bodies.push_back(decl);
+            } else {
+                declarations.push_back(decl);
                 decl->accept(*this);
             }
         }
+
+        for (Decl *decl: bodies) {
+            declarePrototype(*decl);
+        }
+        if (!generateBodies(declarations, bodies)) {
+            bodiesFailed = true;
+        }
     }
 } // namespace flow
\ No newline at end of file
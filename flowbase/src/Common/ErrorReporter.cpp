@@ -1,7 +1,6 @@
 #include "../../include/Common/ErrorReporter.h"
-#include <fstream>
+#include "../../include/Common/SourceManager.h"
 #include <iostream>
-#include <sstream>
 #include <iomanip>
 
 namespace flow
@@ -13,105 +12,120 @@ namespace flow
     const std::string COLOR_RESET = "\033[0m";
     const std::string COLOR_BOLD = "\033[1m";
 
+    namespace
+    {
+        thread_local std::ostream* threadOutput = nullptr;
+        thread_local std::ostream* threadErrors = nullptr;
+    }
+
+    std::ostream& ErrorReporter::output()
+    {
+        return threadOutput ? *threadOutput : std::cout;
+    }
+
+    std::ostream& ErrorReporter::errors()
+    {
+        return threadErrors ? *threadErrors : std::cerr;
+    }
+
+    void ErrorReporter::redirect(std::ostream* out, std::ostream* err)
+    {
+        threadOutput = out;
+        threadErrors = err;
+    }
+
     void ErrorReporter::loadSourceFile(const std::string& filename)
     {
-        if (sourceLines.find(filename) != sourceLines.end())
+        if (SourceManager::instance().lookup(filename))
         {
             return; // Already loaded
         }
 
-        std::ifstream file(filename);
-        if (!file.is_open())
-        {
-            std::cerr << "Warning: Could not open source file for error reporting: " << filename << std::endl;
-            return;
-        }
-
-        std::vector<std::string> lines;
-        std::string line;
-        while (std::getline(file, line))
+        if (!SourceManager::instance().loadFile(filename))
         {
-            lines.push_back(line);
+            errors() << "Warning: Could not open source file for error reporting: " << filename << std::endl;
         }
-
-        sourceLines[filename] = lines;
     }
 
     void ErrorReporter::showContext(const SourceLocation& loc)
     {
-        auto it = sourceLines.find(loc.filename);
-        if (it == sourceLines.end())
+        auto file = SourceManager::instance().getFile(loc.file);
+        if (!file)
         {
             return; // Source not loaded
         }
 
-        const auto& lines = it->second;
-        if (loc.line < 1 || loc.line > lines.size())
+        std::ostream& err = errors();
+        size_t lineCount = file->getLineCount();
+        if (loc.line < 1 || static_cast<size_t>(loc.line) > lineCount)
         {
             return;
         }
 
-        std::cerr << "\n";
+        err << "\n";
 
         // Show context line before (if exists)
         if (loc.line > 1)
         {
-            std::cerr << COLOR_BLUE << std::setw(5) << (loc.line - 1) << " | " << COLOR_RESET
-                << lines[loc.line - 2] << "\n";
+            err << COLOR_BLUE << std::setw(5) << (loc.line - 1) << " | " << COLOR_RESET
+                << file->getLine(loc.line - 1) << "\n";
         }
 
         // Show the error line
-        std::cerr << COLOR_BLUE << std::setw(5) << loc.line << " | " << COLOR_RESET
-            << lines[loc.line - 1] << "\n";
+        std::string_view errorLine = file->getLine(loc.line);
+        err << COLOR_BLUE << std::setw(5) << loc.line << " | " << COLOR_RESET
+            << errorLine << "\n";
 
         // Show the error indicator
-        std::cerr << COLOR_BLUE << "      | " << COLOR_RESET;
+        err << COLOR_BLUE << "      | " << COLOR_RESET;
         for (int i = 1; i < loc.column; i++)
         {
-            std::cerr << " ";
+            err << " ";
         }
-        std::cerr << COLOR_RED << COLOR_BOLD << "^" << COLOR_RESET;
+        err << COLOR_RED << COLOR_BOLD << "^" << COLOR_RESET;
 
         // Add the lil squiggly line for emphasis
         int endCol = loc.column + 3; // Show a few characters
-        if (endCol > lines[loc.line - 1].length())
+        if (endCol > static_cast<int>(errorLine.length()))
         {
-            endCol = lines[loc.line - 1].length();
+            endCol = static_cast<int>(errorLine.length());
         }
         for (int i = loc.column; i < endCol; i++)
         {
-            std::cerr << COLOR_RED << COLOR_BOLD << "~" << COLOR_RESET;
+            err << COLOR_RED << COLOR_BOLD << "~" << COLOR_RESET;
         }
-        std::cerr << "\n";
+        err << "\n";
 
         // Show context line after (if exists)
-        if (loc.line < lines.size())
+        if (static_cast<size_t>(loc.line) < lineCount)
         {
-            std::cerr << COLOR_BLUE << std::setw(5) << (loc.line + 1) << " | " << COLOR_RESET
-                << lines[loc.line] << "\n";
+            err << COLOR_BLUE << std::setw(5) << (loc.line + 1) << " | " << COLOR_RESET
+                << file->getLine(loc.line + 1) << "\n";
         }
 
-        std::cerr << "\n";
+        err << "\n";
     }
 
     void ErrorReporter::reportError(const std::string& type, const std::string& message, const SourceLocation& loc)
     {
-        std::cerr << "\n" << COLOR_RED << COLOR_BOLD << "error";
+        std::ostream& err = errors();
+        err << "\n" << COLOR_RED << COLOR_BOLD << "error";
         if (!type.empty())
         {
-            std::cerr << "[" << type << "]";
+            err << "[" << type << "]";
         }
-        std::cerr << ":" << COLOR_RESET << COLOR_BOLD << " " << message << COLOR_RESET << "\n";
-        std::cerr << COLOR_BLUE << "  --> " << COLOR_RESET << loc.filename << ":" << loc.line << ":" << loc.column;
+        err << ":" << COLOR_RESET << COLOR_BOLD << " " << message << COLOR_RESET << "\n";
+        err << COLOR_BLUE << "  --> " << COLOR_RESET << loc.getFilename() << ":" << loc.line << ":" << loc.column;
 
         showContext(loc);
     }
 
     void ErrorReporter::reportWarning(const std::string& message, const SourceLocation& loc)
     {
-        std::cerr << "\n" << COLOR_YELLOW << COLOR_BOLD << "warning:" << COLOR_RESET
+        std::ostream& err = errors();
+        err << "\n" << COLOR_YELLOW << COLOR_BOLD << "warning:" << COLOR_RESET
             << COLOR_BOLD << " " << message << COLOR_RESET << "\n";
-        std::cerr << COLOR_BLUE << "  --> " << COLOR_RESET << loc.filename << ":" << loc.line << ":" << loc.column;
+        err << COLOR_BLUE << "  --> " << COLOR_RESET << loc.getFilename() << ":" << loc.line << ":" << loc.column;
 
         showContext(loc);
     }
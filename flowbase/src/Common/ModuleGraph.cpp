@@ -0,0 +1,205 @@
+#include "../../include/Common/ModuleGraph.h"
+#include "../../include/Lexer/Lexer.h"
+#include "../../include/Parser/Parser.h"
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/xxhash.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <cstdlib>
+
+namespace flow
+{
+    namespace
+    {
+        // The coarsest mtime resolution in common use (FAT); a write this
+        // close to a stat may not have moved the file's mtime
+        constexpr std::chrono::seconds timestampTick(2);
+    } // namespace
+
+    bool ModuleGraph::stampFile(const std::string& path, FileStamp& stamp)
+    {
+        std::error_code ec;
+        stamp.modifiedTime = std::filesystem::last_write_time(path, ec);
+        struct stat st;
+        if (ec || stat(path.c_str(), &st) != 0)
+        {
+            return false;
+        }
+        stamp.size = static_cast<uintmax_t>(st.st_size);
+        stamp.inode = static_cast<uint64_t>(st.st_ino);
+        stamp.device = static_cast<uint64_t>(st.st_dev);
+        return true;
+    }
+
+    std::shared_ptr<ModuleGraph::Slot> ModuleGraph::getSlot(const std::string& path)
+    {
+        // One slot per file however it's named: the compile server changes
+        // directory for each client, so main.flow may be a different file
+        std::error_code ec;
+        std::string key = std::filesystem::weakly_canonical(path, ec).string();
+        if (ec || key.empty())
+        {
+            key = path;
+        }
+
+        std::lock_guard<std::mutex> lock(slotsMutex);
+        auto& slot = slots[key];
+        if (!slot)
+        {
+            slot = std::make_shared<Slot>();
+        }
+        return slot;
+    }
+
+    std::shared_ptr<ModuleUnit> ModuleGraph::parse(const std::string& path, std::shared_ptr<const SourceFile> file)
+    {
+        auto unit = std::make_shared<ModuleUnit>();
+        unit->path = path;
+        unit->file = file;
+        unit->source = file->getText();
+
+        try
+        {
+            // The parser pulls tokens from the lexer as it goes, so lexing is
+            // part of the parse span
+            llvm::TimeTraceScope timeScope("Parse", path);
+            Lexer lexer(*file);
+            Parser parser(lexer);
+            unit->program = parser.parse();
+            unit->tokenCount = parser.getTokenCount();
+            if (!unit->program)
+            {
+                unit->error = lexer.getError().empty() ? "Parsing failed" : "Lexical analysis failed";
+            }
+        }
+        catch (const std::exception& e)
+        {
+            unit->program = nullptr;
+            unit->error = e.what();
+        }
+
+        return unit;
+    }
+
+    std::shared_ptr<const ModuleUnit> ModuleGraph::load(const std::string& path)
+    {
+        auto slot = getSlot(path);
+        std::lock_guard<std::mutex> lock(slot->mutex);
+
+        if (slot->overlay)
+        {
+            return slot->unit;
+        }
+
+        auto stampTime = std::filesystem::file_time_type::clock::now();
+        FileStamp stamp;
+        bool stamped = stampFile(path, stamp);
+        bool sameStamp = slot->unit && stamped && stamp == slot->stamp;
+        if (sameStamp && !slot->racy)
+        {
+            return slot->unit;
+        }
+
+        // Mapped once; the lexer and diagnostics read the same text
+        std::string error;
+        auto file = SourceManager::instance().loadFile(path, &error);
+        if (!file)
+        {
+            auto unit = std::make_shared<ModuleUnit>();
+            unit->path = path;
+            unit->error = "Failed to open module: " + path + " (" + error + ")";
+            return unit; // not cached: the file may appear later
+        }
+
+        std::string_view text = file->getText();
+        uint64_t textHash = llvm::xxh3_64bits(llvm::StringRef(text.data(), text.size()));
+        slot->racy = !stamped || stamp.modifiedTime + timestampTick >= stampTime;
+        if (sameStamp && textHash == slot->textHash)
+        {
+            return slot->unit;
+        }
+
+        slot->unit = parse(path, file);
+        slot->stamp = stamp;
+        slot->textHash = textHash;
+        {
+            std::lock_guard<std::mutex> countLock(slotsMutex);
+            parses++;
+        }
+        return slot->unit;
+    }
+
+    void ModuleGraph::setOverlay(const std::string& path, std::shared_ptr<const SourceFile> file,
+                                 std::shared_ptr<Program> program)
+    {
+        auto unit = std::make_shared<ModuleUnit>();
+        unit->path = path;
+        unit->file = file;
+        unit->source = file->getText();
+        unit->program = program;
+        if (!program)
+        {
+            unit->error = "Parsing failed";
+        }
+
+        auto slot = getSlot(path);
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        slot->unit = unit;
+        slot->overlay = true;
+    }
+
+    void ModuleGraph::clearOverlay(const std::string& path)
+    {
+        auto slot = getSlot(path);
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (slot->overlay)
+        {
+            slot->overlay = false;
+            slot->unit = nullptr; // re-read from disk on next load
+        }
+    }
+
+    std::string ModuleGraph::resolveImport(const std::string& importPath, const std::string& fromDir,
+                                           const std::vector<std::string>& libraryPaths)
+    {
+        namespace fs = std::filesystem;
+
+        if (fs::path(importPath).is_absolute())
+        {
+            return importPath;
+        }
+
+        std::vector<fs::path> searchPaths = {fs::path(fromDir.empty() ? "." : fromDir)};
+        for (const auto& libPath : libraryPaths)
+        {
+            searchPaths.push_back(libPath);
+        }
+        if (const char* flowPath = std::getenv("FLOW_PATH"))
+        {
+            searchPaths.push_back(flowPath);
+        }
+        if (const char* home = std::getenv("HOME"))
+        {
+            searchPaths.push_back(fs::path(home) / ".river" / "packages");
+        }
+
+        for (const auto& searchPath : searchPaths)
+        {
+            std::error_code ec;
+            fs::path resolved = fs::canonical(searchPath / importPath, ec);
+            if (!ec)
+            {
+                return resolved.string();
+            }
+        }
+
+        // Not found anywhere; loading it will fail with this path in the message
+        return (searchPaths.front() / importPath).string();
+    }
+
+    size_t ModuleGraph::parseCount()
+    {
+        std::lock_guard<std::mutex> lock(slotsMutex);
+        return parses;
+    }
+} // namespace flow
@@ -0,0 +1,151 @@
+#include "../../include/Common/SourceManager.h"
+#include <algorithm>
+
+namespace flow
+{
+    SourceFile::SourceFile(FileID id, const std::string& path, std::unique_ptr<llvm::MemoryBuffer> buffer)
+        : id(id), path(path), buffer(std::move(buffer))
+    {
+    }
+
+    const std::vector<uint32_t>& SourceFile::lines() const
+    {
+        std::call_once(linesBuilt, [this]()
+        {
+            std::string_view text = getText();
+            lineOffsets.push_back(0);
+            for (size_t i = text.find('\n'); i != std::string_view::npos; i = text.find('\n', i + 1))
+            {
+                lineOffsets.push_back(static_cast<uint32_t>(i + 1));
+            }
+        });
+        return lineOffsets;
+    }
+
+    size_t SourceFile::getLineCount() const
+    {
+        const auto& offsets = lines();
+        // A trailing newline ends the last line rather than starting an empty one
+        if (offsets.size() > 1 && offsets.back() == getText().size())
+        {
+            return offsets.size() - 1;
+        }
+        return offsets.size();
+    }
+
+    std::string_view SourceFile::getLine(size_t line) const
+    {
+        if (line < 1 || line > getLineCount())
+        {
+            return std::string_view();
+        }
+
+        const auto& offsets = lines();
+        std::string_view text = getText();
+        size_t start = offsets[line - 1];
+        size_t end = line < offsets.size() ? offsets[line] - 1 : text.size();
+        if (end > start && text[end - 1] == '\r')
+        {
+            end--;
+        }
+        return text.substr(start, end - start);
+    }
+
+    size_t SourceFile::getOffset(size_t line, size_t column) const
+    {
+        if (line < 1)
+        {
+            return 0;
+        }
+        if (line > getLineCount())
+        {
+            return getText().size();
+        }
+
+        size_t start = lines()[line - 1];
+        size_t length = getLine(line).size();
+        return start + std::min(column > 0 ? column - 1 : 0, length);
+    }
+
+    std::pair<int, int> SourceFile::getLineAndColumn(size_t offset) const
+    {
+        const auto& offsets = lines();
+        auto next = std::upper_bound(offsets.begin(), offsets.end(), offset);
+        size_t line = static_cast<size_t>(next - offsets.begin());
+        return {static_cast<int>(line), static_cast<int>(offset - offsets[line - 1] + 1)};
+    }
+
+    FileID SourceManager::intern(const std::string& path)
+    {
+        auto it = ids.find(path);
+        if (it != ids.end())
+        {
+            return it->second;
+        }
+
+        paths.push_back(path);
+        current.push_back(nullptr);
+        FileID id = static_cast<FileID>(paths.size());
+        ids[path] = id;
+        return id;
+    }
+
+    std::shared_ptr<const SourceFile> SourceManager::add(const std::string& path,
+                                                         std::unique_ptr<llvm::MemoryBuffer> buffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        FileID id = intern(path);
+
+        // Replaces the previous version; whoever still holds that keeps it alive
+        std::shared_ptr<const SourceFile> file = std::make_shared<SourceFile>(id, path, std::move(buffer));
+        current[id - 1] = file;
+        return file;
+    }
+
+    std::shared_ptr<const SourceFile> SourceManager::loadFile(const std::string& path, std::string* error)
+    {
+        // Mapped rather than copied when the file is large enough for it to pay off
+        auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+        if (!buffer)
+        {
+            if (error)
+            {
+                *error = buffer.getError().message();
+            }
+            return nullptr;
+        }
+        return add(path, std::move(*buffer));
+    }
+
+    std::shared_ptr<const SourceFile> SourceManager::addBuffer(const std::string& path, std::string_view text)
+    {
+        return add(path, llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(text.data(), text.size()), path));
+    }
+
+    std::shared_ptr<const SourceFile> SourceManager::lookup(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ids.find(path);
+        return it != ids.end() ? current[it->second - 1] : nullptr;
+    }
+
+    std::shared_ptr<const SourceFile> SourceManager::getFile(FileID id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return id >= 1 && id <= current.size() ? current[id - 1] : nullptr;
+    }
+
+    FileID SourceManager::getFileID(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return intern(path);
+    }
+
+    const std::string& SourceManager::getPath(FileID id)
+    {
+        static const std::string none;
+        std::lock_guard<std::mutex> lock(mutex);
+        // Deque elements never move, so the reference outlives the lock
+        return id >= 1 && id <= paths.size() ? paths[id - 1] : none;
+    }
+} // namespace flow
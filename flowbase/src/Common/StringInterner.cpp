@@ -0,0 +1,44 @@
+#include "../../include/Common/StringInterner.h"
+#include <mutex>
+
+namespace flow
+{
+    SymbolID StringInterner::intern(std::string_view name)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = ids.find(name);
+            if (it != ids.end())
+            {
+                return it->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        // Another thread may have added it between the two locks
+        auto it = ids.find(name);
+        if (it != ids.end())
+        {
+            return it->second;
+        }
+
+        SymbolID id = static_cast<SymbolID>(strings.size());
+        strings.emplace_back(name);
+        ids.emplace(strings.back(), id);
+        return id;
+    }
+
+    SymbolID StringInterner::find(std::string_view name) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(name);
+        return it != ids.end() ? it->second : noSymbol;
+    }
+
+    const std::string& StringInterner::getString(SymbolID id) const
+    {
+        static const std::string empty;
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return id < strings.size() ? strings[id] : empty;
+    }
+} // namespace flow
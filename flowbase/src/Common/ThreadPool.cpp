@@ -0,0 +1,166 @@
+#include "../../include/Common/ThreadPool.h"
+#include "../../include/Common/TimeTrace.h"
+
+namespace flow
+{
+    namespace
+    {
+        // Identifies the pool/worker running on the current thread
+        thread_local const void* currentPool = nullptr;
+        thread_local unsigned currentWorker = 0;
+    }
+
+    unsigned ThreadPool::hardwareThreads()
+    {
+        unsigned count = std::thread::hardware_concurrency();
+        return count == 0 ? 1 : count;
+    }
+
+    ThreadPool::ThreadPool(unsigned threadCount)
+        : queued(0), pending(0), stopping(false), nextQueue(0)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = hardwareThreads();
+        }
+
+        for (unsigned i = 0; i < threadCount; i++)
+        {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+
+        for (unsigned i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::submit(std::function<void()> task)
+    {
+        // Count the task before it becomes visible so wait() can't return early
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            pending++;
+        }
+
+        unsigned index = currentPool == this
+                             ? currentWorker
+                             : nextQueue.fetch_add(1) % static_cast<unsigned>(queues.size());
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            queued++;
+        }
+        workAvailable.notify_one();
+    }
+
+    bool ThreadPool::popTask(unsigned index, std::function<void()>& task)
+    {
+        // Own queue first, newest task
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            if (!queues[index]->tasks.empty())
+            {
+                task = std::move(queues[index]->tasks.back());
+                queues[index]->tasks.pop_back();
+            }
+        }
+
+        // Then steal the oldest task from a sibling
+        for (size_t i = 1; !task && i < queues.size(); i++)
+        {
+            WorkQueue& victim = *queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+
+        if (!task)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        queued--;
+        return true;
+    }
+
+    void ThreadPool::workerLoop(unsigned index)
+    {
+        currentPool = this;
+        currentWorker = index;
+
+        // Under --time-trace each worker gets its own row
+        TimeTrace::startThread();
+
+        while (true)
+        {
+            std::function<void()> task;
+            if (popTask(index, task))
+            {
+                try
+                {
+                    task();
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex);
+                    if (!firstError)
+                    {
+                        firstError = std::current_exception();
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if (--pending == 0)
+                {
+                    allDone.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued <= 0)
+            {
+                lock.unlock();
+                TimeTrace::finishThread();
+                return;
+            }
+        }
+    }
+
+    void ThreadPool::wait()
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        allDone.wait(lock, [this] { return pending == 0; });
+
+        if (firstError)
+        {
+            std::exception_ptr error = firstError;
+            firstError = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+} // namespace flow
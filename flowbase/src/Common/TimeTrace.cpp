@@ -0,0 +1,71 @@
+#include "../../include/Common/TimeTrace.h"
+#include "../../include/Common/ErrorReporter.h"
+#include <llvm/Support/Error.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <atomic>
+#include <mutex>
+
+namespace flow
+{
+    namespace
+    {
+        std::atomic<bool> tracing(false);
+        std::mutex settingsMutex;
+        std::string traceProcessName;
+        unsigned traceGranularity = 0;
+    }
+
+    void TimeTrace::start(const std::string& processName, unsigned granularity)
+    {
+        {
+            std::lock_guard<std::mutex> lock(settingsMutex);
+            traceProcessName = processName;
+            traceGranularity = granularity;
+        }
+        llvm::timeTraceProfilerInitialize(granularity, processName);
+        tracing = true;
+    }
+
+    bool TimeTrace::active()
+    {
+        return tracing;
+    }
+
+    void TimeTrace::startThread()
+    {
+        if (!tracing)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        llvm::timeTraceProfilerInitialize(traceGranularity, traceProcessName);
+    }
+
+    void TimeTrace::finishThread()
+    {
+        if (llvm::timeTraceProfilerEnabled())
+        {
+            llvm::timeTraceProfilerFinishThread();
+        }
+    }
+
+    bool TimeTrace::finish(const std::string& path)
+    {
+        if (!tracing)
+        {
+            return true;
+        }
+        tracing = false;
+
+        bool written = true;
+        if (llvm::Error error = llvm::timeTraceProfilerWrite(path, path))
+        {
+            ErrorReporter::errors() << "Error: Could not write time trace: " << llvm::toString(std::move(error))
+                << std::endl;
+            written = false;
+        }
+        llvm::timeTraceProfilerCleanup();
+        return written;
+    }
+} // namespace flow
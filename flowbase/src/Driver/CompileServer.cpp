@@ -0,0 +1,432 @@
+#include "../../include/Driver/CompileServer.h"
+#include "../../include/Codegen/CodeGenerator.h"
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace flow
+{
+#ifndef _WIN32
+    namespace
+    {
+        volatile std::sig_atomic_t stopRequested = 0;
+
+        void handleStopSignal(int)
+        {
+            stopRequested = 1;
+        }
+
+        bool writeAll(int fd, const void* data, size_t size)
+        {
+            const char* cursor = static_cast<const char*>(data);
+            while (size > 0)
+            {
+                ssize_t written = write(fd, cursor, size);
+                if (written < 0 && errno == EINTR) continue;
+                if (written <= 0) return false;
+                cursor += written;
+                size -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+        bool readAll(int fd, void* data, size_t size)
+        {
+            char* cursor = static_cast<char*>(data);
+            while (size > 0)
+            {
+                ssize_t got = read(fd, cursor, size);
+                if (got < 0 && errno == EINTR) continue;
+                if (got <= 0) return false;
+                cursor += got;
+                size -= static_cast<size_t>(got);
+            }
+            return true;
+        }
+
+        bool makeAddress(const std::string& path, sockaddr_un& address)
+        {
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(address.sun_path))
+            {
+                return false;
+            }
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            return true;
+        }
+
+        int connectTo(const std::string& path)
+        {
+            sockaddr_un address;
+            if (!makeAddress(path, address))
+            {
+                return -1;
+            }
+
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+            {
+                return -1;
+            }
+            if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+            {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        void flushStdio()
+        {
+            std::cout.flush();
+            std::cerr.flush();
+            std::fflush(stdout);
+            std::fflush(stderr);
+        }
+
+        // Close every descriptor a malformed request passed us, so a client
+        // can't leak fds into the server
+        void closePassedFds(msghdr& message)
+        {
+            for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+            {
+                if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS ||
+                    header->cmsg_len < CMSG_LEN(0))
+                {
+                    continue;
+                }
+                size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for (size_t i = 0; i < count; i++)
+                {
+                    int fd;
+                    std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(fd));
+                    close(fd);
+                }
+            }
+        }
+
+        // Request: 4-byte payload length carrying the client's stdin/stdout/stderr
+        // as SCM_RIGHTS, then "cwd\0arg\0arg\0...". Reply: 4-byte exit status.
+        bool receiveRequest(int client, int (&stdioFds)[3], std::string& payload)
+        {
+            uint32_t length = 0;
+            iovec io = {&length, sizeof(length)};
+
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(stdioFds))];
+            msghdr message = {};
+            message.msg_iov = &io;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+
+            ssize_t got;
+            do
+            {
+                got = recvmsg(client, &message, 0);
+            }
+            while (got < 0 && errno == EINTR);
+
+            if (got != static_cast<ssize_t>(sizeof(length)))
+            {
+                if (got > 0)
+                {
+                    closePassedFds(message);
+                }
+                return false;
+            }
+
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            if (!header || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS ||
+                header->cmsg_len != CMSG_LEN(sizeof(stdioFds)))
+            {
+                closePassedFds(message);
+                return false;
+            }
+            std::memcpy(stdioFds, CMSG_DATA(header), sizeof(stdioFds));
+
+            // A command line, not a file upload
+            if (length > (1u << 20))
+            {
+                for (int fd : stdioFds) close(fd);
+                return false;
+            }
+
+            payload.assign(length, '\0');
+            if (!readAll(client, &payload[0], length))
+            {
+                for (int fd : stdioFds) close(fd);
+                return false;
+            }
+            return true;
+        }
+
+        void handleClient(int client, const CompileServer::Handler& handler, bool verbose)
+        {
+#ifdef __linux__
+            // Only serve the user who started the server
+            ucred credentials;
+            socklen_t credentialsSize = sizeof(credentials);
+            if (getsockopt(client, SOL_SOCKET, SO_PEERCRED, &credentials, &credentialsSize) != 0 ||
+                credentials.uid != getuid())
+            {
+                return;
+            }
+#endif
+
+            int stdioFds[3];
+            std::string payload;
+            if (!receiveRequest(client, stdioFds, payload))
+            {
+                return;
+            }
+
+            std::vector<std::string> fields;
+            size_t start = 0;
+            while (start < payload.size())
+            {
+                size_t end = payload.find('\0', start);
+                if (end == std::string::npos) end = payload.size();
+                fields.push_back(payload.substr(start, end - start));
+                start = end + 1;
+            }
+
+            auto began = std::chrono::steady_clock::now();
+            int32_t exitCode = 1;
+
+            std::error_code ec;
+            std::filesystem::path serverDirectory = std::filesystem::current_path(ec);
+
+            // Run the compile as if it were the client process: its stdio, its directory
+            flushStdio();
+            int savedFds[3];
+            for (int i = 0; i < 3; i++)
+            {
+                savedFds[i] = dup(i);
+                dup2(stdioFds[i], i);
+            }
+
+            std::error_code enterError;
+            if (!fields.empty())
+            {
+                std::filesystem::current_path(fields[0], enterError);
+            }
+
+            if (fields.empty())
+            {
+                std::cerr << "error: malformed compile request" << std::endl;
+            }
+            else if (enterError)
+            {
+                std::cerr << "error: cannot enter " << fields[0] << ": " << enterError.message() << std::endl;
+            }
+            else
+            {
+                std::vector<std::string> args(fields.begin() + 1, fields.end());
+                try
+                {
+                    exitCode = handler(args);
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "error: " << e.what() << std::endl;
+                    exitCode = 1;
+                }
+            }
+
+            flushStdio();
+            for (int i = 0; i < 3; i++)
+            {
+                dup2(savedFds[i], i);
+                close(savedFds[i]);
+                close(stdioFds[i]);
+            }
+            std::filesystem::current_path(serverDirectory, ec);
+
+            writeAll(client, &exitCode, sizeof(exitCode));
+
+            if (verbose)
+            {
+                double elapsed = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - began).count();
+                std::cerr << "[server]";
+                for (size_t i = 1; i < fields.size(); i++)
+                {
+                    std::cerr << " " << fields[i];
+                }
+                std::cerr << " -> " << exitCode << " (" << elapsed << " ms)" << std::endl;
+            }
+        }
+    }
+#endif
+
+    std::string CompileServer::defaultSocketPath()
+    {
+        if (const char* path = std::getenv("FLOW_SERVER_SOCKET"))
+        {
+            if (*path) return path;
+        }
+#ifndef _WIN32
+        if (const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR"))
+        {
+            if (*runtimeDir) return std::string(runtimeDir) + "/flowbase.sock";
+        }
+        return "/tmp/flowbase-" + std::to_string(getuid()) + ".sock";
+#else
+        return "";
+#endif
+    }
+
+    int CompileServer::serve(const std::string& socketPath, const Handler& handler, bool verbose)
+    {
+#ifndef _WIN32
+        sockaddr_un address;
+        if (!makeAddress(socketPath, address))
+        {
+            std::cerr << "Error: Socket path too long: " << socketPath << std::endl;
+            return 1;
+        }
+
+        // Don't steal the socket from a server that is still answering
+        int probe = connectTo(socketPath);
+        if (probe >= 0)
+        {
+            close(probe);
+            std::cerr << "Error: A compile server is already listening on " << socketPath << std::endl;
+            return 1;
+        }
+        unlink(socketPath.c_str());
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0)
+        {
+            std::cerr << "Error: Could not create socket: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+
+        // Owner-only, since requests run with the server's privileges
+        mode_t oldMask = umask(0077);
+        int bound = bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        umask(oldMask);
+        if (bound != 0 || listen(listener, 16) != 0)
+        {
+            std::cerr << "Error: Could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+            close(listener);
+            return 1;
+        }
+
+        // No SA_RESTART, so accept() returns when asked to stop
+        struct sigaction action = {};
+        action.sa_handler = handleStopSignal;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+        std::signal(SIGPIPE, SIG_IGN);
+
+        // Pay for target initialization once, before the first request
+        CodeGenerator::initializeTargets();
+
+        std::cout << "Flow compile server listening on " << socketPath << std::endl;
+
+        while (!stopRequested)
+        {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0)
+            {
+                if (errno == EINTR) continue;
+                std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+                break;
+            }
+
+            handleClient(client, handler, verbose);
+            close(client);
+        }
+
+        close(listener);
+        unlink(socketPath.c_str());
+        std::cout << "Flow compile server stopped" << std::endl;
+        return 0;
+#else
+        (void)socketPath;
+        (void)handler;
+        (void)verbose;
+        std::cerr << "Error: --server is not supported on Windows" << std::endl;
+        return 1;
+#endif
+    }
+
+    bool CompileServer::forward(const std::string& socketPath, const std::vector<std::string>& args, int& exitCode)
+    {
+#ifndef _WIN32
+        int fd = connectTo(socketPath);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        std::error_code ec;
+        std::string payload = std::filesystem::current_path(ec).string();
+        for (const auto& arg : args)
+        {
+            payload += '\0';
+            payload += arg;
+        }
+
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        iovec io = {&length, sizeof(length)};
+
+        int stdioFds[3] = {0, 1, 2};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(stdioFds))];
+        std::memset(control, 0, sizeof(control));
+
+        msghdr message = {};
+        message.msg_iov = &io;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(stdioFds));
+        std::memcpy(CMSG_DATA(header), stdioFds, sizeof(stdioFds));
+
+        if (sendmsg(fd, &message, 0) != static_cast<ssize_t>(sizeof(length)) ||
+            !writeAll(fd, payload.data(), payload.size()))
+        {
+            close(fd);
+            return false;
+        }
+
+        // The request was delivered, so its output may already be on screen;
+        // compiling again locally would duplicate it
+        int32_t status = 1;
+        if (!readAll(fd, &status, sizeof(status)))
+        {
+            std::cerr << "Error: Compile server closed the connection" << std::endl;
+        }
+        close(fd);
+
+        exitCode = status;
+        return true;
+#else
+        (void)socketPath;
+        (void)args;
+        (void)exitCode;
+        return false;
+#endif
+    }
+} // namespace flow
@@ -1,10 +1,12 @@
 #include "../../include/Driver/Driver.h"
 #include "../../include/Driver/MultiFileBuilder.h"
-#include "../../include/Lexer/Lexer.h"
-#include "../../include/Parser/Parser.h"
+#include "../../include/Driver/Linker.h"
+#include "../../include/Driver/JITRunner.h"
 #include "../../include/Sema/SemanticAnalyzer.h"
 #include "../../include/Codegen/CodeGenerator.h"
 #include "../../include/Common/ErrorReporter.h"
+#include "../../include/Common/ModuleGraph.h"
+#include <llvm/Support/TimeProfiler.h>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -58,45 +60,38 @@ namespace flow
         errors.push_back(message);
     }
 
-    std::string Driver::readFile(const std::string& filename)
+    int Driver::compile()
     {
-        std::ifstream file(filename);
-        if (!file.is_open())
+        // JIT'd code runs on this machine, so tune for it unless told otherwise
+        if (options.run && options.targetCPU.empty())
         {
-            reportError("Could not open file: " + filename);
-            return "";
+            options.targetCPU = "native";
         }
 
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return buffer.str();
-    }
+        // Read, lex and parse once; the multi-file builder, sema and codegen share this unit
+        auto unit = ModuleGraph::instance().load(options.inputFile);
+        if (!unit->program && unit->source.empty())
+        {
+            reportError(unit->error);
+            printErrors();
+            std::cerr << "\n" << COLOR_RED << COLOR_BOLD << getRandomFailureMessage()
+                << COLOR_RESET << std::endl;
+            return 1;
+        }
 
-    int Driver::compile()
-    {
         // Check if multi-file compilation is needed
-        if (options.multiFile && !options.objectOnly)
+        if (options.multiFile && !options.objectOnly && unit->program)
         {
-            // Check if the input file has any imports
-            std::ifstream file(options.inputFile);
-            if (file.is_open())
+            for (const auto& decl : unit->program->declarations)
             {
-                std::string line;
-                bool hasImports = false;
-                while (std::getline(file, line))
+                if (isa<ImportDecl>(decl))
                 {
-                    if (line.find("import") != std::string::npos && line.find("\"") != std::string::npos)
+                    // Use multi-file builder
+                    MultiFileBuilder builder(options);
+                    if (options.run)
                     {
-                        hasImports = true;
-                        break;
+                        return builder.run();
                     }
-                }
-                file.close();
-
-                if (hasImports)
-                {
-                    // Use multi-file builder
-                    MultiFileBuilder builder(options.inputFile, options.outputFile, options.verbose);
                     return builder.build() ? 0 : 1;
                 }
             }
@@ -108,54 +103,19 @@ namespace flow
             std::cout << "Compiling: " << options.inputFile << std::endl;
         }
 
-
-        std::string source = readFile(options.inputFile);
-        if (source.empty() && hasErrors())
-        {
-            printErrors();
-            std::cerr << "\n" << COLOR_RED << COLOR_BOLD << getRandomFailureMessage()
-                << COLOR_RESET << std::endl;
-            return 1;
-        }
-
-
-        ErrorReporter::instance().loadSourceFile(options.inputFile);
-
-        // Lexical analysis
+        // Lexical analysis and parsing
         if (options.verbose)
         {
             std::cout << "Phase 1: Lexical Analysis" << std::endl;
-        }
-
-        Lexer lexer(source, options.inputFile);
-        std::vector<Token> tokens = lexer.tokenize();
-
-        if (tokens.empty() || tokens.back().type == TokenType::INVALID)
-        {
-            reportError("Lexical analysis failed");
-            printErrors();
-            std::cerr << "\n" << COLOR_RED << COLOR_BOLD << getRandomFailureMessage()
-                << COLOR_RESET << std::endl;
-            return 1;
-        }
-
-        if (options.verbose)
-        {
-            std::cout << "  Tokens generated: " << tokens.size() << std::endl;
-        }
-
-        // Parsing
-        if (options.verbose)
-        {
+            std::cout << "  Tokens generated: " << unit->tokenCount << std::endl;
             std::cout << "Phase 2: Parsing" << std::endl;
         }
 
-        Parser parser(tokens);
-        auto program = parser.parse();
+        auto program = unit->program;
 
         if (!program)
         {
-            reportError("Parsing failed");
+            reportError(unit->error);
             printErrors();
             std::cerr << "\n" << COLOR_RED << COLOR_BOLD << getRandomFailureMessage()
                 << COLOR_RESET << std::endl;
@@ -176,7 +136,12 @@ namespace flow
         SemanticAnalyzer analyzer;
         analyzer.setCurrentFile(options.inputFile);
         analyzer.setLibraryPaths(options.libraryPaths);
-        analyzer.analyze(program);
+        analyzer.setVerbose(options.verbose);
+        analyzer.setJobs(options.jobs);
+        {
+            llvm::TimeTraceScope timeScope("Sema", options.inputFile);
+            analyzer.analyze(program);
+        }
 
         if (analyzer.hasErrors())
         {
@@ -199,7 +164,45 @@ namespace flow
 
         CodeGenerator codegen(options.outputFile);
         codegen.setLibraryPaths(options.libraryPaths);
-        codegen.generate(program);
+        codegen.setOptimizationLevel(options.optimizationLevel, options.sizeLevel);
+        codegen.setTargetCPU(options.targetCPU, options.targetFeatures);
+        codegen.setProfile(options.profileGenerateFile, options.profileUseFile);
+        codegen.setJobs(options.jobs);
+        codegen.setCodegenThreads(options.codegenThreads);
+        codegen.setStringRegions(options.stringRegions);
+        if (!codegen.generate(program))
+        {
+            reportError("Code generation failed");
+            printErrors();
+            return 1;
+        }
+
+        // Optimization (before IR emission so --emit-llvm shows optimized IR)
+        if (options.verbose)
+        {
+            std::cout << "Phase 5: Optimization" << std::endl;
+            std::cout << "  Level: -O";
+            if (options.sizeLevel > 0)
+            {
+                std::cout << (options.sizeLevel == 1 ? "s" : "z");
+            }
+            else
+            {
+                std::cout << options.optimizationLevel;
+            }
+            std::cout << std::endl;
+            std::cout << "  Target CPU: " << CodeGenerator::resolveTargetCPU(options.targetCPU) << std::endl;
+            if (!options.profileGenerateFile.empty())
+            {
+                std::cout << "  Profile: instrumented (writes " << options.profileGenerateFile << ")" << std::endl;
+            }
+            else if (!options.profileUseFile.empty())
+            {
+                std::cout << "  Profile: " << options.profileUseFile << std::endl;
+            }
+        }
+
+        codegen.optimizeModule();
 
         if (options.emitLLVM)
         {
@@ -211,23 +214,48 @@ namespace flow
             }
         }
 
-        // Generate object file
-        if (options.verbose)
+        if (options.run)
         {
-            std::cout << "Phase 5: Object File Generation" << std::endl;
-        }
+            if (options.verbose)
+            {
+                std::cout << "Phase 6: JIT Execution" << std::endl;
+            }
 
-        std::string objectFile = options.outputFile + ".o";
-        codegen.compileToObject(objectFile);
+            JITRunner runner;
+            for (const auto& libPath : options.libraryPaths)
+            {
+                runner.addLibraryPath(libPath);
+            }
 
+            bool loaded = true;
+            for (const auto& lib : codegen.getLinkedLibraries())
+            {
+                loaded = loaded && runner.addLibrary(lib);
+            }
+            loaded = loaded && runner.addModule(codegen);
+
+            int exitCode = loaded ? runner.runMain(options.inputFile, options.runArgs) : 1;
+            if (!runner.getError().empty())
+            {
+                reportError(runner.getError());
+                printErrors();
+                return 1;
+            }
+            return exitCode;
+        }
+
+        // Generate object file
         if (options.verbose)
         {
-            std::cout << "  Object file written to: " << objectFile << std::endl;
+            std::cout << "Phase 6: Object File Generation" << std::endl;
         }
 
         // Skip linking if object-only mode
         if (options.objectOnly)
         {
+            std::string objectFile = options.outputFile + ".o";
+            codegen.compileToObject(objectFile);
+
             if (options.verbose)
             {
                 std::cout << "  Object file kept: " << objectFile << std::endl;
@@ -238,49 +266,82 @@ namespace flow
             return 0;
         }
 
+        // Keep the objects in memory; the linker reads them without temp files
+        std::vector<llvm::SmallVector<char, 0>> objects;
+        if (!codegen.compileToMemory(objects))
+        {
+            reportError("Object file generation failed");
+            printErrors();
+            return 1;
+        }
+
+        if (options.verbose)
+        {
+            size_t objectSize = 0;
+            for (const auto& object : objects)
+            {
+                objectSize += object.size();
+            }
+            std::cout << "  Object code size: " << objectSize << " bytes";
+            if (objects.size() > 1)
+            {
+                std::cout << " in " << objects.size() << " partitions";
+            }
+            std::cout << std::endl;
+        }
+
         // Link to create executable
         if (options.verbose)
         {
-            std::cout << "Phase 6: Linking" << std::endl;
+            std::cout << "Phase 7: Linking" << std::endl;
         }
 
-        // Get list of libraries to link
-        auto linkedLibs = codegen.getLinkedLibraries();
-        std::string libFlags = "";
-        for (const auto& lib : linkedLibs)
+        Linker linker(options.outputFile);
+        linker.setVerbose(options.verbose);
+
+        std::string moduleName = std::filesystem::path(options.inputFile).stem().string();
+        for (size_t i = 0; i < objects.size(); i++)
         {
-            // Strip "lib" prefix if present (since -l adds it automatically)
-            std::string libName = lib;
-            if (libName.substr(0, 3) == "lib")
+            std::string objectName = objects.size() > 1 ? moduleName + ".part" + std::to_string(i) : moduleName;
+            if (!linker.addObjectBuffer(objectName, llvm::StringRef(objects[i].data(), objects[i].size())))
             {
-                libName = libName.substr(3);
+                return 1;
             }
-            libFlags += " -L. -L/tmp/ffi_test -L/usr/local/lib -l" + libName;
         }
 
-        // Add library paths from options
+        // Add object files from options
+        for (const auto& obj : options.objectFiles)
+        {
+            linker.addObjectFile(obj);
+        }
+
+        // Add library paths from options, then the default FFI search paths
         for (const auto& libPath : options.libraryPaths)
         {
-            libFlags += " -L" + libPath;
+            linker.addLibraryPath(libPath);
         }
 
-        // Add object files from options
-        std::string objFiles = "";
-        for (const auto& obj : options.objectFiles)
+        // Get list of libraries to link
+        auto linkedLibs = codegen.getLinkedLibraries();
+        if (!linkedLibs.empty())
         {
-            objFiles += " " + obj;
+            linker.addLibraryPath(".");
+            linker.addLibraryPath("/usr/local/lib");
+        }
+        for (const auto& lib : linkedLibs)
+        {
+            linker.addLibrary(lib);
         }
 
-        // Use clang/gcc to link the object file
-        std::string linkCmd;
-#ifdef __APPLE__
-        linkCmd = "clang++ -o " + options.outputFile + " " + objectFile + objFiles + libFlags;
-#else
-        linkCmd = "g++ -o " + options.outputFile + " " + objectFile + objFiles + libFlags;
-#endif
+        if (!linker.addFlowRuntime() ||
+            (!options.profileGenerateFile.empty() && !linker.addProfileRuntime()))
+        {
+            reportError("Linking failed");
+            printErrors();
+            return 1;
+        }
 
-        int linkResult = system(linkCmd.c_str());
-        if (linkResult != 0)
+        if (!linker.link())
         {
             reportError("Linking failed");
             printErrors();
@@ -289,8 +350,11 @@ namespace flow
             return 1;
         }
 
-        // Clean up object file
-        remove(objectFile.c_str());
+        if (options.verbose)
+        {
+            std::cout << "  Linker: " << linker.getLinkerUsed() << std::endl;
+            std::cout << "  Link time: " << linker.getLinkMilliseconds() << " ms" << std::endl;
+        }
 
         if (options.verbose)
         {
@@ -0,0 +1,285 @@
+#include "../../include/Driver/JITRunner.h"
+#include "../../include/Codegen/CodeGenerator.h"
+#include "../../include/Stdlib/Builtins.h"
+#include "../../include/Stdlib/FlowArray.h"
+#include "../../include/Stdlib/FlowString.h"
+#include <llvm/ExecutionEngine/Orc/AbsoluteSymbols.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace flow
+{
+    namespace
+    {
+        // Libraries the compiler itself links, so their symbols are already in
+        // the process and there is no shared object to load
+        bool isProcessLibrary(const std::string& name)
+        {
+            return name == "c" || name == "m" || name == "stdc++" || name == "pthread" || name == "dl" ||
+                name == "rt";
+        }
+
+        std::string sharedLibraryName(const std::string& name)
+        {
+#if defined(_WIN32)
+            return name + ".dll";
+#elif defined(__APPLE__)
+            return "lib" + name + ".dylib";
+#else
+            return "lib" + name + ".so";
+#endif
+        }
+    }
+
+    JITRunner::JITRunner()
+        : hasMain(false), mainParams(0), mainReturnsInt(false)
+    {
+    }
+
+    JITRunner::~JITRunner() = default;
+
+    bool JITRunner::initialize()
+    {
+        if (jit)
+        {
+            return true;
+        }
+
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+
+        auto machineBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+        if (!machineBuilder)
+        {
+            error = "Failed to detect host target: " + llvm::toString(machineBuilder.takeError());
+            return false;
+        }
+
+        auto created = llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(*machineBuilder)).create();
+        if (!created)
+        {
+            error = "Failed to create JIT: " + llvm::toString(created.takeError());
+            return false;
+        }
+        jit = std::move(*created);
+
+        // libc and anything else the compiler process has loaded
+        auto processSymbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            jit->getDataLayout().getGlobalPrefix());
+        if (!processSymbols)
+        {
+            error = "Failed to expose process symbols: " + llvm::toString(processSymbols.takeError());
+            return false;
+        }
+        jit->getMainJITDylib().addGenerator(std::move(*processSymbols));
+
+        defineBuiltins();
+        return true;
+    }
+
+    void JITRunner::defineBuiltins()
+    {
+        // The compiler links the stdlib, so point its mangled names straight at it
+        // rather than relying on the symbols being exported from the executable
+        const std::vector<std::pair<const char*, void*> > builtins = {
+            {"flow_string_from_cstr", reinterpret_cast<void*>(&flow_string_from_cstr)},
+            {"flow_string_to_cstr", reinterpret_cast<void*>(&flow_string_to_cstr)},
+            {"flow_string_from_buffer", reinterpret_cast<void*>(&flow_string_from_buffer)},
+            {"flow_string_substr", reinterpret_cast<void*>(&flow_string_substr)},
+            {"flow_string_concat", reinterpret_cast<void*>(&flow_string_concat)},
+            {"flow_string_concat_n", reinterpret_cast<void*>(&flow_string_concat_n)},
+            {"flow_format_int", reinterpret_cast<void*>(&flow_format_int)},
+            {"flow_format_float", reinterpret_cast<void*>(&flow_format_float)},
+            {"flow_string_equals", reinterpret_cast<void*>(&flow_string_equals)},
+            {"flow_region_enter", reinterpret_cast<void*>(&flow_region_enter)},
+            {"flow_region_leave", reinterpret_cast<void*>(&flow_region_leave)},
+            {"flow_region_keep", reinterpret_cast<void*>(&flow_region_keep)},
+            {"flow_array_new", reinterpret_cast<void*>(&flow_array_new)},
+            {"flow_array_grow", reinterpret_cast<void*>(&flow_array_grow)},
+            {"flow_array_keep", reinterpret_cast<void*>(&flow_array_keep)},
+            {"_ZN4flow6stdlib8abs_implEi", reinterpret_cast<void*>(&stdlib::abs_impl)},
+            {"_ZN4flow6stdlib9sqrt_implEd", reinterpret_cast<void*>(&stdlib::sqrt_impl)},
+            {"_ZN4flow6stdlib8pow_implEdd", reinterpret_cast<void*>(&stdlib::pow_impl)},
+            {"_ZN4flow6stdlib8min_implEii", reinterpret_cast<void*>(&stdlib::min_impl)},
+            {"_ZN4flow6stdlib8max_implEii", reinterpret_cast<void*>(&stdlib::max_impl)},
+            {"_ZN4flow6stdlib13readLine_implEv", reinterpret_cast<void*>(&stdlib::readLine_impl)},
+            {"_ZN4flow6stdlib12readInt_implEv", reinterpret_cast<void*>(&stdlib::readInt_impl)},
+            {"_ZN4flow6stdlib14writeFile_implEPKcS2_", reinterpret_cast<void*>(&stdlib::writeFile_impl)},
+            {"_ZN4flow6stdlib13readFile_implEPKc", reinterpret_cast<void*>(&stdlib::readFile_impl)},
+        };
+
+        llvm::orc::SymbolMap symbols;
+        for (const auto& [name, address] : builtins)
+        {
+            symbols[jit->mangleAndIntern(name)] = llvm::orc::ExecutorSymbolDef(
+                llvm::orc::ExecutorAddr::fromPtr(address),
+                llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+        }
+
+        llvm::cantFail(jit->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(symbols))));
+    }
+
+    void JITRunner::addLibraryPath(const std::string& path)
+    {
+        libraryPaths.push_back(path);
+    }
+
+    bool JITRunner::addLibrary(const std::string& name)
+    {
+        if (!initialize())
+        {
+            return false;
+        }
+
+        std::string libName = name.compare(0, 3, "lib") == 0 && name.size() > 3 ? name.substr(3) : name;
+        if (isProcessLibrary(libName))
+        {
+            return true;
+        }
+
+        // Same search order as the linker: -L paths, then the defaults, then
+        // let the dynamic loader search its own paths
+        std::string fileName = sharedLibraryName(libName);
+        std::string libraryFile = fileName;
+        std::vector<std::string> searchPaths = libraryPaths;
+        searchPaths.push_back(".");
+        searchPaths.push_back("/usr/local/lib");
+        for (const auto& dir : searchPaths)
+        {
+            std::error_code ec;
+            std::filesystem::path candidate = std::filesystem::path(dir) / fileName;
+            if (std::filesystem::exists(candidate, ec))
+            {
+                libraryFile = candidate.string();
+                break;
+            }
+        }
+
+        auto generator = llvm::orc::DynamicLibrarySearchGenerator::Load(libraryFile.c_str(),
+                                                                         jit->getDataLayout().getGlobalPrefix());
+        if (!generator)
+        {
+            error = "Failed to load library '" + name + "': " + llvm::toString(generator.takeError());
+            return false;
+        }
+        jit->getMainJITDylib().addGenerator(std::move(*generator));
+        return true;
+    }
+
+    bool JITRunner::addModule(CodeGenerator& codegen)
+    {
+        if (!initialize())
+        {
+            return false;
+        }
+
+        std::unique_ptr<llvm::LLVMContext> context;
+        std::unique_ptr<llvm::Module> module = codegen.takeModule(context);
+
+        if (llvm::Function* mainFunc = module->getFunction("main"))
+        {
+            if (!mainFunc->isDeclaration())
+            {
+                hasMain = true;
+                mainParams = static_cast<unsigned>(mainFunc->arg_size());
+                mainReturnsInt = mainFunc->getReturnType()->isIntegerTy();
+            }
+        }
+
+        llvm::Error added = jit->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context)));
+        if (added)
+        {
+            error = "Failed to add module to JIT: " + llvm::toString(std::move(added));
+            return false;
+        }
+        return true;
+    }
+
+    int JITRunner::runMain(const std::string& programName, const std::vector<std::string>& args)
+    {
+        if (!initialize())
+        {
+            return 1;
+        }
+
+        if (!hasMain)
+        {
+            error = "No main function defined";
+            return 1;
+        }
+
+        if (mainParams != 0 && mainParams != 2)
+        {
+            error = "main must take no parameters or (argc, argv)";
+            return 1;
+        }
+
+        // Lookup is what actually compiles the modules
+        auto mainSymbol = [this] {
+            llvm::TimeTraceScope timeScope("JITCompile");
+            return jit->lookup("main");
+        }();
+        if (!mainSymbol)
+        {
+            error = "Failed to resolve main: " + llvm::toString(mainSymbol.takeError());
+            return 1;
+        }
+
+        // Static constructors, if any module has them
+        if (llvm::Error initError = jit->initialize(jit->getMainJITDylib()))
+        {
+            error = "Failed to run initializers: " + llvm::toString(std::move(initError));
+            return 1;
+        }
+
+        std::vector<std::string> argStorage;
+        argStorage.push_back(programName);
+        argStorage.insert(argStorage.end(), args.begin(), args.end());
+
+        std::vector<char*> argv;
+        for (auto& arg : argStorage)
+        {
+            argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+
+        // Compiler output and program output share the terminal
+        std::cout.flush();
+        std::cerr.flush();
+
+        int exitCode = 0;
+        llvm::orc::ExecutorAddr mainAddress = *mainSymbol;
+        if (mainParams == 2 && mainReturnsInt)
+        {
+            exitCode = mainAddress.toPtr<int (*)(int, char**)>()(static_cast<int>(argStorage.size()), argv.data());
+        }
+        else if (mainParams == 2)
+        {
+            mainAddress.toPtr<void (*)(int, char**)>()(static_cast<int>(argStorage.size()), argv.data());
+        }
+        else if (mainReturnsInt)
+        {
+            exitCode = mainAddress.toPtr<int (*)()>()();
+        }
+        else
+        {
+            mainAddress.toPtr<void (*)()>()();
+        }
+
+        std::fflush(stdout);
+
+        if (llvm::Error deinitError = jit->deinitialize(jit->getMainJITDylib()))
+        {
+            llvm::consumeError(std::move(deinitError));
+        }
+
+        return exitCode;
+    }
+} // namespace flow
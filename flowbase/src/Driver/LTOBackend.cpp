@@ -0,0 +1,159 @@
+#include "../../include/Driver/LTOBackend.h"
+#include "../../include/Driver/Linker.h"
+#include "../../include/Codegen/CodeGenerator.h"
+#include "../../include/Common/ErrorReporter.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/LTO/Config.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/Support/CachePruning.h>
+#include <llvm/Support/Caching.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
+#include <memory>
+#include <set>
+#include <sstream>
+
+namespace flow
+{
+    LTOBackend::LTOBackend(int mode)
+        : mode(mode), optimizationLevel(2), jobs(1), exportAllSymbols(false)
+    {
+    }
+
+    void LTOBackend::addBitcodeFile(const std::string& path)
+    {
+        bitcodeFiles.push_back(path);
+    }
+
+    bool LTOBackend::run(Linker& linker)
+    {
+        llvm::TimeTraceScope timeScope(mode == 1 ? "ThinLTO" : "LTO");
+        CodeGenerator::initializeTargets();
+
+        llvm::lto::Config config;
+        config.CPU = CodeGenerator::resolveTargetCPU(targetCPU);
+        std::stringstream features(CodeGenerator::resolveTargetFeatures(targetCPU, targetFeatures));
+        std::string feature;
+        while (std::getline(features, feature, ','))
+        {
+            if (!feature.empty()) config.MAttrs.push_back(feature);
+        }
+        config.RelocModel = llvm::Reloc::PIC_;
+        config.OptLevel = static_cast<unsigned>(optimizationLevel);
+        switch (optimizationLevel)
+        {
+        case 0: config.CGOptLevel = llvm::CodeGenOptLevel::None;
+            break;
+        case 1: config.CGOptLevel = llvm::CodeGenOptLevel::Less;
+            break;
+        case 3: config.CGOptLevel = llvm::CodeGenOptLevel::Aggressive;
+            break;
+        default: config.CGOptLevel = llvm::CodeGenOptLevel::Default;
+            break;
+        }
+
+        llvm::lto::ThinBackend backend = llvm::lto::createInProcessThinBackend(
+            llvm::heavyweight_hardware_concurrency(jobs));
+        llvm::lto::LTO lto(std::move(config), std::move(backend));
+
+        // Symbol resolution, as a linker would report it: the first definition
+        // of each symbol prevails (weak helpers like len are defined in every
+        // module), and only main is referenced from outside the LTO unit
+        std::vector<std::unique_ptr<llvm::MemoryBuffer> > buffers;
+        std::set<std::string> defined;
+        for (const auto& path : bitcodeFiles)
+        {
+            auto buffer = llvm::MemoryBuffer::getFile(path);
+            if (!buffer)
+            {
+                ErrorReporter::errors() << "Error: Could not read " << path << ": " << buffer.getError().message()
+                    << std::endl;
+                return false;
+            }
+
+            auto input = llvm::lto::InputFile::create((*buffer)->getMemBufferRef());
+            if (!input)
+            {
+                ErrorReporter::errors() << "Error: " << path << ": " << llvm::toString(input.takeError())
+                    << std::endl;
+                return false;
+            }
+
+            std::vector<llvm::lto::SymbolResolution> resolutions;
+            for (const auto& symbol : (*input)->symbols())
+            {
+                llvm::lto::SymbolResolution resolution;
+                if (!symbol.isUndefined() && defined.insert(symbol.getName().str()).second)
+                {
+                    resolution.Prevailing = true;
+                    resolution.FinalDefinitionInLinkageUnit = true;
+                }
+                resolution.VisibleToRegularObj = exportAllSymbols || symbol.getIRName() == "main";
+                resolutions.push_back(resolution);
+            }
+
+            if (llvm::Error error = lto.add(std::move(*input), resolutions))
+            {
+                ErrorReporter::errors() << "Error: " << path << ": " << llvm::toString(std::move(error))
+                    << std::endl;
+                return false;
+            }
+            buffers.push_back(std::move(*buffer));
+        }
+
+        // One native object per task (a ThinLTO module or a full LTO partition)
+        std::vector<llvm::SmallString<0> > objects(lto.getMaxTasks());
+        auto addStream = [&objects](unsigned task, const llvm::Twine&)
+            -> llvm::Expected<std::unique_ptr<llvm::CachedFileStream> >
+        {
+            return std::make_unique<llvm::CachedFileStream>(
+                std::make_unique<llvm::raw_svector_ostream>(objects[task]));
+        };
+
+        llvm::FileCache cache;
+        if (!cacheDirectory.empty())
+        {
+            auto localCache = llvm::localCache("ThinLTO", "flow-lto", cacheDirectory,
+                                               [&objects](unsigned task, const llvm::Twine&,
+                                                          std::unique_ptr<llvm::MemoryBuffer> object)
+                                               {
+                                                   objects[task] = object->getBuffer();
+                                               });
+            if (localCache)
+            {
+                cache = std::move(*localCache);
+            }
+            else
+            {
+                // Still correct without a cache, just slower
+                llvm::consumeError(localCache.takeError());
+            }
+        }
+
+        if (llvm::Error error = lto.run(addStream, cache))
+        {
+            ErrorReporter::errors() << "Error: LTO failed: " << llvm::toString(std::move(error)) << std::endl;
+            return false;
+        }
+
+        if (!cacheDirectory.empty())
+        {
+            llvm::pruneCache(cacheDirectory, llvm::CachePruningPolicy());
+        }
+
+        for (size_t task = 0; task < objects.size(); task++)
+        {
+            if (objects[task].empty())
+            {
+                continue;
+            }
+            if (!linker.addObjectBuffer("lto" + std::to_string(task), objects[task].str()))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace flow
@@ -0,0 +1,458 @@
+#include "../../include/Driver/Linker.h"
+#include "../../include/Common/ErrorReporter.h"
+#include <llvm/Support/TimeProfiler.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef FLOW_HAS_LLD
+#include <lld/Common/Driver.h>
+#include <llvm/Support/raw_ostream.h>
+
+LLD_HAS_DRIVER(elf)
+#endif
+
+namespace flow
+{
+    namespace
+    {
+        std::string shellQuote(const std::string& arg)
+        {
+            std::string quoted = "'";
+            for (char c : arg)
+            {
+                if (c == '\'')
+                {
+                    quoted += "'\\''";
+                }
+                else
+                {
+                    quoted += c;
+                }
+            }
+            return quoted + "'";
+        }
+
+        std::string libraryName(const std::string& name)
+        {
+            if (name.compare(0, 3, "lib") == 0 && name.size() > 3)
+            {
+                return name.substr(3);
+            }
+            return name;
+        }
+
+#ifdef FLOW_HAS_LLD
+        // Startup files and the dynamic loader the system compiler would pass
+        // to the linker. Empty paths mean they weren't found and LLD can't be
+        // used on this host.
+        struct SystemLinkFiles
+        {
+            std::string crt1;
+            std::string crti;
+            std::string crtn;
+            std::string crtBegin;
+            std::string crtEnd;
+            std::string dynamicLinker;
+            std::vector<std::string> searchPaths;
+
+            bool complete() const
+            {
+                return !crt1.empty() && !crti.empty() && !crtn.empty() && !crtBegin.empty() && !crtEnd.empty() &&
+                    !dynamicLinker.empty();
+            }
+        };
+
+        std::string findFile(const std::vector<std::string>& dirs, const std::string& name)
+        {
+            for (const auto& dir : dirs)
+            {
+                std::error_code ec;
+                std::filesystem::path candidate = std::filesystem::path(dir) / name;
+                if (std::filesystem::exists(candidate, ec))
+                {
+                    return candidate.string();
+                }
+            }
+            return "";
+        }
+
+        // Newest GCC runtime directory, e.g. /usr/lib/gcc/x86_64-linux-gnu/13
+        std::string findGccDirectory(const std::string& triple)
+        {
+            namespace fs = std::filesystem;
+
+            std::string best;
+            int bestVersion = -1;
+            for (const char* root : {"/usr/lib/gcc/", "/usr/lib64/gcc/"})
+            {
+                std::error_code ec;
+                fs::path base = fs::path(root) / triple;
+                for (fs::directory_iterator it(base, ec), end; !ec && it != end; it.increment(ec))
+                {
+                    std::string name = it->path().filename().string();
+                    int version = std::atoi(name.c_str());
+                    if (version > bestVersion && fs::exists(it->path() / "crtbeginS.o"))
+                    {
+                        bestVersion = version;
+                        best = it->path().string();
+                    }
+                }
+            }
+            return best;
+        }
+
+        const SystemLinkFiles& systemLinkFiles()
+        {
+            static SystemLinkFiles files;
+            static std::once_flag once;
+
+            std::call_once(once, []
+            {
+#if defined(__x86_64__)
+                const std::string triple = "x86_64-linux-gnu";
+                const std::vector<std::string> loaders = {"/lib64/ld-linux-x86-64.so.2",
+                                                          "/lib/x86_64-linux-gnu/ld-linux-x86-64.so.2"};
+#elif defined(__aarch64__)
+                const std::string triple = "aarch64-linux-gnu";
+                const std::vector<std::string> loaders = {"/lib/ld-linux-aarch64.so.1",
+                                                          "/lib/aarch64-linux-gnu/ld-linux-aarch64.so.1"};
+#else
+                const std::string triple;
+                const std::vector<std::string> loaders;
+#endif
+                if (triple.empty())
+                {
+                    return;
+                }
+
+                std::vector<std::string> libDirs = {"/usr/lib/" + triple, "/lib/" + triple, "/usr/lib64", "/lib64",
+                                                    "/usr/lib", "/lib"};
+                std::string gccDir = findGccDirectory(triple);
+
+                files.crt1 = findFile(libDirs, "Scrt1.o");
+                files.crti = findFile(libDirs, "crti.o");
+                files.crtn = findFile(libDirs, "crtn.o");
+                if (!gccDir.empty())
+                {
+                    files.crtBegin = gccDir + "/crtbeginS.o";
+                    files.crtEnd = gccDir + "/crtendS.o";
+                    files.searchPaths.push_back(gccDir);
+                }
+                for (const auto& loader : loaders)
+                {
+                    std::error_code ec;
+                    if (std::filesystem::exists(loader, ec))
+                    {
+                        files.dynamicLinker = loader;
+                        break;
+                    }
+                }
+                files.searchPaths.insert(files.searchPaths.end(), libDirs.begin(), libDirs.end());
+            });
+
+            return files;
+        }
+
+        // lld::lldMain isn't reentrant, and after certain errors it can't be
+        // called again in the same process
+        std::mutex lldMutex;
+        bool lldUsable = true;
+#endif
+    }
+
+    Linker::Linker(const std::string& outputFile)
+        : outputFile(outputFile), verbose(false), linkMilliseconds(0)
+    {
+    }
+
+    Linker::~Linker()
+    {
+#ifdef __linux__
+        for (int fd : memoryFiles)
+        {
+            close(fd);
+        }
+#endif
+        for (const auto& path : tempFiles)
+        {
+            std::remove(path.c_str());
+        }
+    }
+
+    void Linker::addObjectFile(const std::string& path)
+    {
+        inputs.push_back(path);
+    }
+
+    bool Linker::addObjectBuffer(const std::string& name, llvm::StringRef data)
+    {
+#ifdef __linux__
+        int fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+        if (fd >= 0)
+        {
+            const char* cursor = data.data();
+            size_t remaining = data.size();
+            while (remaining > 0)
+            {
+                ssize_t written = write(fd, cursor, remaining);
+                if (written <= 0)
+                {
+                    break;
+                }
+                cursor += written;
+                remaining -= static_cast<size_t>(written);
+            }
+
+            if (remaining == 0)
+            {
+                // Named through our pid so an external linker process can open it too
+                memoryFiles.push_back(fd);
+                inputs.push_back("/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(fd));
+                return true;
+            }
+            close(fd);
+        }
+#endif
+
+        // No anonymous files on this platform; spill to disk next to the output
+        std::string path = outputFile + "." + name + ".o";
+        std::ofstream out(path, std::ios::binary);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out)
+        {
+            ErrorReporter::errors() << "Error: Could not write object file: " << path << std::endl;
+            return false;
+        }
+        tempFiles.push_back(path);
+        inputs.push_back(path);
+        return true;
+    }
+
+    void Linker::addLibrary(const std::string& name)
+    {
+        std::string lib = libraryName(name);
+        if (std::find(libraries.begin(), libraries.end(), lib) == libraries.end())
+        {
+            libraries.push_back(lib);
+        }
+    }
+
+    void Linker::addLibraryPath(const std::string& path)
+    {
+        if (std::find(libraryPaths.begin(), libraryPaths.end(), path) == libraryPaths.end())
+        {
+            libraryPaths.push_back(path);
+        }
+    }
+
+    bool Linker::addFlowRuntime()
+    {
+        std::string runtime;
+        if (const char* path = std::getenv("FLOW_RUNTIME"))
+        {
+            runtime = path;
+        }
+#ifdef FLOW_RUNTIME_PATH
+        if (runtime.empty())
+        {
+            runtime = FLOW_RUNTIME_PATH;
+        }
+#endif
+
+        std::error_code ec;
+        if (runtime.empty() || !std::filesystem::exists(runtime, ec))
+        {
+            ErrorReporter::errors() << "Error: Flow runtime (libflowrt) not found; set FLOW_RUNTIME" << std::endl;
+            return false;
+        }
+        runtimeArchives.push_back(runtime);
+        return true;
+    }
+
+    bool Linker::addProfileRuntime()
+    {
+        std::string runtime;
+        if (const char* path = std::getenv("FLOW_PROFILE_RUNTIME"))
+        {
+            runtime = path;
+        }
+#ifdef FLOW_PROFILE_RUNTIME_PATH
+        if (runtime.empty())
+        {
+            runtime = FLOW_PROFILE_RUNTIME_PATH;
+        }
+#endif
+
+        std::error_code ec;
+        if (runtime.empty() || !std::filesystem::exists(runtime, ec))
+        {
+            ErrorReporter::errors() << "Error: LLVM profile runtime (libclang_rt.profile) not found; "
+                << "install compiler-rt or set FLOW_PROFILE_RUNTIME" << std::endl;
+            return false;
+        }
+
+        // The instrumented code doesn't reference the runtime's registration
+        // hook on ELF; the compiler driver is expected to pull it in
+        undefinedSymbols.push_back("__llvm_profile_runtime");
+        runtimeArchives.push_back(runtime);
+        return true;
+    }
+
+    bool Linker::linkWithLLD(std::string& diagnostics)
+    {
+#ifdef FLOW_HAS_LLD
+        const SystemLinkFiles& files = systemLinkFiles();
+        if (!files.complete())
+        {
+            diagnostics = "startup files not found";
+            return false;
+        }
+
+        // Mirrors what g++ passes to ld for a PIE executable
+        std::vector<std::string> args = {
+            "ld.lld", "-pie", "--eh-frame-hdr", "-m",
+#if defined(__aarch64__)
+            "aarch64linux",
+#else
+            "elf_x86_64",
+#endif
+            "-dynamic-linker", files.dynamicLinker, "-o", outputFile,
+            files.crt1, files.crti, files.crtBegin
+        };
+        for (const auto& path : libraryPaths)
+        {
+            args.push_back("-L" + path);
+        }
+        for (const auto& path : files.searchPaths)
+        {
+            args.push_back("-L" + path);
+        }
+        for (const auto& symbol : undefinedSymbols)
+        {
+            args.push_back("-u");
+            args.push_back(symbol);
+        }
+        args.insert(args.end(), inputs.begin(), inputs.end());
+        for (const auto& lib : libraries)
+        {
+            args.push_back("-l" + lib);
+        }
+        args.insert(args.end(), runtimeArchives.begin(), runtimeArchives.end());
+        for (const char* lib : {"-lstdc++", "-lm", "-lc", "-lgcc", "--as-needed", "-lgcc_s", "--no-as-needed"})
+        {
+            args.push_back(lib);
+        }
+        args.push_back(files.crtEnd);
+        args.push_back(files.crtn);
+
+        std::vector<const char*> argv;
+        for (const auto& arg : args)
+        {
+            argv.push_back(arg.c_str());
+        }
+
+        std::lock_guard<std::mutex> lock(lldMutex);
+        if (!lldUsable)
+        {
+            diagnostics = "LLD disabled after an earlier failure";
+            return false;
+        }
+
+        std::string output;
+        llvm::raw_string_ostream stdoutStream(output);
+        llvm::raw_string_ostream stderrStream(diagnostics);
+        lld::Result result = lld::lldMain(argv, stdoutStream, stderrStream, {{lld::Gnu, &lld::elf::link}});
+        stdoutStream.flush();
+        stderrStream.flush();
+
+        if (!result.canRunAgain)
+        {
+            lldUsable = false;
+        }
+        return result.retCode == 0;
+#else
+        (void)diagnostics;
+        return false;
+#endif
+    }
+
+    bool Linker::linkWithDriver()
+    {
+        const char* driver = std::getenv("CXX");
+#ifdef __APPLE__
+        linkerUsed = driver && *driver ? driver : "clang++";
+#else
+        linkerUsed = driver && *driver ? driver : "g++";
+#endif
+
+        std::string command = linkerUsed + " -o " + shellQuote(outputFile);
+        for (const auto& symbol : undefinedSymbols)
+        {
+            command += " -u " + shellQuote(symbol);
+        }
+        for (const auto& input : inputs)
+        {
+            command += " " + shellQuote(input);
+        }
+        for (const auto& path : libraryPaths)
+        {
+            command += " -L" + shellQuote(path);
+        }
+        for (const auto& lib : libraries)
+        {
+            command += " -l" + shellQuote(lib);
+        }
+        for (const auto& archive : runtimeArchives)
+        {
+            command += " " + shellQuote(archive);
+        }
+
+        if (verbose)
+        {
+            ErrorReporter::output() << "  Link command: " << command << std::endl;
+        }
+
+        return std::system(command.c_str()) == 0;
+    }
+
+    bool Linker::link()
+    {
+        llvm::TimeTraceScope timeScope("Link", outputFile);
+        auto start = std::chrono::steady_clock::now();
+
+        std::string diagnostics;
+        bool linked = linkWithLLD(diagnostics);
+        if (linked)
+        {
+            linkerUsed = "lld";
+        }
+        else
+        {
+#ifdef FLOW_HAS_LLD
+            if (verbose && !diagnostics.empty())
+            {
+                ErrorReporter::output() << "  LLD unavailable, using system linker: " << diagnostics << std::endl;
+            }
+#endif
+            linked = linkWithDriver();
+        }
+
+        linkMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (!linked)
+        {
+            ErrorReporter::errors() << "Error: Linking failed" << std::endl;
+        }
+        return linked;
+    }
+} // namespace flow
@@ -1,8 +1,12 @@
 #include "../../include/Driver/MultiFileBuilder.h"
-#include "../../include/Lexer/Lexer.h"
-#include "../../include/Parser/Parser.h"
+#include "../../include/Driver/Linker.h"
+#include "../../include/Driver/LTOBackend.h"
+#include "../../include/Driver/JITRunner.h"
 #include "../../include/Sema/SemanticAnalyzer.h"
 #include "../../include/Codegen/CodeGenerator.h"
+#include "../../include/Common/ErrorReporter.h"
+#include "../../include/Common/ModuleGraph.h"
+#include "../../include/Common/ThreadPool.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -10,67 +14,189 @@
 #include <sys/stat.h>
 #include <cstdlib>
 #include <iomanip>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <cstdio>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/xxhash.h>
+#include <llvm/Support/TimeProfiler.h>
 
 namespace flow
 {
-    MultiFileBuilder::MultiFileBuilder(const std::string& mainFile, const std::string& outputFile, bool verbose)
-        : mainFile(mainFile), outputFile(outputFile), buildDir(".flow_build"), verbose(verbose)
+    namespace
     {
-        std::filesystem::create_directories(buildDir);
-    }
+        const char* MANIFEST_HEADER = "flow-build-manifest 1";
 
-    std::string MultiFileBuilder::resolveImportPath(const std::string& importPath, const std::string& currentDir)
-    {
-        namespace fs = std::filesystem;
+        uint64_t hashString(std::string_view data)
+        {
+            return llvm::xxh3_64bits(llvm::StringRef(data.data(), data.size()));
+        }
 
-        if (fs::path(importPath).is_absolute())
+        // A hash of the file's bytes (0 if it can't be read), so an object
+        // rewritten within one timestamp tick still changes the key
+        uint64_t hashFile(const std::string& path)
         {
-            return importPath;
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+            {
+                return 0;
+            }
+            std::ostringstream contents;
+            contents << file.rdbuf();
+            return hashString(contents.str());
         }
 
-        // First try: resolve relative to current directory
-        fs::path fullPath = fs::path(currentDir) / importPath;
+        // A module that codegen split into partitions keeps the first in its
+        // object and the rest next to it: name.o, name.part1.o, ...
+        std::string partObjectPath(const std::string& objectPath, size_t index)
+        {
+            std::filesystem::path path(objectPath);
+            return (path.parent_path() / (path.stem().string() + ".part" + std::to_string(index) + ".o")).string();
+        }
 
-        try
+        // The part objects the last compile of a module left, in order
+        std::vector<std::string> existingPartObjects(const std::string& objectPath)
         {
-            return fs::canonical(fullPath).string();
+            std::vector<std::string> parts;
+            while (std::filesystem::exists(partObjectPath(objectPath, parts.size() + 1)))
+            {
+                parts.push_back(partObjectPath(objectPath, parts.size() + 1));
+            }
+            return parts;
+        }
+
+        // Delete part objects from index on, left by a compile that made more
+        void removePartObjects(const std::string& objectPath, size_t index)
+        {
+            std::error_code ec;
+            while (std::filesystem::remove(partObjectPath(objectPath, index), ec))
+            {
+                index++;
+            }
         }
-        catch (const fs::filesystem_error&)
+
+        size_t objectFilesSize(const ModuleInfo& info)
         {
-            // If that fails, try library paths from environment
-            // Check FLOW_PATH or River packages directory
-            if (const char* flowPath = std::getenv("FLOW_PATH"))
+            size_t size = 0;
+            struct stat st;
+            if (stat(info.objectPath.c_str(), &st) == 0)
             {
-                fs::path libFullPath = fs::path(flowPath) / importPath;
-                try
+                size += st.st_size;
+            }
+            for (const auto& part : info.partPaths)
+            {
+                if (stat(part.c_str(), &st) == 0)
                 {
-                    return fs::canonical(libFullPath).string();
+                    size += st.st_size;
                 }
-                catch (const fs::filesystem_error&)
+            }
+            return size;
+        }
+
+        std::string toHex(uint64_t value)
+        {
+            char buffer[17];
+            std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+            return buffer;
+        }
+
+        std::string typeSignature(const Type* type)
+        {
+            if (!type) return "_";
+            std::string result = std::to_string(static_cast<int>(type->kind)) + type->name;
+            if (!type->typeParams.empty())
+            {
+                result += "<";
+                for (const auto& param : type->typeParams)
                 {
-                    // Continue
+                    result += typeSignature(param) + ",";
                 }
+                result += ">";
             }
+            return result;
+        }
 
-            // Try ~/.river/packages/ as fallback
-            if (const char* home = std::getenv("HOME"))
+        std::string parameterSignature(const std::vector<Parameter>& parameters)
+        {
+            std::string result = "(";
+            for (const auto& param : parameters)
+            {
+                result += param.name + ":" + typeSignature(param.type) + ",";
+            }
+            return result + ")";
+        }
+
+        // Everything an importer's sema/codegen can observe: signatures, not bodies
+        uint64_t computeInterfaceHash(const Program& program)
+        {
+            std::string data;
+            for (const auto& decl : program.declarations)
             {
-                fs::path riverPath = fs::path(home) / ".river" / "packages";
-                fs::path libFullPath = riverPath / importPath;
-                try
+                if (auto* func = dyn_cast<FunctionDecl>(decl))
+                {
+                    data += "func " + func->name + parameterSignature(func->parameters) + typeSignature(func->returnType)
+                        + (func->isExported ? " export " + func->abi : "") + (func->isAsync ? " async" : "") + "\n";
+                }
+                else if (auto* structDecl = dyn_cast<StructDecl>(decl))
+                {
+                    data += "struct " + structDecl->name + "{";
+                    for (const auto& field : structDecl->fields)
+                    {
+                        data += field.name + ":" + typeSignature(field.type) + ",";
+                    }
+                    data += "}\n";
+                }
+                else if (auto* impl = dyn_cast<ImplDecl>(decl))
+                {
+                    data += "impl " + impl->structName + "::" + impl->methodName + parameterSignature(impl->parameters)
+                        + typeSignature(impl->returnType) + "\n";
+                }
+                else if (auto* typeDef = dyn_cast<TypeDefDecl>(decl))
                 {
-                    return fs::canonical(libFullPath).string();
+                    data += "type " + typeDef->name + "=" + typeSignature(typeDef->aliasedType) + "\n";
                 }
-                catch (const fs::filesystem_error&)
+                else if (auto* link = dyn_cast<LinkDecl>(decl))
                 {
-                    // Continue
+                    data += "link " + link->adapter + " " + link->module + "{" + link->inlineCode;
+                    for (const auto& func : link->functions)
+                    {
+                        data += func->name + parameterSignature(func->parameters) + typeSignature(func->returnType) + ";";
+                    }
+                    data += "}\n";
+                }
+                else if (auto* import = dyn_cast<ImportDecl>(decl))
+                {
+                    data += "import " + import->modulePath + " as " + import->alias + "{";
+                    for (const auto& name : import->imports)
+                    {
+                        data += name + ",";
+                    }
+                    data += "}\n";
+                }
+                else if (auto* moduleDecl = dyn_cast<ModuleDecl>(decl))
+                {
+                    data += "module " + moduleDecl->name + "\n";
                 }
             }
-
-            return fullPath.string();
+            return hashString(data);
         }
     }
 
+    MultiFileBuilder::MultiFileBuilder(const CompilerOptions& options)
+        : mainFile(options.inputFile), outputFile(options.outputFile), buildDir(".flow_build"),
+          verbose(options.verbose), options(options)
+    {
+        std::filesystem::create_directories(buildDir);
+    }
+
+    std::string MultiFileBuilder::resolveImportPath(const std::string& importPath, const std::string& currentDir)
+    {
+        return ModuleGraph::resolveImport(importPath, currentDir, options.libraryPaths);
+    }
+
     void MultiFileBuilder::discoverImports(const std::string& filePath)
     {
         if (processedModules.find(filePath) != processedModules.end())
@@ -80,67 +206,52 @@ namespace flow
         processedModules.insert(filePath);
 
 
-        std::ifstream file(filePath);
-        if (!file.is_open())
+        // Parsed once here; sema and codegen reuse the same unit
+        auto unit = ModuleGraph::instance().load(filePath);
+        if (!unit->program && unit->source.empty())
         {
-            std::cerr << "Error: Cannot open file: " << filePath << std::endl;
+            std::cerr << "Error: " << unit->error << std::endl;
             return;
         }
 
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string source = buffer.str();
-        file.close();
-
-        // Get file size
-        struct stat st;
-        size_t fileSize = 0;
-        if (stat(filePath.c_str(), &st) == 0)
-        {
-            fileSize = st.st_size;
-        }
-
 
         ModuleInfo info;
         info.sourcePath = filePath;
-        info.sourceSize = fileSize;
+        info.sourceSize = unit->source.size();
+        info.objectSize = 0;
         info.compiled = false;
+        info.sourceHash = hashString(unit->source);
+        info.interfaceHash = info.sourceHash; // refined once the module parses
+        info.cacheKey = 0;
+        info.upToDate = false;
 
 
+        // Suffix the stem with a path hash so same-named modules in different directories don't collide
         std::filesystem::path srcPath(filePath);
-        std::string objName = srcPath.stem().string() + ".o";
+        std::string objName = srcPath.stem().string() + "-" + toHex(hashString(filePath)).substr(0, 8)
+            + (options.ltoMode != 0 ? ".bc" : ".o");
         info.objectPath = buildDir + "/" + objName;
 
         modules[filePath] = info;
 
 
-        try
+        if (unit->program)
         {
-            Lexer lexer(source, filePath);
-            std::vector<Token> tokens = lexer.tokenize();
+            modules[filePath].interfaceHash = computeInterfaceHash(*unit->program);
 
-            Parser parser(tokens);
-            auto program = parser.parse();
-
-            if (program)
-            {
-                std::filesystem::path currentDir = std::filesystem::path(filePath).parent_path();
+            std::filesystem::path currentDir = std::filesystem::path(filePath).parent_path();
 
 
-                for (auto& decl : program->declarations)
+            for (auto& decl : unit->program->declarations)
+            {
+                if (auto* importDecl = dyn_cast<ImportDecl>(decl))
                 {
-                    if (auto* importDecl = dynamic_cast<ImportDecl*>(decl.get()))
-                    {
-                        std::string resolvedPath = resolveImportPath(importDecl->modulePath, currentDir.string());
-                        discoverImports(resolvedPath); // Recursive
-                    }
+                    std::string resolvedPath = resolveImportPath(importDecl->modulePath, currentDir.string());
+                    modules[filePath].imports.push_back(resolvedPath);
+                    discoverImports(resolvedPath); // Recursive
                 }
             }
         }
-        catch (const std::exception& e)
-        {
-            std::cerr << "Error parsing " << filePath << ": " << e.what() << std::endl;
-        }
     }
 
     void MultiFileBuilder::printBuildHeader()
@@ -182,101 +293,465 @@ namespace flow
         std::cout << displayName << "       \r" << std::flush;
     }
 
+    std::unique_ptr<CodeGenerator> MultiFileBuilder::generateModule(const std::string& modulePath,
+                                                                    const std::string& moduleName)
+    {
+        // Already parsed during discovery
+        auto unit = ModuleGraph::instance().load(modulePath);
+        auto program = unit->program;
+
+        if (!program)
+        {
+            ErrorReporter::errors() << "\nError: " << unit->error << " for " << modulePath << std::endl;
+            return nullptr;
+        }
+
+        // Semantic analysis
+        SemanticAnalyzer analyzer;
+        analyzer.setCurrentFile(modulePath);
+        analyzer.setLibraryPaths(options.libraryPaths);
+        {
+            llvm::TimeTraceScope timeScope("Sema", modulePath);
+            analyzer.analyze(program);
+        }
+
+        if (analyzer.hasErrors())
+        {
+            ErrorReporter::errors() << "\nError: Semantic analysis failed for " << modulePath << std::endl;
+            for (const auto& err : analyzer.getErrors())
+            {
+                ErrorReporter::errors() << "  " << err << std::endl;
+            }
+            return nullptr;
+        }
+
+        // Code generation
+        auto codegen = std::make_unique<CodeGenerator>(moduleName);
+        codegen->setOptimizationLevel(options.optimizationLevel, options.sizeLevel);
+        codegen->setTargetCPU(options.targetCPU, options.targetFeatures);
+        codegen->setProfile(options.profileGenerateFile, options.profileUseFile);
+        codegen->setStringRegions(options.stringRegions);
+        codegen->setCodegenThreads(options.codegenThreads);
+
+        // For modules with imports, declare external functions from imported modules
+
+        const auto& loadedModules = analyzer.getLoadedModules();
+        for (const auto& [importPath, importedProgram] : loadedModules)
+        {
+            if (importedProgram)
+            {
+                for (auto& decl : importedProgram->declarations)
+                {
+                    if (auto* funcDecl = dyn_cast<FunctionDecl>(decl))
+                    {
+                        codegen->declareExternalFunction(*funcDecl);
+                    }
+                }
+            }
+        }
+
+        if (!codegen->generate(program))
+        {
+            ErrorReporter::errors() << "\nError: Code generation failed for " << modulePath << std::endl;
+            return nullptr;
+        }
+        return codegen;
+    }
+
     bool MultiFileBuilder::compileModule(const std::string& modulePath)
     {
-        auto& info = modules[modulePath];
+        auto& info = modules.at(modulePath);
+        llvm::TimeTraceScope timeScope("Module", modulePath);
+
+        try
+        {
+            std::string baseName = std::filesystem::path(info.objectPath).stem().string();
+            auto codegen = generateModule(modulePath, baseName);
+            if (!codegen)
+            {
+                return false;
+            }
+
+            info.partPaths.clear();
+            if (options.ltoMode != 0)
+            {
+                // Bitcode now, native code at link time
+                codegen->setLTOMode(options.ltoMode);
+                if (!codegen->compileToBitcode(info.objectPath))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                // A large module comes back as several objects, the same ones
+                // at any --codegen-threads
+                std::vector<llvm::SmallVector<char, 0>> objects;
+                if (!codegen->compileToMemory(objects))
+                {
+                    return false;
+                }
+                for (size_t i = 0; i < objects.size(); i++)
+                {
+                    std::string path = i == 0 ? info.objectPath : partObjectPath(info.objectPath, i);
+                    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                    file.write(objects[i].data(), static_cast<std::streamsize>(objects[i].size()));
+                    if (!file)
+                    {
+                        ErrorReporter::errors() << "\nError: Cannot write " << path << std::endl;
+                        return false;
+                    }
+                    if (i > 0)
+                    {
+                        info.partPaths.push_back(path);
+                    }
+                }
+            }
+            removePartObjects(info.objectPath, info.partPaths.size() + 1);
+
+            info.objectSize = objectFilesSize(info);
 
-        // Read source
-        std::ifstream file(modulePath);
-        if (!file.is_open())
+            info.compiled = true;
+            return true;
+        }
+        catch (const std::exception& e)
         {
-            std::cerr << "\nError: Cannot open " << modulePath << std::endl;
+            ErrorReporter::errors() << "\nError compiling " << modulePath << ": " << e.what() << std::endl;
             return false;
         }
+    }
 
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string source = buffer.str();
-        file.close();
+    std::string MultiFileBuilder::compilerFingerprint() const
+    {
+        // Rebuilding the compiler invalidates the cache through its size and mtime
+        std::string fingerprint = "flow 0.1.0; llvm " LLVM_VERSION_STRING;
+        static int anchor;
+        std::string exePath = llvm::sys::fs::getMainExecutable(nullptr, &anchor);
+        llvm::sys::fs::file_status status;
+        if (!exePath.empty() && !llvm::sys::fs::status(exePath, status))
+        {
+            fingerprint += "; exe " + std::to_string(status.getSize()) + "@"
+                + std::to_string(status.getLastModificationTime().time_since_epoch().count());
+        }
 
-        try
+        fingerprint += "; -O" + std::to_string(options.optimizationLevel) + "/" + std::to_string(options.sizeLevel);
+        fingerprint += "; cpu " + CodeGenerator::resolveTargetCPU(options.targetCPU);
+        fingerprint += "; features " + CodeGenerator::resolveTargetFeatures(options.targetCPU, options.targetFeatures);
+        fingerprint += "; lto " + std::to_string(options.ltoMode);
+        fingerprint += options.stringRegions ? "; string regions" : "; string memory none";
+        if (!options.profileGenerateFile.empty())
+        {
+            fingerprint += "; profile-generate " + options.profileGenerateFile;
+        }
+        if (!options.profileUseFile.empty() && !llvm::sys::fs::status(options.profileUseFile, status))
+        {
+            // A new profile changes the optimized code of every module
+            fingerprint += "; profile-use " + options.profileUseFile + " " + std::to_string(status.getSize()) + "@"
+                + std::to_string(status.getLastModificationTime().time_since_epoch().count());
+        }
+        for (const auto& path : options.libraryPaths)
+        {
+            fingerprint += "; -L" + path;
+        }
+        return fingerprint;
+    }
+
+    uint64_t MultiFileBuilder::transitiveInterfaceHash(const std::string& modulePath,
+                                                       std::map<std::string, uint64_t>& memo,
+                                                       std::set<std::string>& visiting)
+    {
+        auto memoIt = memo.find(modulePath);
+        if (memoIt != memo.end())
+        {
+            return memoIt->second;
+        }
+
+        const auto& info = modules.at(modulePath);
+        if (!visiting.insert(modulePath).second)
         {
-            // Lex
-            Lexer lexer(source, modulePath);
-            std::vector<Token> tokens = lexer.tokenize();
+            return info.interfaceHash; // import cycle
+        }
 
-            if (tokens.empty())
+        std::string data = toHex(info.interfaceHash);
+        for (const auto& import : info.imports)
+        {
+            data += import;
+            if (modules.find(import) != modules.end())
             {
-                std::cerr << "\nError: Lexing failed for " << modulePath << std::endl;
-                return false;
+                data += toHex(transitiveInterfaceHash(import, memo, visiting));
             }
+        }
 
-            // Parse
-            Parser parser(tokens);
-            auto program = parser.parse();
+        visiting.erase(modulePath);
+        uint64_t hash = hashString(data);
+        memo[modulePath] = hash;
+        return hash;
+    }
+
+    void MultiFileBuilder::computeCacheKeys()
+    {
+        std::string fingerprint = compilerFingerprint();
+        std::map<std::string, uint64_t> memo;
+        std::set<std::string> visiting;
 
-            if (!program)
+        for (auto& [path, info] : modules)
+        {
+            std::string data = fingerprint + "\n" + path + "\n" + toHex(info.sourceHash);
+            for (const auto& import : info.imports)
             {
-                std::cerr << "\nError: Parsing failed for " << modulePath << std::endl;
-                return false;
+                data += "\n" + import;
+                if (modules.find(import) != modules.end())
+                {
+                    data += " " + toHex(transitiveInterfaceHash(import, memo, visiting));
+                }
             }
+            info.cacheKey = hashString(data);
 
-            // Semantic analysis
-            SemanticAnalyzer analyzer;
-            analyzer.setCurrentFile(modulePath);
-            analyzer.analyze(program);
+            auto cached = manifestModules.find(path);
+            info.upToDate = cached != manifestModules.end() && cached->second == info.cacheKey
+                && std::filesystem::exists(info.objectPath);
+        }
+    }
+
+    void MultiFileBuilder::loadManifest()
+    {
+        std::ifstream file(buildDir + "/manifest");
+        std::string line;
+        if (!file.is_open() || !std::getline(file, line) || line != MANIFEST_HEADER)
+        {
+            return; // Missing or from an incompatible version: rebuild everything
+        }
 
-            if (analyzer.hasErrors())
+        while (std::getline(file, line))
+        {
+            // <kind> <16 hex digit key> <path>
+            size_t keyStart = line.find(' ');
+            if (keyStart == std::string::npos || line.length() < keyStart + 19) continue;
+
+            std::string kind = line.substr(0, keyStart);
+            uint64_t key = std::strtoull(line.substr(keyStart + 1, 16).c_str(), nullptr, 16);
+            std::string path = line.substr(keyStart + 18);
+
+            if (kind == "module")
+            {
+                manifestModules[path] = key;
+            }
+            else if (kind == "output")
+            {
+                manifestOutputs[path] = key;
+            }
+        }
+    }
+
+    void MultiFileBuilder::saveManifest()
+    {
+        for (const auto& [path, info] : modules)
+        {
+            // Entries for modules that didn't build keep their old key, which no longer matches
+            if (info.compiled)
+            {
+                manifestModules[path] = info.cacheKey;
+            }
+        }
+
+        // Write then rename so an interrupted build never leaves a truncated manifest
+        std::string manifestPath = buildDir + "/manifest";
+        std::string tempPath = manifestPath + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::trunc);
+            if (!file.is_open())
+            {
+                std::cerr << "Warning: Cannot write build manifest: " << manifestPath << std::endl;
+                return;
+            }
+
+            file << MANIFEST_HEADER << "\n";
+            for (const auto& [path, key] : manifestModules)
+            {
+                file << "module " << toHex(key) << " " << path << "\n";
+            }
+            for (const auto& [path, key] : manifestOutputs)
+            {
+                file << "output " << toHex(key) << " " << path << "\n";
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, manifestPath, ec);
+        if (ec)
+        {
+            std::cerr << "Warning: Cannot write build manifest: " << ec.message() << std::endl;
+        }
+    }
+
+    uint64_t MultiFileBuilder::linkKey() const
+    {
+        // Module keys already cover the flags, but the linker also reads
+        // the extra objects from the command line
+        std::string data = outputFile + "\n" + compilerFingerprint();
+        for (const auto& [path, info] : modules)
+        {
+            data += "\n" + info.objectPath + " " + toHex(info.cacheKey);
+        }
+        for (const auto& obj : options.objectFiles)
+        {
+            data += "\nobject " + obj + " " + toHex(hashFile(obj));
+        }
+        return hashString(data);
+    }
+
+    bool MultiFileBuilder::outputUpToDate() const
+    {
+        for (const auto& [path, info] : modules)
+        {
+            if (!info.upToDate) return false;
+        }
+
+        auto cached = manifestOutputs.find(outputFile);
+        return cached != manifestOutputs.end() && cached->second == linkKey()
+            && std::filesystem::exists(outputFile);
+    }
+
+    bool MultiFileBuilder::compileAllModules()
+    {
+        // Each module waits for the modules it imports. Cycles are broken at the
+        // back edge found by the depth-first walk so the schedule can't deadlock.
+        std::map<std::string, std::vector<std::string>> dependents;
+        std::map<std::string, size_t> remaining;
+        std::map<std::string, int> visitState; // 0 = new, 1 = on stack, 2 = done
+
+        std::function<void(const std::string&)> visitModule = [&](const std::string& path)
+        {
+            visitState[path] = 1;
+            remaining[path]; // every module gets an entry, even with no imports
+            for (const auto& import : modules.at(path).imports)
             {
-                std::cerr << "\nError: Semantic analysis failed for " << modulePath << std::endl;
-                for (const auto& err : analyzer.getErrors())
+                if (modules.find(import) == modules.end() || visitState[import] == 1)
                 {
-                    std::cerr << "  " << err << std::endl;
+                    continue;
                 }
-                return false;
+                if (visitState[import] == 0)
+                {
+                    visitModule(import);
+                }
+                dependents[import].push_back(path);
+                remaining[path]++;
             }
+            visitState[path] = 2;
+        };
 
-            // Code generation
-            std::filesystem::path objPath(info.objectPath);
-            std::string baseName = objPath.stem().string();
+        for (const auto& [path, info] : modules)
+        {
+            if (visitState[path] == 0)
+            {
+                visitModule(path);
+            }
+        }
 
-            CodeGenerator codegen(baseName);
+        unsigned jobs = options.jobs == 0 ? ThreadPool::hardwareThreads() : options.jobs;
+        if (jobs > modules.size())
+        {
+            jobs = static_cast<unsigned>(modules.size());
+        }
+
+        if (verbose)
+        {
+            std::cout << "  Parallel jobs: " << jobs << "\n\n";
+        }
 
-            // For modules with imports, declare external functions from imported modules
+        ThreadPool pool(jobs);
+        std::mutex progressMutex;
+        std::atomic<bool> failed(false);
+        int completed = 0;
+        int total = modules.size();
 
-            const auto& loadedModules = analyzer.getLoadedModules();
-            for (const auto& [importPath, importedProgram] : loadedModules)
+        std::function<void(const std::string&)> schedule = [&](const std::string& path)
+        {
+            pool.submit([&, path]
             {
-                if (importedProgram)
+                auto& info = modules.at(path);
+
+                if (info.upToDate)
+                {
+                    // Reuse the cached objects
+                    info.partPaths = existingPartObjects(info.objectPath);
+                    info.objectSize = objectFilesSize(info);
+                    info.compiled = true;
+                }
+                else if (!failed)
+                {
+                    // Capture diagnostics so they can be replayed in a fixed order
+                    std::ostringstream log;
+                    ErrorReporter::redirect(&log, &log);
+                    bool ok = compileModule(path);
+                    ErrorReporter::redirect(nullptr, nullptr);
+
+                    info.log = log.str();
+                    if (!ok)
+                    {
+                        failed = true;
+                    }
+                }
+
+                std::vector<std::string> ready;
                 {
-                    for (auto& decl : importedProgram->declarations)
+                    std::lock_guard<std::mutex> lock(progressMutex);
+                    if (info.compiled)
                     {
-                        if (auto* funcDecl = dynamic_cast<FunctionDecl*>(decl.get()))
+                        std::string name = std::filesystem::path(path).filename().string();
+                        printModuleProgress(++completed, total, info.upToDate ? name + " (cached)" : name);
+                    }
+                    for (const auto& dependent : dependents[path])
+                    {
+                        if (--remaining[dependent] == 0)
                         {
-                            codegen.declareExternalFunction(*funcDecl);
+                            ready.push_back(dependent);
                         }
                     }
                 }
-            }
 
-            codegen.generate(program);
-            codegen.compileToObject(info.objectPath);
+                if (!failed)
+                {
+                    for (const auto& next : ready)
+                    {
+                        schedule(next);
+                    }
+                }
+            });
+        };
 
-            // Get object file size
-            struct stat st;
-            if (stat(info.objectPath.c_str(), &st) == 0)
+        for (const auto& [path, count] : remaining)
+        {
+            if (count == 0)
             {
-                info.objectSize = st.st_size;
+                schedule(path);
             }
+        }
 
-            info.compiled = true;
-            return true;
+        try
+        {
+            pool.wait();
         }
         catch (const std::exception& e)
         {
-            std::cerr << "\nError compiling " << modulePath << ": " << e.what() << std::endl;
-            return false;
+            ErrorReporter::errors() << "\nError: " << e.what() << std::endl;
+            failed = true;
         }
+
+        // Replay diagnostics in module order, independent of thread timing
+        bool printedNewline = false;
+        for (const auto& [path, info] : modules)
+        {
+            if (info.log.empty()) continue;
+            if (!printedNewline)
+            {
+                std::cout << "\n" << std::flush;
+                printedNewline = true;
+            }
+            std::cerr << info.log;
+        }
+
+        return !failed;
     }
 
     void MultiFileBuilder::printLinkingInfo(const std::vector<std::string>& objectFiles)
@@ -307,6 +782,7 @@ namespace flow
             if (info.compiled)
             {
                 objectFiles.push_back(info.objectPath);
+                objectFiles.insert(objectFiles.end(), info.partPaths.begin(), info.partPaths.end());
             }
         }
 
@@ -318,31 +794,62 @@ namespace flow
 
         printLinkingInfo(objectFiles);
 
-        // Build link command
-        std::string linkCmd;
-#ifdef __APPLE__
-        linkCmd = "clang++ -o " + outputFile;
-#else
-        linkCmd = "g++ -o " + outputFile;
-#endif
+        Linker linker(outputFile);
+        linker.setVerbose(verbose);
+        if (options.ltoMode != 0)
+        {
+            auto began = std::chrono::steady_clock::now();
+
+            LTOBackend lto(options.ltoMode);
+            lto.setTarget(options.targetCPU, options.targetFeatures);
+            lto.setOptimizationLevel(options.optimizationLevel);
+            lto.setJobs(options.jobs);
+            lto.setCacheDirectory(buildDir + "/lto-cache");
+            // Native objects on the command line may call into Flow code
+            lto.setExportAllSymbols(!options.objectFiles.empty());
+            for (const auto& obj : objectFiles)
+            {
+                lto.addBitcodeFile(obj);
+            }
+            if (!lto.run(linker))
+            {
+                return false;
+            }
 
-        for (const auto& obj : objectFiles)
+            double elapsed = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - began).count();
+            std::cout << "  " << (options.ltoMode == 1 ? "ThinLTO" : "Full LTO") << " in " << std::fixed
+                << std::setprecision(1) << elapsed << " ms\n";
+        }
+        else
+        {
+            for (const auto& obj : objectFiles)
+            {
+                linker.addObjectFile(obj);
+            }
+        }
+        for (const auto& libPath : options.libraryPaths)
         {
-            linkCmd += " " + obj;
+            linker.addLibraryPath(libPath);
         }
-
-        if (verbose)
+        for (const auto& obj : options.objectFiles)
         {
-            std::cout << "  Command: " << linkCmd << "\n\n";
+            linker.addObjectFile(obj);
+        }
+        if (!linker.addFlowRuntime() ||
+            (!options.profileGenerateFile.empty() && !linker.addProfileRuntime()))
+        {
+            return false;
         }
 
-        int result = system(linkCmd.c_str());
-        if (result != 0)
+        if (!linker.link())
         {
-            std::cerr << "Error: Linking failed\n";
             return false;
         }
 
+        std::cout << "  Linked with " << linker.getLinkerUsed() << " in " << std::fixed << std::setprecision(1)
+            << linker.getLinkMilliseconds() << " ms\n\n";
+
         return true;
     }
 
@@ -365,7 +872,14 @@ namespace flow
             }
         }
 
-        std::cout << "  Modules compiled:  " << modules.size() << "\n";
+        size_t reused = 0;
+        for (const auto& [path, info] : modules)
+        {
+            if (info.upToDate) reused++;
+        }
+
+        std::cout << "  Modules compiled:  " << modules.size() - reused << "\n";
+        std::cout << "  Modules reused:    " << reused << "\n";
         std::cout << "  Source code size:  " << totalSource << " bytes\n";
         std::cout << "  Object code size:  " << totalObject << " bytes\n";
 
@@ -399,6 +913,9 @@ namespace flow
             return false;
         }
 
+        loadManifest();
+        computeCacheKeys();
+
         printBuildHeader();
 
         // Phase 2: Compile each module
@@ -406,31 +923,38 @@ namespace flow
         std::cout << "  Compilation Phase\n";
         std::cout << "----------------------------------------------------------------\n\n";
 
-        int current = 0;
-        int total = modules.size();
+        bool compiled = compileAllModules();
+        saveManifest();
 
-        for (auto& [path, info] : modules)
+        if (!compiled)
         {
-            current++;
+            std::cout << "\n";
+            return false;
+        }
 
-            std::filesystem::path p(path);
-            std::string moduleName = p.filename().string();
+        std::cout << "\n\n  All modules compiled successfully\n";
+        if (verbose)
+        {
+            std::cout << "  Files parsed:  " << ModuleGraph::instance().parseCount() << "\n";
+        }
 
-            printModuleProgress(current, total, moduleName);
+        // Phase 3: Link (skipped when no object changed since the last link)
+        if (outputUpToDate())
+        {
+            std::cout << "\n  Output up to date: " << outputFile << "\n";
+        }
+        else
+        {
+            manifestOutputs.erase(outputFile);
+            saveManifest();
 
-            if (!compileModule(path))
+            if (!linkModules())
             {
-                std::cout << "\n";
                 return false;
             }
-        }
 
-        std::cout << "\n\n  All modules compiled successfully\n";
-
-        // Phase 3: Link
-        if (!linkModules())
-        {
-            return false;
+            manifestOutputs[outputFile] = linkKey();
+            saveManifest();
         }
 
         // Phase 4: Summary
@@ -438,4 +962,62 @@ namespace flow
 
         return true;
     }
+
+    int MultiFileBuilder::run()
+    {
+        discoverImports(mainFile);
+
+        if (modules.empty())
+        {
+            std::cerr << "Error: No modules found\n";
+            return 1;
+        }
+
+        JITRunner runner;
+        for (const auto& libPath : options.libraryPaths)
+        {
+            runner.addLibraryPath(libPath);
+        }
+
+        // Every module goes into the same JIT, which resolves calls between them
+        for (const auto& [path, info] : modules)
+        {
+            std::unique_ptr<CodeGenerator> codegen;
+            try
+            {
+                codegen = generateModule(path, std::filesystem::path(path).stem().string());
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Error compiling " << path << ": " << e.what() << std::endl;
+                return 1;
+            }
+
+            if (!codegen)
+            {
+                return 1;
+            }
+
+            codegen->optimizeModule();
+
+            bool loaded = true;
+            for (const auto& lib : codegen->getLinkedLibraries())
+            {
+                loaded = loaded && runner.addLibrary(lib);
+            }
+            if (!loaded || !runner.addModule(*codegen))
+            {
+                std::cerr << "Error: " << runner.getError() << std::endl;
+                return 1;
+            }
+        }
+
+        int exitCode = runner.runMain(mainFile, options.runArgs);
+        if (!runner.getError().empty())
+        {
+            std::cerr << "Error: " << runner.getError() << std::endl;
+            return 1;
+        }
+        return exitCode;
+    }
 } // namespace flow
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "../../include/Parser/Parser.h"
 #include "../../include/Sema/SemanticAnalyzer.h"
 #include "../../include/Codegen/CodeGenerator.h"
+#include "../../include/Common/SourceManager.h"
+#include "../../include/Stdlib/FlowString.h"
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/ExecutionEngine/GenericValue.h>
 #include <llvm/ExecutionEngine/MCJIT.h>
@@ -13,7 +15,6 @@
 #include <map>
 #include <vector>
 #include <memory>
-#include <fstream>
 #include <sstream>
 
 using namespace flow;
@@ -24,7 +25,11 @@ struct FlowRuntime
     std::string lastError;
     bool initialized;
 
-    FlowRuntime() : initialized(false)
+    // JIT target; defaults to the host so vectorized code can use wide registers
+    std::string targetCPU;
+    std::string targetFeatures;
+
+    FlowRuntime() : initialized(false), targetCPU("native")
     {
         llvm::InitializeNativeTarget();
         llvm::InitializeNativeTargetAsmPrinter();
@@ -122,23 +127,22 @@ const char* flow_runtime_get_error(FlowRuntime* runtime)
     return runtime->lastError.c_str();
 }
 
-
-FlowModule* flow_module_compile(FlowRuntime* runtime, const char* source, const char* module_name)
+FlowResult flow_runtime_set_target(FlowRuntime* runtime, const char* cpu, const char* features)
 {
-    if (!runtime || !source || !module_name)
-    {
-        if (runtime) runtime->lastError = "Invalid parameters";
-        return nullptr;
-    }
+    if (!runtime || !cpu) return FLOW_ERROR_INVALID_ARGS;
+    runtime->targetCPU = cpu;
+    runtime->targetFeatures = features ? features : "";
+    return FLOW_OK;
+}
 
+
+static FlowModule* compileSource(FlowRuntime* runtime, const SourceFile& source, const char* module_name)
+{
     try
     {
-        // Lexical analysis
-        Lexer lexer(source, module_name);
-        auto tokens = lexer.tokenize();
-
-        // Parsing
-        Parser parser(tokens);
+        // Lexing and parsing
+        Lexer lexer(source);
+        Parser parser(lexer);
         auto program = parser.parse();
 
         // Semantic analysis
@@ -152,7 +156,11 @@ FlowModule* flow_module_compile(FlowRuntime* runtime, const char* source, const
 
         // Code generation
         auto codegen = std::make_unique<CodeGenerator>(module_name);
-        codegen->generate(program);
+        if (!codegen->generate(program))
+        {
+            runtime->lastError = "Code generation failed";
+            return nullptr;
+        }
 
         // Create module
         FlowModule* module = new FlowModule();
@@ -164,7 +172,7 @@ FlowModule* flow_module_compile(FlowRuntime* runtime, const char* source, const
         // Index functions
         for (auto& decl : program->declarations)
         {
-            if (FunctionDecl* funcDecl = dynamic_cast<FunctionDecl*>(decl.get()))
+            if (FunctionDecl* funcDecl = dyn_cast<FunctionDecl>(decl))
             {
                 FlowFunction* func = new FlowFunction(module, funcDecl->name, funcDecl);
                 module->functions[funcDecl->name] = func;
@@ -180,6 +188,17 @@ FlowModule* flow_module_compile(FlowRuntime* runtime, const char* source, const
     }
 }
 
+FlowModule* flow_module_compile(FlowRuntime* runtime, const char* source, const char* module_name)
+{
+    if (!runtime || !source || !module_name)
+    {
+        if (runtime) runtime->lastError = "Invalid parameters";
+        return nullptr;
+    }
+
+    return compileSource(runtime, *SourceManager::instance().addBuffer(module_name, source), module_name);
+}
+
 FlowModule* flow_module_load_file(FlowRuntime* runtime, const char* file_path)
 {
     if (!runtime || !file_path)
@@ -190,18 +209,15 @@ FlowModule* flow_module_load_file(FlowRuntime* runtime, const char* file_path)
 
     try
     {
-        std::ifstream file(file_path);
-        if (!file.is_open())
+        // Mapped, not copied
+        auto file = SourceManager::instance().loadFile(file_path);
+        if (!file)
         {
             runtime->lastError = std::string("Failed to open file: ") + file_path;
             return nullptr;
         }
 
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string source = buffer.str();
-
-        return flow_module_compile(runtime, source.c_str(), file_path);
+        return compileSource(runtime, *file, file_path);
     }
     catch (const std::exception& e)
     {
@@ -399,6 +415,17 @@ FlowResult flow_function_call(FlowRuntime* runtime, FlowFunction* function,
             llvm::EngineBuilder builder(std::move(moduleClone));
             builder.setErrorStr(&errorStr);
             builder.setEngineKind(llvm::EngineKind::JIT);
+            builder.setMCPU(CodeGenerator::resolveTargetCPU(runtime->targetCPU));
+
+            std::vector<std::string> attrs;
+            std::stringstream features(CodeGenerator::resolveTargetFeatures(runtime->targetCPU,
+                                                                            runtime->targetFeatures));
+            std::string feature;
+            while (std::getline(features, feature, ','))
+            {
+                if (!feature.empty()) attrs.push_back(feature);
+            }
+            builder.setMAttrs(attrs);
 
             llvm::ExecutionEngine* engine = builder.create();
             if (!engine)
@@ -486,14 +513,18 @@ FlowResult flow_function_call(FlowRuntime* runtime, FlowFunction* function,
                 return FLOW_ERROR_TYPE_MISMATCH;
             }
         }
-        else if (returnType->isPointerTy())
+        else if (returnType->isStructTy() && returnType->getStructName().starts_with("flow.string"))
         {
             if (arg_count == 2)
             {
-                typedef const char* (*FuncType)(const char*, const char*);
+                // Flow strings are { data, length } pairs
+                typedef FlowString (*FuncType)(FlowString, FlowString);
                 FuncType func = reinterpret_cast<FuncType>(funcAddr);
-                const char* result_value = func(args[0]->string_value.c_str(), args[1]->string_value.c_str());
-                *result = flow_value_new_string(runtime, result_value ? result_value : "");
+                FlowString result_value = func(
+                    FlowString{args[0]->string_value.data(), static_cast<int64_t>(args[0]->string_value.size())},
+                    FlowString{args[1]->string_value.data(), static_cast<int64_t>(args[1]->string_value.size())});
+                std::string value = result_value.data ? std::string(result_value.data, result_value.length) : "";
+                *result = flow_value_new_string(runtime, value.c_str());
             }
             else
             {
@@ -2,6 +2,7 @@
 #include "../../include/LSP/LSPErrorCollector.h"
 #include "../../include/Lexer/Lexer.h"
 #include "../../include/Common/ErrorReporter.h"
+#include "../../include/Common/ModuleGraph.h"
 #include "../../include/Runtime/ReflectionManager.h"
 #include "../../include/Runtime/ForeignModuleLoader.h"
 #include <iostream>
@@ -13,7 +14,32 @@ namespace flow
 {
     namespace lsp
     {
-        static std::string extractIdentifierAtPosition(const std::string& text, Position pos);
+        static std::string extractIdentifierAtPosition(const SourceFile& source, Position pos);
+
+        // file:///a/b.flow -> /a/b.flow (the module graph and import resolution use paths)
+        static std::string uriToPath(const std::string& uri)
+        {
+            const std::string prefix = "file://";
+            if (uri.compare(0, prefix.size(), prefix) != 0)
+            {
+                return uri;
+            }
+
+            std::string path;
+            for (size_t i = prefix.size(); i < uri.size(); i++)
+            {
+                if (uri[i] == '%' && i + 2 < uri.size())
+                {
+                    path += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                    i += 2;
+                }
+                else
+                {
+                    path += uri[i];
+                }
+            }
+            return path;
+        }
 
         std::string escapeJSON(const std::string& str)
         {
@@ -338,32 +364,32 @@ namespace flow
                 // Debug: Log that we're starting analysis
                 std::cerr << "Analyzing document: " << doc.uri << std::endl;
 
-                // Lexical analysis
-                Lexer lexer(doc.text, doc.uri);
-                std::vector<Token> tokens = lexer.tokenize();
+                // Lexing and parsing; the parse, the module graph overlay and
+                // position lookups all share this one copy of the text
+                std::string path = uriToPath(doc.uri);
+                doc.source = SourceManager::instance().addBuffer(path, doc.text);
+                Lexer lexer(*doc.source);
+                Parser parser(lexer);
+                parser.setErrorCollector(&errorCollector);
+                doc.ast = parser.parse();
 
-                std::cerr << "LSP: Tokenization complete, got " << tokens.size() << " tokens" << std::endl;
+                std::cerr << "LSP: Parsing complete, " << parser.getTokenCount() << " tokens" << std::endl;
 
-                if (tokens.empty() || tokens.back().type == TokenType::INVALID)
+                if (!doc.ast && !lexer.getError().empty())
                 {
+                    // The parser reported where the lexer stopped
+                    const auto& error = errorCollector.getErrors().back();
                     Diagnostic diag;
-                    diag.range.start = Position(0, 0);
-                    diag.range.end = Position(0, 10);
+                    diag.range.start = Position(error.location.line - 1, error.location.column - 1);
+                    diag.range.end = Position(error.location.line - 1, error.location.column);
                     diag.severity = DiagnosticSeverity::Error;
-                    diag.message = "Lexical analysis failed";
+                    diag.message = error.message;
                     diag.source = "Flow Lexer";
                     doc.diagnostics.push_back(diag);
                     publishDiagnostics(doc.uri, doc.diagnostics);
                     return;
                 }
 
-                // Parsing
-                Parser parser(tokens);
-                parser.setErrorCollector(&errorCollector);
-                doc.ast = parser.parse();
-
-                std::cerr << "LSP: Parsing complete" << std::endl;
-
                 if (!doc.ast)
                 {
                     Diagnostic diag;
@@ -383,11 +409,14 @@ namespace flow
                 // TODO: Fix ReflectionManager - temporarily disabled due to stack overflow in map insertion
                 std::cerr << "LSP: Skipping ReflectionManager (known issue with std::map causing SIGSEGV)" << std::endl;
 
+                // Publish the editor's version so other open documents importing it see unsaved changes
+                ModuleGraph::instance().setOverlay(path, doc.source, doc.ast);
+
                 std::cerr << "LSP: Starting semantic analysis..." << std::endl;
                 SemanticAnalyzer analyzer;
                 analyzer.setLibraryPaths(libraryPaths);
                 analyzer.setErrorCollector(&errorCollector);
-                analyzer.setCurrentFile(doc.uri);
+                analyzer.setCurrentFile(path);
                 std::cerr << "LSP: Calling analyzer.analyze()..." << std::endl;
                 analyzer.analyze(doc.ast);
                 std::cerr << "LSP: Semantic analysis complete!" << std::endl;
@@ -518,6 +547,7 @@ namespace flow
                 std::string uri = json["textDocument"]["uri"];
 
                 documents.erase(uri);
+                ModuleGraph::instance().clearOverlay(uriToPath(uri));
                 return "";
             }
             catch (const std::exception& e)
@@ -564,6 +594,7 @@ namespace flow
                 {"min", "min(a: int, b: int) -> int"},
                 {"max", "max(a: int, b: int) -> int"},
                 {"len", "len(array: T[]) -> int"},
+                {"push", "push(array: T[], value: T)"},
                 {"substr", "substr(s: string, start: int, len: int) -> string"},
                 {"concat", "concat(s1: string, s2: string) -> string"}
             };
@@ -617,7 +648,7 @@ namespace flow
                 // Extract functions
                 for (const auto& decl : ast->declarations)
                 {
-                    if (auto funcDecl = std::dynamic_pointer_cast<FunctionDecl>(decl))
+                    if (auto funcDecl = dyn_cast<FunctionDecl>(decl))
                     {
                         CompletionItem item(funcDecl->name, CompletionItemKind::Function);
 
@@ -648,7 +679,7 @@ namespace flow
                     }
 
                     // Extract structs
-                    if (auto structDecl = std::dynamic_pointer_cast<StructDecl>(decl))
+                    if (auto structDecl = dyn_cast<StructDecl>(decl))
                     {
                         CompletionItem item(structDecl->name, CompletionItemKind::Struct);
                         item.detail = "struct " + structDecl->name;
@@ -667,7 +698,7 @@ namespace flow
                     }
 
                     // Extract type aliases
-                    if (auto typedefDecl = std::dynamic_pointer_cast<TypeDefDecl>(decl))
+                    if (auto typedefDecl = dyn_cast<TypeDefDecl>(decl))
                     {
                         CompletionItem item(typedefDecl->name, CompletionItemKind::TypeParameter);
                         if (typedefDecl->aliasedType)
@@ -678,7 +709,7 @@ namespace flow
                     }
 
                     // Extract foreign functions from link blocks
-                    if (auto linkDecl = std::dynamic_pointer_cast<LinkDecl>(decl))
+                    if (auto linkDecl = dyn_cast<LinkDecl>(decl))
                     {
                         auto& moduleLoader = flow::ForeignModuleLoader::getInstance();
                         moduleLoader.loadAndRegisterModule(linkDecl->adapter, linkDecl->module);
@@ -769,7 +800,7 @@ namespace flow
             }
 
             auto& doc = docIt->second;
-            std::string identifier = extractIdentifierAtPosition(doc.text, pos);
+            std::string identifier = doc.source ? extractIdentifierAtPosition(*doc.source, pos) : "";
             if (identifier.empty())
             {
                 hover.contents = "Flow Language";
@@ -779,7 +810,7 @@ namespace flow
             // Look for symbol information
             for (const auto& decl : doc.ast->declarations)
             {
-                if (auto funcDecl = std::dynamic_pointer_cast<FunctionDecl>(decl))
+                if (auto funcDecl = dyn_cast<FunctionDecl>(decl))
                 {
                     if (funcDecl->name == identifier)
                     {
@@ -812,7 +843,7 @@ namespace flow
                     }
                 }
 
-                if (auto structDecl = std::dynamic_pointer_cast<StructDecl>(decl))
+                if (auto structDecl = dyn_cast<StructDecl>(decl))
                 {
                     if (structDecl->name == identifier)
                     {
@@ -836,7 +867,7 @@ namespace flow
                     }
                 }
 
-                if (auto typedefDecl = std::dynamic_pointer_cast<TypeDefDecl>(decl))
+                if (auto typedefDecl = dyn_cast<TypeDefDecl>(decl))
                 {
                     if (typedefDecl->name == identifier)
                     {
@@ -876,6 +907,7 @@ namespace flow
                 {"min", "min(a: int, b: int) -> int\n\nReturns minimum of two values"},
                 {"max", "max(a: int, b: int) -> int\n\nReturns maximum of two values"},
                 {"len", "len(array: T[]) -> int\n\nReturns length of array"},
+                {"push", "push(array: T[], value: T)\n\nAppends value to the end of array"},
                 {"substr", "substr(s: string, start: int, len: int) -> string\n\nReturns substring"},
                 {"concat", "concat(s1: string, s2: string) -> string\n\nConcatenates two strings"}
             };
@@ -918,7 +950,7 @@ namespace flow
             }
 
             auto& doc = docIt->second;
-            std::string identifier = extractIdentifierAtPosition(doc.text, pos);
+            std::string identifier = doc.source ? extractIdentifierAtPosition(*doc.source, pos) : "";
             if (identifier.empty())
             {
                 return locations;
@@ -926,7 +958,7 @@ namespace flow
 
             for (auto& decl : doc.ast->declarations)
             {
-                if (auto funcDecl = std::dynamic_pointer_cast<FunctionDecl>(decl))
+                if (auto funcDecl = dyn_cast<FunctionDecl>(decl))
                 {
                     if (funcDecl->name == identifier)
                     {
@@ -940,7 +972,7 @@ namespace flow
                     }
                 }
 
-                if (auto structDecl = std::dynamic_pointer_cast<StructDecl>(decl))
+                if (auto structDecl = dyn_cast<StructDecl>(decl))
                 {
                     if (structDecl->name == identifier)
                     {
@@ -968,7 +1000,7 @@ namespace flow
                     }
                 }
 
-                if (auto typedefDecl = std::dynamic_pointer_cast<TypeDefDecl>(decl))
+                if (auto typedefDecl = dyn_cast<TypeDefDecl>(decl))
                 {
                     if (typedefDecl->name == identifier)
                     {
@@ -986,22 +1018,10 @@ namespace flow
             return locations;
         }
 
-        static std::string extractIdentifierAtPosition(const std::string& text, Position pos)
+        static std::string extractIdentifierAtPosition(const SourceFile& source, Position pos)
         {
-            std::vector<std::string> lines;
-            std::string line;
-            std::istringstream stream(text);
-            while (std::getline(stream, line))
-            {
-                lines.push_back(line);
-            }
-
-            if (pos.line >= static_cast<int>(lines.size()))
-            {
-                return "";
-            }
-
-            const std::string& currentLine = lines[pos.line];
+            // LSP positions are 0-based
+            std::string_view currentLine = source.getLine(pos.line + 1);
             if (pos.character >= static_cast<int>(currentLine.length()))
             {
                 return "";
@@ -1026,7 +1046,7 @@ namespace flow
                 return "";
             }
 
-            return currentLine.substr(start, end - start);
+            return std::string(currentLine.substr(start, end - start));
         }
 
         std::string LanguageServer::handleTextDocumentDefinition(const std::string& params)
@@ -1071,18 +1091,18 @@ namespace flow
             }
 
             auto& doc = docIt->second;
-            std::string identifier = extractIdentifierAtPosition(doc.text, pos);
+            std::string identifier = doc.source ? extractIdentifierAtPosition(*doc.source, pos) : "";
             if (identifier.empty())
             {
                 return locations;
             }
 
-            std::function < void(std::shared_ptr<Expr>) > searchExprForReferences;
-            searchExprForReferences = [&](std::shared_ptr<Expr> expr)
+            std::function < void(Expr*) > searchExprForReferences;
+            searchExprForReferences = [&](Expr* expr)
             {
                 if (!expr) return;
 
-                if (auto idExpr = std::dynamic_pointer_cast<IdentifierExpr>(expr))
+                if (auto idExpr = dyn_cast<IdentifierExpr>(expr))
                 {
                     if (idExpr->name == identifier)
                     {
@@ -1094,16 +1114,16 @@ namespace flow
                         locations.push_back(loc);
                     }
                 }
-                else if (auto binExpr = std::dynamic_pointer_cast<BinaryExpr>(expr))
+                else if (auto binExpr = dyn_cast<BinaryExpr>(expr))
                 {
                     searchExprForReferences(binExpr->left);
                     searchExprForReferences(binExpr->right);
                 }
-                else if (auto unaryExpr = std::dynamic_pointer_cast<UnaryExpr>(expr))
+                else if (auto unaryExpr = dyn_cast<UnaryExpr>(expr))
                 {
                     searchExprForReferences(unaryExpr->operand);
                 }
-                else if (auto callExpr = std::dynamic_pointer_cast<CallExpr>(expr))
+                else if (auto callExpr = dyn_cast<CallExpr>(expr))
                 {
                     searchExprForReferences(callExpr->callee);
                     for (auto& arg : callExpr->arguments)
@@ -1111,41 +1131,41 @@ namespace flow
                         searchExprForReferences(arg);
                     }
                 }
-                else if (auto memberExpr = std::dynamic_pointer_cast<MemberAccessExpr>(expr))
+                else if (auto memberExpr = dyn_cast<MemberAccessExpr>(expr))
                 {
                     searchExprForReferences(memberExpr->object);
                 }
-                else if (auto structExpr = std::dynamic_pointer_cast<StructInitExpr>(expr))
+                else if (auto structExpr = dyn_cast<StructInitExpr>(expr))
                 {
                     for (auto& fieldVal : structExpr->fieldValues)
                     {
                         searchExprForReferences(fieldVal);
                     }
                 }
-                else if (auto arrayExpr = std::dynamic_pointer_cast<ArrayLiteralExpr>(expr))
+                else if (auto arrayExpr = dyn_cast<ArrayLiteralExpr>(expr))
                 {
                     for (auto& elem : arrayExpr->elements)
                     {
                         searchExprForReferences(elem);
                     }
                 }
-                else if (auto indexExpr = std::dynamic_pointer_cast<IndexExpr>(expr))
+                else if (auto indexExpr = dyn_cast<IndexExpr>(expr))
                 {
                     searchExprForReferences(indexExpr->array);
                     searchExprForReferences(indexExpr->index);
                 }
             };
 
-            std::function < void(std::shared_ptr<Stmt>) > searchStmtForReferences;
-            searchStmtForReferences = [&](std::shared_ptr<Stmt> stmt)
+            std::function < void(Stmt*) > searchStmtForReferences;
+            searchStmtForReferences = [&](Stmt* stmt)
             {
                 if (!stmt) return;
 
-                if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(stmt))
+                if (auto exprStmt = dyn_cast<ExprStmt>(stmt))
                 {
                     searchExprForReferences(exprStmt->expression);
                 }
-                else if (auto varDecl = std::dynamic_pointer_cast<VarDeclStmt>(stmt))
+                else if (auto varDecl = dyn_cast<VarDeclStmt>(stmt))
                 {
                     if (varDecl->name == identifier)
                     {
@@ -1158,7 +1178,7 @@ namespace flow
                     }
                     searchExprForReferences(varDecl->initializer);
                 }
-                else if (auto assignStmt = std::dynamic_pointer_cast<AssignmentStmt>(stmt))
+                else if (auto assignStmt = dyn_cast<AssignmentStmt>(stmt))
                 {
                     if (assignStmt->target == identifier)
                     {
@@ -1171,22 +1191,22 @@ namespace flow
                     }
                     searchExprForReferences(assignStmt->value);
                 }
-                else if (auto returnStmt = std::dynamic_pointer_cast<ReturnStmt>(stmt))
+                else if (auto returnStmt = dyn_cast<ReturnStmt>(stmt))
                 {
                     searchExprForReferences(returnStmt->value);
                 }
-                else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(stmt))
+                else if (auto ifStmt = dyn_cast<IfStmt>(stmt))
                 {
                     searchExprForReferences(ifStmt->condition);
                     for (auto& s : ifStmt->thenBranch) searchStmtForReferences(s);
                     for (auto& s : ifStmt->elseBranch) searchStmtForReferences(s);
                 }
-                else if (auto whileStmt = std::dynamic_pointer_cast<WhileStmt>(stmt))
+                else if (auto whileStmt = dyn_cast<WhileStmt>(stmt))
                 {
                     searchExprForReferences(whileStmt->condition);
                     for (auto& s : whileStmt->body) searchStmtForReferences(s);
                 }
-                else if (auto forStmt = std::dynamic_pointer_cast<ForStmt>(stmt))
+                else if (auto forStmt = dyn_cast<ForStmt>(stmt))
                 {
                     if (forStmt->iteratorVar == identifier)
                     {
@@ -1202,7 +1222,7 @@ namespace flow
                     searchExprForReferences(forStmt->iterable);
                     for (auto& s : forStmt->body) searchStmtForReferences(s);
                 }
-                else if (auto blockStmt = std::dynamic_pointer_cast<BlockStmt>(stmt))
+                else if (auto blockStmt = dyn_cast<BlockStmt>(stmt))
                 {
                     for (auto& s : blockStmt->statements) searchStmtForReferences(s);
                 }
@@ -1210,7 +1230,7 @@ namespace flow
 
             for (auto& decl : doc.ast->declarations)
             {
-                if (auto funcDecl = std::dynamic_pointer_cast<FunctionDecl>(decl))
+                if (auto funcDecl = dyn_cast<FunctionDecl>(decl))
                 {
                     if (funcDecl->name == identifier)
                     {
@@ -1240,7 +1260,7 @@ namespace flow
                         searchStmtForReferences(stmt);
                     }
                 }
-                else if (auto structDecl = std::dynamic_pointer_cast<StructDecl>(decl))
+                else if (auto structDecl = dyn_cast<StructDecl>(decl))
                 {
                     if (structDecl->name == identifier)
                     {
@@ -1252,7 +1272,7 @@ namespace flow
                         locations.push_back(loc);
                     }
                 }
-                else if (auto typedefDecl = std::dynamic_pointer_cast<TypeDefDecl>(decl))
+                else if (auto typedefDecl = dyn_cast<TypeDefDecl>(decl))
                 {
                     if (typedefDecl->name == identifier)
                     {
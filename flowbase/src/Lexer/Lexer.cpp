@@ -1,11 +1,202 @@
 #include "../../include/Lexer/Lexer.h"
-#include <cctype>
-#include <map>
+#include "../../include/Common/ErrorReporter.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define FLOW_LEXER_SIMD 1
+#endif
+
 namespace flow {
-    Lexer::Lexer(const std::string &src, const std::string &fname)
-        : source(src), filename(fname), current(0), line(1), column(1) {
+    namespace {
+        inline bool isDigitByte(char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        inline bool isAlphaByte(char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        }
+
+#ifdef FLOW_LEXER_SIMD
+        // Runs of whitespace, identifier characters and string contents are
+        // classified a block at a time: 32 bytes with AVX2 (when the compiler
+        // targets it, e.g. -march=native), 16 with SSE2. Signed compares are
+        // fine since bytes >= 0x80 are negative and match no class.
+#ifdef __AVX2__
+        constexpr size_t blockSize = 32;
+        using Block = __m256i;
+
+        inline Block load(const char *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+        inline Block splat(char c) { return _mm256_set1_epi8(c); }
+        inline Block equal(Block a, Block b) { return _mm256_cmpeq_epi8(a, b); }
+        inline Block greater(Block a, Block b) { return _mm256_cmpgt_epi8(a, b); }
+        inline Block both(Block a, Block b) { return _mm256_and_si256(a, b); }
+        inline Block either(Block a, Block b) { return _mm256_or_si256(a, b); }
+        inline uint32_t bits(Block a) { return static_cast<uint32_t>(_mm256_movemask_epi8(a)); }
+#else
+        constexpr size_t blockSize = 16;
+        using Block = __m128i;
+
+        inline Block load(const char *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+        inline Block splat(char c) { return _mm_set1_epi8(c); }
+        inline Block equal(Block a, Block b) { return _mm_cmpeq_epi8(a, b); }
+        inline Block greater(Block a, Block b) { return _mm_cmpgt_epi8(a, b); }
+        inline Block both(Block a, Block b) { return _mm_and_si128(a, b); }
+        inline Block either(Block a, Block b) { return _mm_or_si128(a, b); }
+        inline uint32_t bits(Block a) { return static_cast<uint32_t>(_mm_movemask_epi8(a)); }
+#endif
+        constexpr uint32_t fullBlock = blockSize == 32 ? 0xFFFFFFFFu : 0xFFFFu;
+
+        inline unsigned firstZeroBit(uint32_t mask) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, ~mask);
+            return static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_ctz(~mask));
+#endif
+        }
+#endif
+
+        // A run class says which bytes continue a run, one at a time and (with
+        // SIMD) as a bitmask over a block
+        struct SpaceRun {
+            static bool byte(char c) {
+                return c == ' ' || c == '\r' || c == '\t' || c == '\n';
+            }
+#ifdef FLOW_LEXER_SIMD
+            static uint32_t block(Block b) {
+                return bits(either(either(equal(b, splat(' ')), equal(b, splat('\n'))),
+                                   either(equal(b, splat('\t')), equal(b, splat('\r')))));
+            }
+#endif
+        };
+
+        struct IdentifierRun {
+            static bool byte(char c) {
+                return isAlphaByte(c) || isDigitByte(c);
+            }
+#ifdef FLOW_LEXER_SIMD
+            static uint32_t block(Block b) {
+                Block lower = either(b, splat(0x20));
+                Block alpha = both(greater(lower, splat('a' - 1)), greater(splat('z' + 1), lower));
+                Block digit = both(greater(b, splat('0' - 1)), greater(splat('9' + 1), b));
+                return bits(either(either(alpha, digit), equal(b, splat('_'))));
+            }
+#endif
+        };
+
+        // String contents up to the closing quote or the next escape
+        struct StringBodyRun {
+            static bool byte(char c) {
+                return c != '"' && c != '\\';
+            }
+#ifdef FLOW_LEXER_SIMD
+            static uint32_t block(Block b) {
+                return ~bits(either(equal(b, splat('"')), equal(b, splat('\\')))) & fullBlock;
+            }
+#endif
+        };
+
+        // Offset of the first byte at or after pos that doesn't continue the run
+        template<typename Run>
+        size_t skipRun(std::string_view text, size_t pos) {
+#ifdef FLOW_LEXER_SIMD
+            while (pos + blockSize <= text.size()) {
+                uint32_t mask = Run::block(load(text.data() + pos));
+                if (mask != fullBlock) {
+                    return pos + firstZeroBit(mask);
+                }
+                pos += blockSize;
+            }
+#endif
+            while (pos < text.size() && Run::byte(text[pos])) {
+                pos++;
+            }
+            return pos;
+        }
+
+        struct Keyword {
+            std::string_view text;
+            TokenType type;
+        };
+
+        constexpr Keyword keywords[] = {
+            {"let", TokenType::KW_LET},
+            {"mut", TokenType::KW_MUT},
+            {"func", TokenType::KW_FUNC},
+            {"return", TokenType::KW_RETURN},
+            {"struct", TokenType::KW_STRUCT},
+            {"type", TokenType::KW_TYPE},
+            {"if", TokenType::KW_IF},
+            {"else", TokenType::KW_ELSE},
+            {"for", TokenType::KW_FOR},
+            {"in", TokenType::KW_IN},
+            {"while", TokenType::KW_WHILE},
+            {"link", TokenType::KW_LINK},
+            {"export", TokenType::KW_EXPORT},
+            {"async", TokenType::KW_ASYNC},
+            {"await", TokenType::KW_AWAIT},
+            {"some", TokenType::KW_SOME},
+            {"none", TokenType::KW_NONE},
+            {"has", TokenType::KW_HAS},
+            {"value", TokenType::KW_VALUE},
+            {"inline", TokenType::KW_INLINE},
+            {"import", TokenType::KW_IMPORT},
+            {"module", TokenType::KW_MODULE},
+            {"from", TokenType::KW_FROM},
+            {"as", TokenType::KW_AS},
+            {"lambda", TokenType::KW_LAMBDA},
+            {"impl", TokenType::KW_IMPL},
+            {"this", TokenType::KW_THIS},
+            {"int", TokenType::TYPE_INT},
+            {"float", TokenType::TYPE_FLOAT},
+            {"string", TokenType::TYPE_STRING},
+            {"bool", TokenType::TYPE_BOOL},
+            {"void", TokenType::TYPE_VOID},
+            {"true", TokenType::BOOL_LITERAL},
+            {"false", TokenType::BOOL_LITERAL},
+        };
+
+        // Perfect hash over the keywords: the first two bytes, the last byte and
+        // the length put every keyword in its own slot. If a new keyword
+        // collides, the static_assert below fails; search for new multipliers.
+        constexpr size_t keywordSlots = 64;
+        constexpr size_t minKeywordLength = 2;
+        constexpr size_t maxKeywordLength = 6;
+
+        constexpr size_t keywordHash(std::string_view text) {
+            return (static_cast<unsigned char>(text[0]) * 5 + static_cast<unsigned char>(text[1]) * 5 +
+                    static_cast<unsigned char>(text[text.size() - 1]) * 22 + text.size()) & (keywordSlots - 1);
+        }
+
+        struct KeywordTable {
+            Keyword slots[keywordSlots] = {};
+            bool valid = true;
+
+            constexpr KeywordTable() {
+                for (const Keyword &keyword : keywords) {
+                    if (keyword.text.size() < minKeywordLength || keyword.text.size() > maxKeywordLength) {
+                        valid = false;
+                    }
+                    Keyword &slot = slots[keywordHash(keyword.text)];
+                    if (!slot.text.empty()) {
+                        valid = false;
+                    }
+                    slot = keyword;
+                }
+            }
+        };
+
+        constexpr KeywordTable keywordTable;
+        static_assert(keywordTable.valid, "keyword hash has a collision or a keyword is outside the length bounds");
+    }
+
+    Lexer::Lexer(const SourceFile &file)
+        : file(file), source(file.getText()), start(0), current(0) {
     }
 
     char Lexer::peek() const {
@@ -19,14 +210,7 @@ namespace flow {
     }
 
     char Lexer::advance() {
-        char c = source[current++];
-        if (c == '\n') {
-            line++;
-            column = 1;
-        } else {
-            column++;
-        }
-        return c;
+        return source[current++];
     }
 
     bool Lexer::isAtEnd() const {
@@ -43,8 +227,8 @@ namespace flow {
     void Lexer::skipWhitespace() {
         while (!isAtEnd()) {
             char c = peek();
-            if (c == ' ' || c == '\r' || c == '\t' || c == '\n') {
-                advance();
+            if (SpaceRun::byte(c)) {
+                current = skipRun<SpaceRun>(source, current);
             } else if (c == '/' && peekNext() == '/') {
                 skipLineComment();
             } else if (c == '/' && peekNext() == '*') {
@@ -56,129 +240,67 @@ namespace flow {
     }
 
     void Lexer::skipLineComment() {
-        while (peek() != '\n' && !isAtEnd()) {
-            advance();
-        }
+        // memchr already scans a vector at a time
+        const void *newline = std::memchr(source.data() + current, '\n', source.size() - current);
+        current = newline ? static_cast<const char *>(newline) - source.data() : source.size();
     }
 
     void Lexer::skipBlockComment() {
-        advance(); // /
-        advance(); // *
+        current += 2; // /*
 
         while (!isAtEnd()) {
-            if (peek() == '*' && peekNext() == '/') {
-                advance(); // *
-                advance(); // /
+            const void *star = std::memchr(source.data() + current, '*', source.size() - current);
+            if (!star) {
+                current = source.size();
+                break;
+            }
+            current = static_cast<const char *>(star) - source.data() + 1;
+            if (match('/')) {
                 break;
             }
-            advance();
         }
     }
 
-    Token Lexer::makeToken(TokenType type, const std::string &lexeme) {
-        return Token(type, lexeme, SourceLocation(filename, line, column - lexeme.length()));
-    }
-
     Token Lexer::makeToken(TokenType type) {
-        return Token(type, "", SourceLocation(filename, line, column));
+        return Token(type, file.getID(), static_cast<uint32_t>(start), static_cast<uint32_t>(current - start));
     }
 
     Token Lexer::errorToken(const std::string &message) {
-        return Token(TokenType::INVALID, message, SourceLocation(filename, line, column));
+        error = message;
+        return makeToken(TokenType::INVALID);
     }
 
-    TokenType Lexer::identifierType(const std::string &text) {
-        static std::map<std::string, TokenType> keywords = {
-            {"let", TokenType::KW_LET},
-            {"mut", TokenType::KW_MUT},
-            {"func", TokenType::KW_FUNC},
-            {"return", TokenType::KW_RETURN},
-            {"struct", TokenType::KW_STRUCT},
-            {"type", TokenType::KW_TYPE},
-            {"if", TokenType::KW_IF},
-            {"else", TokenType::KW_ELSE},
-            {"for", TokenType::KW_FOR},
-            {"in", TokenType::KW_IN},
-            {"while", TokenType::KW_WHILE},
-            {"link", TokenType::KW_LINK},
-            {"export", TokenType::KW_EXPORT},
-            {"async", TokenType::KW_ASYNC},
-            {"await", TokenType::KW_AWAIT},
-            {"some", TokenType::KW_SOME},
-            {"none", TokenType::KW_NONE},
-            {"has", TokenType::KW_HAS},
-            {"value", TokenType::KW_VALUE},
-            {"inline", TokenType::KW_INLINE},
-            {"import", TokenType::KW_IMPORT},
-            {"module", TokenType::KW_MODULE},
-                {"from", TokenType::KW_FROM},
-                {"as", TokenType::KW_AS},
-                {"lambda", TokenType::KW_LAMBDA},
-                {"impl", TokenType::KW_IMPL},
-                {"this", TokenType::KW_THIS},
-                {"int", TokenType::TYPE_INT},
-            {"float", TokenType::TYPE_FLOAT},
-            {"string", TokenType::TYPE_STRING},
-            {"bool", TokenType::TYPE_BOOL},
-            {"void", TokenType::TYPE_VOID},
-            {"true", TokenType::BOOL_LITERAL},
-            {"false", TokenType::BOOL_LITERAL},
-        };
-
-        auto it = keywords.find(text);
-        if (it != keywords.end()) {
-            return it->second;
+    TokenType Lexer::identifierType(std::string_view text) {
+        if (text.size() < minKeywordLength || text.size() > maxKeywordLength) {
+            return TokenType::IDENTIFIER;
         }
-        return TokenType::IDENTIFIER;
+        const Keyword &slot = keywordTable.slots[keywordHash(text)];
+        return slot.text == text ? slot.type : TokenType::IDENTIFIER;
     }
 
     Token Lexer::scanNumber() {
-        size_t start = current - 1;
-
-        while (std::isdigit(peek())) {
+        while (isDigitByte(peek())) {
             advance();
         }
 
         // Check for decimal point
-        if (peek() == '.' && std::isdigit(peekNext())) {
+        if (peek() == '.' && isDigitByte(peekNext())) {
             advance(); // consume '.'
-            while (std::isdigit(peek())) {
+            while (isDigitByte(peek())) {
                 advance();
             }
-            std::string lexeme = source.substr(start, current - start);
-            return makeToken(TokenType::FLOAT_LITERAL, lexeme);
+            return makeToken(TokenType::FLOAT_LITERAL);
         }
 
-        std::string lexeme = source.substr(start, current - start);
-        return makeToken(TokenType::INT_LITERAL, lexeme);
+        return makeToken(TokenType::INT_LITERAL);
     }
 
     Token Lexer::scanString() {
-        size_t start = current;
-        std::string value;
-
-        while (peek() != '"' && !isAtEnd()) {
-            if (peek() == '\\') {
-                advance();
-                if (!isAtEnd()) {
-                    char escaped = advance();
-                    switch (escaped) {
-                        case 'n': value += '\n'; break;
-                        case 't': value += '\t'; break;
-                        case 'r': value += '\r'; break;
-                        case '\\': value += '\\'; break;
-                        case '"': value += '"'; break;
-                        case '0': value += '\0'; break;
-                        default: 
-                            value += '\\';
-                            value += escaped;
-                            break;
-                    }
-                }
-            } else {
-                if (peek() == '\n') line++;
-                value += advance();
-            }
+        // Escapes are resolved by unescapeString when the literal is used
+        while (true) {
+            current = skipRun<StringBodyRun>(source, current);
+            if (isAtEnd() || peek() == '"') break;
+            current = std::min(current + 2, source.size()); // backslash and the escaped byte
         }
 
         if (isAtEnd()) {
@@ -187,24 +309,46 @@ namespace flow {
 
         advance();
 
-        return makeToken(TokenType::STRING_LITERAL, value);
+        return makeToken(TokenType::STRING_LITERAL);
     }
 
-    Token Lexer::scanIdentifier() {
-        size_t start = current - 1;
+    std::string Lexer::unescapeString(std::string_view quoted) {
+        std::string value;
+        value.reserve(quoted.size());
 
-        while (std::isalnum(peek()) || peek() == '_') {
-            advance();
+        size_t end = quoted.size() >= 2 ? quoted.size() - 1 : quoted.size();
+        for (size_t i = 1; i < end; i++) {
+            if (quoted[i] != '\\' || i + 1 >= end) {
+                value += quoted[i];
+                continue;
+            }
+
+            char escaped = quoted[++i];
+            switch (escaped) {
+                case 'n': value += '\n'; break;
+                case 't': value += '\t'; break;
+                case 'r': value += '\r'; break;
+                case '\\': value += '\\'; break;
+                case '"': value += '"'; break;
+                case '0': value += '\0'; break;
+                default:
+                    value += '\\';
+                    value += escaped;
+                    break;
+            }
         }
+        return value;
+    }
 
-        std::string text = source.substr(start, current - start);
-        TokenType type = identifierType(text);
+    Token Lexer::scanIdentifier() {
+        current = skipRun<IdentifierRun>(source, current);
 
-        return makeToken(type, text);
+        return makeToken(identifierType(source.substr(start, current - start)));
     }
 
     Token Lexer::nextToken() {
         skipWhitespace();
+        start = current;
 
         if (isAtEnd()) {
             return makeToken(TokenType::END_OF_FILE);
@@ -213,12 +357,12 @@ namespace flow {
         char c = advance();
 
 
-        if (std::isdigit(c)) {
+        if (isDigitByte(c)) {
             return scanNumber();
         }
 
 
-        if (std::isalpha(c) || c == '_') {
+        if (isAlphaByte(c)) {
             return scanIdentifier();
         }
 
@@ -229,57 +373,58 @@ namespace flow {
 
 
         switch (c) {
-            case '(': return makeToken(TokenType::LPAREN, "(");
-            case ')': return makeToken(TokenType::RPAREN, ")");
-            case '{': return makeToken(TokenType::LBRACE, "{");
-            case '}': return makeToken(TokenType::RBRACE, "}");
-            case '[': return makeToken(TokenType::LBRACKET, "[");
-            case ']': return makeToken(TokenType::RBRACKET, "]");
-            case ';': return makeToken(TokenType::SEMICOLON, ";");
+            case '(': return makeToken(TokenType::LPAREN);
+            case ')': return makeToken(TokenType::RPAREN);
+            case '{': return makeToken(TokenType::LBRACE);
+            case '}': return makeToken(TokenType::RBRACE);
+            case '[': return makeToken(TokenType::LBRACKET);
+            case ']': return makeToken(TokenType::RBRACKET);
+            case ';': return makeToken(TokenType::SEMICOLON);
             case ':':
-                if (match(':')) return makeToken(TokenType::DOUBLE_COLON, "::");
-                return makeToken(TokenType::COLON, ":");
-            case ',': return makeToken(TokenType::COMMA, ",");
-            case '?': return makeToken(TokenType::QUESTION, "?");
-            case '%': return makeToken(TokenType::PERCENT, "%");
-            case '#': return makeToken(TokenType::HASH, "#");
+                if (match(':')) return makeToken(TokenType::DOUBLE_COLON);
+                return makeToken(TokenType::COLON);
+            case ',': return makeToken(TokenType::COMMA);
+            case '?': return makeToken(TokenType::QUESTION);
+            case '%': return makeToken(TokenType::PERCENT);
+            case '#': return makeToken(TokenType::HASH);
             case '&':
-                if (match('&')) return makeToken(TokenType::AND, "&&");
-                return makeToken(TokenType::AMPERSAND, "&");
+                if (match('&')) return makeToken(TokenType::AND);
+                return makeToken(TokenType::AMPERSAND);
             case '|':
-                if (match('|')) return makeToken(TokenType::OR, "||");
-                return makeToken(TokenType::PIPE, "|");
-            case '^': return makeToken(TokenType::CARET, "^");
-            case '~': return makeToken(TokenType::TILDE, "~");
-            case '+': return makeToken(TokenType::PLUS, "+");
-            case '*': return makeToken(TokenType::STAR, "*");
-            case '/': return makeToken(TokenType::SLASH, "/");
+                if (match('|')) return makeToken(TokenType::OR);
+                return makeToken(TokenType::PIPE);
+            case '^': return makeToken(TokenType::CARET);
+            case '~': return makeToken(TokenType::TILDE);
+            case '+': return makeToken(TokenType::PLUS);
+            case '*': return makeToken(TokenType::STAR);
+            case '/': return makeToken(TokenType::SLASH);
             case '!':
-                if (match('=')) return makeToken(TokenType::NE, "!=");
-                return makeToken(TokenType::NOT, "!");
+                if (match('=')) return makeToken(TokenType::NE);
+                return makeToken(TokenType::NOT);
             case '=':
-                if (match('=')) return makeToken(TokenType::EQ, "==");
-                return makeToken(TokenType::ASSIGN, "=");
+                if (match('=')) return makeToken(TokenType::EQ);
+                return makeToken(TokenType::ASSIGN);
             case '<':
-                if (match('<')) return makeToken(TokenType::LEFT_SHIFT, "<<");
-                if (match('=')) return makeToken(TokenType::LE, "<=");
-                return makeToken(TokenType::LT, "<");
+                if (match('<')) return makeToken(TokenType::LEFT_SHIFT);
+                if (match('=')) return makeToken(TokenType::LE);
+                return makeToken(TokenType::LT);
             case '>':
-                if (match('>')) return makeToken(TokenType::RIGHT_SHIFT, ">>");
-                if (match('=')) return makeToken(TokenType::GE, ">=");
-                return makeToken(TokenType::GT, ">");
+                if (match('>')) return makeToken(TokenType::RIGHT_SHIFT);
+                if (match('=')) return makeToken(TokenType::GE);
+                return makeToken(TokenType::GT);
             case '.':
                 if (match('.')) {
-                    if (match('.')) return makeToken(TokenType::TRIPLE_DOT, "...");
-                    return makeToken(TokenType::DOUBLE_DOT, "..");
+                    if (match('.')) return makeToken(TokenType::TRIPLE_DOT);
+                    return makeToken(TokenType::DOUBLE_DOT);
                 }
-                return makeToken(TokenType::DOT, ".");
+                return makeToken(TokenType::DOT);
             case '-':
-                if (match('>')) return makeToken(TokenType::ARROW, "->");
-                return makeToken(TokenType::MINUS, "-");
+                if (match('>')) return makeToken(TokenType::ARROW);
+                return makeToken(TokenType::MINUS);
         }
 
-        std::cerr << "Unexpected character: '" << c << "' (ASCII " << static_cast<int>(c) << ") at line " << line << ", column " << column << std::endl;
+        auto [line, column] = file.getLineAndColumn(start);
+        ErrorReporter::errors() << "Unexpected character: '" << c << "' (ASCII " << static_cast<int>(c) << ") at line " << line << ", column " << column << std::endl;
         return errorToken("Unexpected character");
     }
 
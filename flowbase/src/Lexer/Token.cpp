@@ -3,11 +3,24 @@
 
 namespace flow
 {
+    const std::string& SourceLocation::getFilename() const
+    {
+        return SourceManager::instance().getPath(file);
+    }
+
     std::string Token::toString() const
     {
         std::stringstream ss;
-        ss << tokenTypeToString(type) << " '" << lexeme << "' at "
-            << location.filename << ":" << location.line << ":" << location.column;
+        ss << tokenTypeToString(type);
+        auto source = SourceManager::instance().getFile(file);
+        if (!source)
+        {
+            return ss.str();
+        }
+
+        auto [line, column] = source->getLineAndColumn(offset);
+        ss << " '" << getText(source->getText()) << "' at "
+            << source->getPath() << ":" << line << ":" << column;
         return ss.str();
     }
 
@@ -5,17 +5,39 @@
 
 namespace flow
 {
-    Token Parser::peek() const
+    void Parser::pullToken()
     {
-        return tokens[current];
+        Token token = lexer.nextToken();
+        window[pulled % tokenWindow] = token;
+        pulled++;
+
+        if (token.type == TokenType::INVALID)
+        {
+            std::string message = lexer.getError().empty() ? "Invalid token" : lexer.getError();
+            if (errorCollector)
+            {
+                errorCollector->reportError("Lex", message, location(token));
+            }
+            else
+            {
+                ErrorReporter::instance().reportError("Lex", message, location(token));
+            }
+            throw LexError(message, location(token));
+        }
+    }
+
+    Token Parser::peek()
+    {
+        if (current == pulled) pullToken();
+        return window[current % tokenWindow];
     }
 
     Token Parser::previous() const
     {
-        return tokens[current - 1];
+        return window[(current - 1) % tokenWindow];
     }
 
-    bool Parser::isAtEnd() const
+    bool Parser::isAtEnd()
     {
         return peek().type == TokenType::END_OF_FILE;
     }
@@ -26,7 +48,7 @@ namespace flow
         return previous();
     }
 
-    bool Parser::check(TokenType type) const
+    bool Parser::check(TokenType type)
     {
         if (isAtEnd()) return false;
         return peek().type == type;
@@ -47,9 +69,9 @@ namespace flow
         if (check(type)) return advance();
         if (errorCollector)
         {
-            // When using error collector, don't throw - just report and return a dummy token
-            errorCollector->reportError("Parse", message, peek().location);
-            return Token(TokenType::INVALID, "", peek().location);
+            // When using error collector, don't throw - just report and return an empty INVALID token
+            errorCollector->reportError("Parse", message, location(peek()));
+            return Token(TokenType::INVALID, peek().file, peek().offset, 0);
         }
         else
         {
@@ -57,18 +79,34 @@ namespace flow
         }
     }
 
+    std::string Parser::lexeme(const Token& token) const
+    {
+        std::string_view text = token.getText(source);
+        if (token.type == TokenType::STRING_LITERAL)
+        {
+            return Lexer::unescapeString(text);
+        }
+        return std::string(text);
+    }
+
+    SourceLocation Parser::location(const Token& token) const
+    {
+        auto [line, column] = file.getLineAndColumn(token.offset);
+        return SourceLocation(token.file, line, column);
+    }
+
     ParseError Parser::error(const Token& token, const std::string& message)
     {
         if (errorCollector)
         {
-            errorCollector->reportError("Parse", message, token.location);
+            errorCollector->reportError("Parse", message, location(token));
             // Don't throw exception when using error collector
-            return ParseError(message, token.location);
+            return ParseError(message, location(token));
         }
         else
         {
-            ErrorReporter::instance().reportError("Parse", message, token.location);
-            return ParseError(message, token.location);
+            ErrorReporter::instance().reportError("Parse", message, location(token));
+            return ParseError(message, location(token));
         }
     }
 
@@ -102,7 +140,8 @@ namespace flow
 
     std::shared_ptr<Program> Parser::parse()
     {
-        auto program = std::make_shared<Program>(SourceLocation("", 0, 0));
+        auto program = std::make_shared<Program>(SourceLocation(file.getID(), 0, 0));
+        arena = &program->arena;
 
 
         try
@@ -118,14 +157,19 @@ namespace flow
         }
         catch (const ParseError& e)
         {
-            std::cerr << "Parsing failed: " << e.what() << std::endl;
+            ErrorReporter::errors() << "Parsing failed: " << e.what() << std::endl;
+            return nullptr;
+        }
+        catch (const LexError&)
+        {
+            // Already reported where the lexer stopped
             return nullptr;
         }
 
         return program;
     }
 
-    std::shared_ptr<Decl> Parser::parseDeclaration()
+    Decl* Parser::parseDeclaration()
     {
         try
         {
@@ -177,10 +221,10 @@ namespace flow
         return nullptr;
     }
 
-    std::shared_ptr<FunctionDecl> Parser::parseFunctionDecl()
+    FunctionDecl* Parser::parseFunctionDecl()
     {
         Token name = consume(TokenType::IDENTIFIER, "Expected function name");
-        auto func = std::make_shared<FunctionDecl>(name.lexeme, name.location);
+        auto func = arena->create<FunctionDecl>(lexeme(name), location(name));
 
         // Parse parameters
         consume(TokenType::LPAREN, "Expected '(' after function name");
@@ -203,7 +247,7 @@ namespace flow
         }
         else
         {
-            func->returnType = std::make_shared<Type>(TypeKind::VOID, "void");
+            func->returnType = types.getVoid();
         }
 
         // Parse function body
@@ -219,7 +263,7 @@ namespace flow
         return func;
     }
 
-    std::shared_ptr<StructDecl> Parser::parseStructDecl()
+    StructDecl* Parser::parseStructDecl()
     {
         Token name = consume(TokenType::IDENTIFIER, "Expected struct name");
 
@@ -231,7 +275,7 @@ namespace flow
         while (!check(TokenType::RBRACE) && !isAtEnd())
         {
             // Parse type
-            std::shared_ptr<Type> fieldType = parseType();
+            const Type *fieldType = parseType();
 
             // Parse field name
             Token fieldName = consume(TokenType::IDENTIFIER, "Expected field name");
@@ -239,22 +283,22 @@ namespace flow
             // Expect semicolon after field
             consume(TokenType::SEMICOLON, "Expected ';' after struct field");
 
-            fields.push_back(StructField(fieldType, fieldName.lexeme));
+            fields.push_back(StructField(fieldType, lexeme(fieldName)));
         }
 
         consume(TokenType::RBRACE, "Expected '}' after struct fields");
 
-        return std::make_shared<StructDecl>(name.lexeme, fields, name.location);
+        return arena->create<StructDecl>(lexeme(name), std::move(fields), location(name));
     }
 
-    std::shared_ptr<ImplDecl> Parser::parseImplDecl()
+    ImplDecl* Parser::parseImplDecl()
     {
         // impl StructName::methodName(params) -> returnType { body }
         Token structName = consume(TokenType::IDENTIFIER, "Expected struct name after 'impl'");
         consume(TokenType::DOUBLE_COLON, "Expected '::' after struct name");
         Token methodName = consume(TokenType::IDENTIFIER, "Expected method name after '::'");
 
-        auto implDecl = std::make_shared<ImplDecl>(structName.lexeme, methodName.lexeme, structName.location);
+        auto implDecl = arena->create<ImplDecl>(lexeme(structName), lexeme(methodName), location(structName));
 
         // Parse parameters
         consume(TokenType::LPAREN, "Expected '(' after method name");
@@ -269,7 +313,7 @@ namespace flow
         if (match(TokenType::ARROW)) {
             implDecl->returnType = parseType();
         } else {
-            implDecl->returnType = std::make_shared<Type>(TypeKind::VOID, "void");
+            implDecl->returnType = types.getVoid();
         }
 
         // Parse body
@@ -282,7 +326,7 @@ namespace flow
         return implDecl;
     }
 
-    std::shared_ptr<TypeDefDecl> Parser::parseTypeDefDecl()
+    TypeDefDecl* Parser::parseTypeDefDecl()
     {
         // type UserId = int;
         Token name = consume(TokenType::IDENTIFIER, "Expected type alias name");
@@ -290,16 +334,16 @@ namespace flow
         auto aliasedType = parseType();
         consume(TokenType::SEMICOLON, "Expected ';' after type definition");
 
-        return std::make_shared<TypeDefDecl>(name.lexeme, aliasedType, name.location);
+        return arena->create<TypeDefDecl>(lexeme(name), aliasedType, location(name));
     }
 
-    std::shared_ptr<LinkDecl> Parser::parseLinkDecl()
+    LinkDecl* Parser::parseLinkDecl()
     {
         Token linkToken = previous(); // 'link' keyword
 
         // Parse the adapter string: "c", "python:math", "js:dom"
         Token adapterToken = consume(TokenType::STRING_LITERAL, "Expected adapter string after 'link'");
-        std::string adapterString = adapterToken.lexeme;
+        std::string adapterString = lexeme(adapterToken);
 
         // Remove quotes from adapter string
         if (adapterString.size() >= 2 && adapterString.front() == '"' && adapterString.back() == '"')
@@ -321,7 +365,7 @@ namespace flow
             module = "";
         }
 
-        auto linkDecl = std::make_shared<LinkDecl>(adapter, module, linkToken.location);
+        auto linkDecl = arena->create<LinkDecl>(adapter, module, location(linkToken));
 
         // Parse the function declarations inside the link block
         consume(TokenType::LBRACE, "Expected '{' after link adapter");
@@ -332,7 +376,7 @@ namespace flow
             if (match(TokenType::KW_INLINE))
             {
                 Token codeToken = consume(TokenType::STRING_LITERAL, "Expected inline code string");
-                linkDecl->inlineCode = codeToken.lexeme;
+                linkDecl->inlineCode = lexeme(codeToken);
                 consume(TokenType::SEMICOLON, "Expected ';' after inline code");
                 continue;
             }
@@ -354,7 +398,7 @@ namespace flow
                         {
                             // Variadic parameter
                             params.push_back(Parameter{
-                                "__varargs", std::make_shared<Type>(TypeKind::UNKNOWN, "varargs")
+                                "__varargs", types.getUnknown("varargs")
                             });
                             break;
                         }
@@ -369,7 +413,7 @@ namespace flow
                 consume(TokenType::RPAREN, "Expected ')' after parameters");
 
                 // Parse return type
-                std::shared_ptr<Type> returnType = std::make_shared<Type>(TypeKind::VOID, "void");
+                const Type *returnType = types.getVoid();
                 if (match(TokenType::ARROW))
                 {
                     returnType = parseType();
@@ -378,7 +422,7 @@ namespace flow
                 consume(TokenType::SEMICOLON, "Expected ';' after foreign function declaration");
 
                 // Create function declaration (mark as foreign)
-                auto funcDecl = std::make_shared<FunctionDecl>(funcName.lexeme, funcName.location);
+                auto funcDecl = arena->create<FunctionDecl>(lexeme(funcName), location(funcName));
                 funcDecl->parameters = params;
                 funcDecl->returnType = returnType;
                 // body is empty for foreign functions
@@ -395,7 +439,7 @@ namespace flow
         return linkDecl;
     }
 
-    std::shared_ptr<ImportDecl> Parser::parseImportDecl()
+    ImportDecl* Parser::parseImportDecl()
     {
         // Support multiple import syntaxes:
         // import "path/to/module.flow";
@@ -413,7 +457,7 @@ namespace flow
             do
             {
                 Token id = consume(TokenType::IDENTIFIER, "Expected identifier");
-                imports.push_back(id.lexeme);
+                imports.push_back(lexeme(id));
             }
             while (match(TokenType::COMMA));
 
@@ -423,36 +467,36 @@ namespace flow
             Token pathToken = consume(TokenType::STRING_LITERAL, "Expected module path string");
             consume(TokenType::SEMICOLON, "Expected ';' after import");
 
-            auto importDecl = std::make_shared<ImportDecl>(pathToken.lexeme, startToken.location);
+            auto importDecl = arena->create<ImportDecl>(lexeme(pathToken), location(startToken));
             importDecl->imports = imports;
             return importDecl;
         }
 
         // Simple import: import "path";
         Token pathToken = consume(TokenType::STRING_LITERAL, "Expected module path string");
-        auto importDecl = std::make_shared<ImportDecl>(pathToken.lexeme, pathToken.location);
+        auto importDecl = arena->create<ImportDecl>(lexeme(pathToken), location(pathToken));
 
         // Check for alias: import "path" as alias;
         if (match(TokenType::KW_AS))
         {
             Token aliasToken = consume(TokenType::IDENTIFIER, "Expected alias identifier");
-            importDecl->alias = aliasToken.lexeme;
+            importDecl->alias = lexeme(aliasToken);
         }
 
         consume(TokenType::SEMICOLON, "Expected ';' after import");
         return importDecl;
     }
 
-    std::shared_ptr<ModuleDecl> Parser::parseModuleDecl()
+    ModuleDecl* Parser::parseModuleDecl()
     {
         // module name;
         Token nameToken = consume(TokenType::IDENTIFIER, "Expected module name");
         consume(TokenType::SEMICOLON, "Expected ';' after module declaration");
 
-        return std::make_shared<ModuleDecl>(nameToken.lexeme, nameToken.location);
+        return arena->create<ModuleDecl>(lexeme(nameToken), location(nameToken));
     }
 
-    std::shared_ptr<Stmt> Parser::parseStatement()
+    Stmt* Parser::parseStatement()
     {
         if (match(TokenType::KW_RETURN))
         {
@@ -487,7 +531,7 @@ namespace flow
         return parseExprStmt();
     }
 
-    std::shared_ptr<VarDeclStmt> Parser::parseVarDecl()
+    VarDeclStmt* Parser::parseVarDecl()
     {
         // Check if 'mut' follows 'let'
         bool isMutable = match(TokenType::KW_MUT);
@@ -495,13 +539,13 @@ namespace flow
         Token name = consume(TokenType::IDENTIFIER, "Expected variable name");
 
         // Type annotation is optional for type inference
-        std::shared_ptr<Type> type = nullptr;
+        const Type *type = nullptr;
         if (match(TokenType::COLON))
         {
             type = parseType();
         }
 
-        std::shared_ptr<Expr> initializer = nullptr;
+        Expr* initializer = nullptr;
         if (match(TokenType::ASSIGN))
         {
             initializer = parseExpression();
@@ -514,24 +558,24 @@ namespace flow
         }
 
         consume(TokenType::SEMICOLON, "Expected ';' after variable declaration");
-        return std::make_shared<VarDeclStmt>(name.lexeme, isMutable, type, initializer, name.location);
+        return arena->create<VarDeclStmt>(lexeme(name), isMutable, type, initializer, location(name));
     }
 
-    std::shared_ptr<ReturnStmt> Parser::parseReturnStmt()
+    ReturnStmt* Parser::parseReturnStmt()
     {
         Token keyword = previous(); // 'return' keyword
 
-        std::shared_ptr<Expr> value = nullptr;
+        Expr* value = nullptr;
         if (!check(TokenType::SEMICOLON))
         {
             value = parseExpression();
         }
 
         consume(TokenType::SEMICOLON, "Expected ';' after return value");
-        return std::make_shared<ReturnStmt>(value, keyword.location);
+        return arena->create<ReturnStmt>(value, location(keyword));
     }
 
-    std::shared_ptr<IfStmt> Parser::parseIfStmt()
+    IfStmt* Parser::parseIfStmt()
     {
         Token keyword = previous();
 
@@ -540,11 +584,11 @@ namespace flow
         consume(TokenType::RPAREN, "Expected ')' after condition");
 
         // Parse then branch
-        std::vector<std::shared_ptr<Stmt>> thenBranch;
+        std::vector<Stmt*> thenBranch;
         if (check(TokenType::LBRACE))
         {
             auto block = parseBlockStmt();
-            thenBranch = dynamic_cast<BlockStmt*>(block.get())->statements;
+            thenBranch = std::move(block->statements);
         }
         else
         {
@@ -552,13 +596,13 @@ namespace flow
         }
 
         // Parse else branch
-        std::vector<std::shared_ptr<Stmt>> elseBranch;
+        std::vector<Stmt*> elseBranch;
         if (match(TokenType::KW_ELSE))
         {
             if (check(TokenType::LBRACE))
             {
                 auto block = parseBlockStmt();
-                elseBranch = dynamic_cast<BlockStmt*>(block.get())->statements;
+                elseBranch = std::move(block->statements);
             }
             else
             {
@@ -566,10 +610,10 @@ namespace flow
             }
         }
 
-        return std::make_shared<IfStmt>(condition, thenBranch, elseBranch, keyword.location);
+        return arena->create<IfStmt>(condition, std::move(thenBranch), std::move(elseBranch), location(keyword));
     }
 
-    std::shared_ptr<ForStmt> Parser::parseForStmt()
+    ForStmt* Parser::parseForStmt()
     {
         Token keyword = previous();
 
@@ -577,7 +621,7 @@ namespace flow
         Token iterVar = consume(TokenType::IDENTIFIER, "Expected iterator variable");
         consume(TokenType::KW_IN, "Expected 'in' after iterator variable");
 
-        auto forStmt = std::make_shared<ForStmt>(iterVar.lexeme, keyword.location);
+        auto forStmt = arena->create<ForStmt>(lexeme(iterVar), location(keyword));
 
         // Parse range or iterable
         auto start = parseExpression();
@@ -600,7 +644,7 @@ namespace flow
         if (check(TokenType::LBRACE))
         {
             auto block = parseBlockStmt();
-            forStmt->body = dynamic_cast<BlockStmt*>(block.get())->statements;
+            forStmt->body = std::move(block->statements);
         }
         else
         {
@@ -610,7 +654,7 @@ namespace flow
         return forStmt;
     }
 
-    std::shared_ptr<WhileStmt> Parser::parseWhileStmt()
+    WhileStmt* Parser::parseWhileStmt()
     {
         Token keyword = previous(); // 'while' keyword
 
@@ -619,24 +663,24 @@ namespace flow
         consume(TokenType::RPAREN, "Expected ')' after condition");
 
         // Parse body
-        std::vector<std::shared_ptr<Stmt>> body;
+        std::vector<Stmt*> body;
         if (check(TokenType::LBRACE))
         {
             auto block = parseBlockStmt();
-            body = dynamic_cast<BlockStmt*>(block.get())->statements;
+            body = std::move(block->statements);
         }
         else
         {
             body.push_back(parseStatement());
         }
 
-        return std::make_shared<WhileStmt>(condition, body, keyword.location);
+        return arena->create<WhileStmt>(condition, std::move(body), location(keyword));
     }
 
-    std::shared_ptr<BlockStmt> Parser::parseBlockStmt()
+    BlockStmt* Parser::parseBlockStmt()
     {
         Token lbrace = consume(TokenType::LBRACE, "Expected '{'");
-        std::vector<std::shared_ptr<Stmt>> statements;
+        std::vector<Stmt*> statements;
 
         while (!check(TokenType::RBRACE) && !isAtEnd())
         {
@@ -644,10 +688,10 @@ namespace flow
         }
 
         consume(TokenType::RBRACE, "Expected '}'");
-        return std::make_shared<BlockStmt>(statements, lbrace.location);
+        return arena->create<BlockStmt>(std::move(statements), location(lbrace));
     }
 
-    std::shared_ptr<Stmt> Parser::parseExprStmt()
+    Stmt* Parser::parseExprStmt()
     {
         // Check if this is an assignment statement
         if (check(TokenType::IDENTIFIER))
@@ -662,7 +706,7 @@ namespace flow
                 advance(); // consume '='
                 auto value = parseExpression();
                 consume(TokenType::SEMICOLON, "Expected ';' after assignment");
-                return std::make_shared<AssignmentStmt>(id.lexeme, value, id.location);
+                return arena->create<AssignmentStmt>(lexeme(id), value, location(id));
             }
 
             // Not an assignment, backtrack
@@ -672,15 +716,15 @@ namespace flow
         // Regular expression statement
         auto expr = parseExpression();
         consume(TokenType::SEMICOLON, "Expected ';' after expression");
-        return std::make_shared<ExprStmt>(expr, expr->location);
+        return arena->create<ExprStmt>(expr, expr->location);
     }
 
-    std::shared_ptr<Expr> Parser::parseExpression()
+    Expr* Parser::parseExpression()
     {
         return parseAssignment();
     }
 
-    std::shared_ptr<Expr> Parser::parseAssignment()
+    Expr* Parser::parseAssignment()
     {
         auto expr = parseLogicalOr();
 
@@ -689,11 +733,11 @@ namespace flow
             Token equals = previous();
             auto value = parseAssignment();
 
-            if (auto* idExpr = dynamic_cast<IdentifierExpr*>(expr.get()))
+            if (auto* idExpr = dyn_cast<IdentifierExpr>(expr))
             {
                 // Assignment to variable - we'll handle this as a statement later
                 // For now, return a binary expression
-                return std::make_shared<BinaryExpr>(expr, equals.type, value, equals.location);
+                return arena->create<BinaryExpr>(expr, equals.type, value, location(equals));
             }
 
             throw error(equals, "Invalid assignment target");
@@ -702,7 +746,7 @@ namespace flow
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseLogicalOr()
+    Expr* Parser::parseLogicalOr()
     {
         auto expr = parseLogicalAnd();
 
@@ -710,13 +754,13 @@ namespace flow
         {
             Token op = previous();
             auto right = parseLogicalAnd();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseLogicalAnd()
+    Expr* Parser::parseLogicalAnd()
     {
         auto expr = parseBitwiseOr();
 
@@ -724,13 +768,13 @@ namespace flow
         {
             Token op = previous();
             auto right = parseBitwiseOr();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseBitwiseOr()
+    Expr* Parser::parseBitwiseOr()
     {
         auto expr = parseBitwiseXor();
 
@@ -738,13 +782,13 @@ namespace flow
         {
             Token op = previous();
             auto right = parseBitwiseXor();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseBitwiseXor()
+    Expr* Parser::parseBitwiseXor()
     {
         auto expr = parseBitwiseAnd();
 
@@ -752,13 +796,13 @@ namespace flow
         {
             Token op = previous();
             auto right = parseBitwiseAnd();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseBitwiseAnd()
+    Expr* Parser::parseBitwiseAnd()
     {
         auto expr = parseEquality();
 
@@ -766,13 +810,13 @@ namespace flow
         {
             Token op = previous();
             auto right = parseEquality();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseEquality()
+    Expr* Parser::parseEquality()
     {
         auto expr = parseComparison();
 
@@ -780,13 +824,13 @@ namespace flow
         {
             Token op = previous();
             auto right = parseComparison();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseComparison()
+    Expr* Parser::parseComparison()
     {
         auto expr = parseBitwiseShift();
 
@@ -795,13 +839,13 @@ namespace flow
         {
             Token op = previous();
             auto right = parseBitwiseShift();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseBitwiseShift()
+    Expr* Parser::parseBitwiseShift()
     {
         auto expr = parseTerm();
 
@@ -809,13 +853,13 @@ namespace flow
         {
             Token op = previous();
             auto right = parseTerm();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseTerm()
+    Expr* Parser::parseTerm()
     {
         auto expr = parseFactor();
 
@@ -823,13 +867,13 @@ namespace flow
         {
             Token op = previous();
             auto right = parseFactor();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseFactor()
+    Expr* Parser::parseFactor()
     {
         auto expr = parseUnary();
 
@@ -837,25 +881,25 @@ namespace flow
         {
             Token op = previous();
             auto right = parseUnary();
-            expr = std::make_shared<BinaryExpr>(expr, op.type, right, op.location);
+            expr = arena->create<BinaryExpr>(expr, op.type, right, location(op));
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parseUnary()
+    Expr* Parser::parseUnary()
     {
         if (match(TokenType::NOT) || match(TokenType::MINUS) || match(TokenType::TILDE))
         {
             Token op = previous();
             auto right = parseUnary();
-            return std::make_shared<UnaryExpr>(op.type, right, op.location);
+            return arena->create<UnaryExpr>(op.type, right, location(op));
         }
 
         return parseCall();
     }
 
-    std::shared_ptr<Expr> Parser::parseCall()
+    Expr* Parser::parseCall()
     {
         auto expr = parsePrimary();
 
@@ -864,7 +908,7 @@ namespace flow
             if (match(TokenType::LPAREN))
             {
                 // Function call
-                std::vector<std::shared_ptr<Expr>> arguments;
+                std::vector<Expr*> arguments;
 
                 if (!check(TokenType::RPAREN))
                 {
@@ -876,20 +920,20 @@ namespace flow
                 }
 
                 consume(TokenType::RPAREN, "Expected ')' after arguments");
-                expr = std::make_shared<CallExpr>(expr, arguments, expr->location);
+                expr = arena->create<CallExpr>(expr, std::move(arguments), expr->location);
             }
             else if (match(TokenType::DOT))
             {
                 // Member access
                 Token member = consume(TokenType::IDENTIFIER, "Expected property name after '.'");
-                expr = std::make_shared<MemberAccessExpr>(expr, member.lexeme, expr->location);
+                expr = arena->create<MemberAccessExpr>(expr, lexeme(member), expr->location);
             }
             else if (match(TokenType::LBRACKET))
             {
                 // Array indexing
                 auto index = parseExpression();
                 consume(TokenType::RBRACKET, "Expected ']' after array index");
-                expr = std::make_shared<IndexExpr>(expr, index, expr->location);
+                expr = arena->create<IndexExpr>(expr, index, expr->location);
             }
             else
             {
@@ -900,7 +944,7 @@ namespace flow
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::parsePrimary()
+    Expr* Parser::parsePrimary()
     {
         Token token = peek();
 
@@ -908,38 +952,38 @@ namespace flow
         if (token.type == TokenType::KW_THIS)
         {
             advance();
-            return std::make_shared<ThisExpr>(token.location);
+            return arena->create<ThisExpr>(location(token));
         }
 
         // Integer literals
         if (token.type == TokenType::INT_LITERAL)
         {
             advance();
-            int value = std::stoi(token.lexeme);
-            return std::make_shared<IntLiteralExpr>(value, token.location);
+            int value = std::stoi(lexeme(token));
+            return arena->create<IntLiteralExpr>(value, location(token));
         }
 
         // Float literals
         if (token.type == TokenType::FLOAT_LITERAL)
         {
             advance();
-            double value = std::stod(token.lexeme);
-            return std::make_shared<FloatLiteralExpr>(value, token.location);
+            double value = std::stod(lexeme(token));
+            return arena->create<FloatLiteralExpr>(value, location(token));
         }
 
         // String literals
         if (token.type == TokenType::STRING_LITERAL)
         {
             advance();
-            return std::make_shared<StringLiteralExpr>(token.lexeme, token.location);
+            return arena->create<StringLiteralExpr>(lexeme(token), location(token));
         }
 
         // Boolean literals
         if (token.type == TokenType::BOOL_LITERAL)
         {
             advance();
-            bool value = (token.lexeme == "true");
-            return std::make_shared<BoolLiteralExpr>(value, token.location);
+            bool value = (lexeme(token) == "true");
+            return arena->create<BoolLiteralExpr>(value, location(token));
         }
 
         // Lambda expressions with optional return type, or identifiers
@@ -949,8 +993,8 @@ namespace flow
             token.type == TokenType::IDENTIFIER)
         {
             // Check if this might be a lambda with return type
-            std::shared_ptr<Type> returnType = nullptr;
-            SourceLocation lambdaLoc = token.location;
+            const Type *returnType = nullptr;
+            SourceLocation lambdaLoc = location(token);
             
             // Check if we have "type lambda" pattern
             if (token.type >= TokenType::TYPE_INT && token.type <= TokenType::TYPE_VOID)
@@ -959,30 +1003,30 @@ namespace flow
                 advance(); // consume the type token (int, float, etc.)
                 if (token.type == TokenType::TYPE_INT)
                 {
-                    returnType = std::make_shared<Type>(TypeKind::INT, "int");
+                    returnType = types.getInt();
                 }
                 else if (token.type == TokenType::TYPE_FLOAT)
                 {
-                    returnType = std::make_shared<Type>(TypeKind::FLOAT, "float");
+                    returnType = types.getFloat();
                 }
                 else if (token.type == TokenType::TYPE_STRING)
                 {
-                    returnType = std::make_shared<Type>(TypeKind::STRING, "string");
+                    returnType = types.getString();
                 }
                 else if (token.type == TokenType::TYPE_BOOL)
                 {
-                    returnType = std::make_shared<Type>(TypeKind::BOOL, "bool");
+                    returnType = types.getBool();
                 }
                 else if (token.type == TokenType::TYPE_VOID)
                 {
-                    returnType = std::make_shared<Type>(TypeKind::VOID, "void");
+                    returnType = types.getVoid();
                 }
                 
                 if (check(TokenType::KW_LAMBDA))
                 {
                     // Yes, it's a typed lambda!
                     advance(); // consume 'lambda'
-                    lambdaLoc = previous().location;
+                    lambdaLoc = location(previous());
                 }
                 else
                 {
@@ -1001,26 +1045,26 @@ namespace flow
                 {
                     // It's a custom typed lambda: MyType lambda[...]
                     advance(); // consume 'lambda'
-                    lambdaLoc = previous().location;
-                    returnType = std::make_shared<Type>(TypeKind::STRUCT, idToken.lexeme);
+                    lambdaLoc = location(previous());
+                    returnType = types.getStruct(lexeme(idToken));
                 }
                 else
                 {
                     // Just an identifier, backtrack
                     current = savedPos;
                     advance();
-                    return std::make_shared<IdentifierExpr>(token.lexeme, token.location);
+                    return arena->create<IdentifierExpr>(lexeme(token), location(token));
                 }
             }
             else if (token.type == TokenType::KW_LAMBDA)
             {
                 advance(); // consume 'lambda'
-                lambdaLoc = token.location;
-                returnType = std::make_shared<Type>(TypeKind::VOID, "void");
+                lambdaLoc = location(token);
+                returnType = types.getVoid();
             }
 
-            auto lambda = std::make_shared<LambdaExpr>(lambdaLoc);
-            lambda->returnType = returnType ? returnType : std::make_shared<Type>(TypeKind::VOID, "void");
+            auto lambda = arena->create<LambdaExpr>(lambdaLoc);
+            lambda->returnType = returnType ? returnType : types.getVoid();
 
             // Parse parameters in brackets: lambda[param1: type1, param2: type2]
             consume(TokenType::LBRACKET, "Expected '[' after 'lambda'");
@@ -1062,7 +1106,7 @@ namespace flow
         if (token.type == TokenType::LBRACKET)
         {
             advance();
-            std::vector<std::shared_ptr<Expr>> elements;
+            std::vector<Expr*> elements;
 
             if (!check(TokenType::RBRACKET))
             {
@@ -1074,14 +1118,14 @@ namespace flow
             }
 
             consume(TokenType::RBRACKET, "Expected ']' after array elements");
-            return std::make_shared<ArrayLiteralExpr>(elements, token.location);
+            return arena->create<ArrayLiteralExpr>(std::move(elements), location(token));
         }
 
         // Struct initialization
         if (token.type == TokenType::LBRACE)
         {
             advance();
-            std::vector<std::shared_ptr<Expr>> fields;
+            std::vector<Expr*> fields;
 
             if (!check(TokenType::RBRACE))
             {
@@ -1093,16 +1137,16 @@ namespace flow
             }
 
             consume(TokenType::RBRACE, "Expected '}' after struct fields");
-            return std::make_shared<StructInitExpr>("", fields, token.location);
+            return arena->create<StructInitExpr>("", std::move(fields), location(token));
         }
 
         throw error(token, "Expected expression");
     }
 
-    std::shared_ptr<Type> Parser::parseType()
+    const Type *Parser::parseType()
     {
         Token token = advance();
-        std::shared_ptr<Type> baseType;
+        const Type *baseType = nullptr;
 
         // Check for lambda/function types: "return_type lambda[param_types]"
         // We need to check if this is a type followed by 'lambda' keyword
@@ -1113,30 +1157,30 @@ namespace flow
             int savedPos = current;
             
             // Parse the potential return type
-            std::shared_ptr<Type> returnType;
+            const Type *returnType = nullptr;
             if (token.type == TokenType::TYPE_INT)
             {
-                returnType = std::make_shared<Type>(TypeKind::INT, "int");
+                returnType = types.getInt();
             }
             else if (token.type == TokenType::TYPE_FLOAT)
             {
-                returnType = std::make_shared<Type>(TypeKind::FLOAT, "float");
+                returnType = types.getFloat();
             }
             else if (token.type == TokenType::TYPE_STRING)
             {
-                returnType = std::make_shared<Type>(TypeKind::STRING, "string");
+                returnType = types.getString();
             }
             else if (token.type == TokenType::TYPE_BOOL)
             {
-                returnType = std::make_shared<Type>(TypeKind::BOOL, "bool");
+                returnType = types.getBool();
             }
             else if (token.type == TokenType::TYPE_VOID)
             {
-                returnType = std::make_shared<Type>(TypeKind::VOID, "void");
+                returnType = types.getVoid();
             }
             else if (token.type == TokenType::IDENTIFIER)
             {
-                returnType = std::make_shared<Type>(TypeKind::STRUCT, token.lexeme);
+                returnType = types.getStruct(lexeme(token));
             }
             
             // Check if next token is 'lambda'
@@ -1145,27 +1189,22 @@ namespace flow
                 advance(); // consume 'lambda'
                 
                 // This is a function type!
-                auto funcType = std::make_shared<Type>(TypeKind::FUNCTION, "lambda");
-                
-                // Store return type in typeParams[0]
-                funcType->typeParams.push_back(returnType);
-                
                 // Parse parameter types: lambda[type1, type2, ...]
                 consume(TokenType::LBRACKET, "Expected '[' after 'lambda' in function type");
                 
+                std::vector<const Type *> paramTypes;
                 if (!check(TokenType::RBRACKET))
                 {
                     do
                     {
-                        auto paramType = parseType();
-                        funcType->typeParams.push_back(paramType);
+                        paramTypes.push_back(parseType());
                     }
                     while (match(TokenType::COMMA));
                 }
                 
                 consume(TokenType::RBRACKET, "Expected ']' after lambda parameter types");
                 
-                return funcType;
+                return types.getFunction(returnType, paramTypes);
             }
             else
             {
@@ -1182,17 +1221,13 @@ namespace flow
         if (match(TokenType::LBRACKET))
         {
             consume(TokenType::RBRACKET, "Expected ']' after '['");
-            auto arrayType = std::make_shared<Type>(TypeKind::ARRAY, "array");
-            arrayType->typeParams.push_back(baseType);
-            return arrayType;
+            return types.getArray(baseType);
         }
 
         // Check for optional type: type? -> desugar to Option<type>
         if (match(TokenType::QUESTION))
         {
-            auto optionalType = std::make_shared<Type>(TypeKind::STRUCT, "Option");
-            optionalType->typeParams.push_back(baseType);
-            return optionalType;
+            return types.getOption(baseType);
         }
 
         return baseType;
@@ -1204,6 +1239,6 @@ namespace flow
         consume(TokenType::COLON, "Expected ':' after parameter name");
         auto type = parseType();
 
-        return Parameter(name.lexeme, type);
+        return Parameter(lexeme(name), type);
     }
 } // namespace flow
\ No newline at end of file
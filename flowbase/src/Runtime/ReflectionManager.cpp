@@ -94,7 +94,7 @@ void ReflectionManager::registerFlowModuleFromAST(const std::string& name, std::
             continue;
         }
 
-        if (auto funcDecl = std::dynamic_pointer_cast<FunctionDecl>(decl)) {
+        if (auto funcDecl = dyn_cast<FunctionDecl>(decl)) {
             std::cerr << "FunctionDecl";
 
             // Check if the function declaration has a valid name
@@ -1,8 +1,11 @@
 #include "../../include/Sema/SemanticAnalyzer.h"
 #include "../../include/Common/ErrorReporter.h"
+#include "../../include/Common/ModuleGraph.h"
+#include "../../include/Common/ThreadPool.h"
 #include "../../include/Lexer/Lexer.h"
 #include "../../include/Parser/Parser.h"
 #include "../../include/LSP/LSPErrorCollector.h"
+#include <llvm/Support/TimeProfiler.h>
 #include <algorithm>
 #include <iostream>
 #include <fstream>
@@ -13,35 +16,25 @@ namespace flow
 {
     void SymbolTable::enterScope()
     {
-        scopes.emplace_back();
+        scopes.pushScope();
     }
 
     void SymbolTable::exitScope()
     {
-        if (!scopes.empty())
-        {
-            scopes.pop_back();
-        }
+        scopes.popScope();
     }
 
-    void SymbolTable::define(const std::string& name, std::shared_ptr<Type> type, bool isMutable, bool isFunction)
+    void SymbolTable::define(const std::string& name, const Type* type, bool isMutable, bool isFunction)
     {
-        if (scopes.empty()) return;
-        scopes.back()[name] = Symbol(name, type, isMutable, isFunction);
+        if (scopes.depth() == 0) return;
+        SymbolID id = StringInterner::instance().intern(name);
+        scopes.insert(id, Symbol(id, type, isMutable, isFunction));
     }
 
     SymbolTable::Symbol* SymbolTable::lookup(const std::string& name)
     {
-        // Search from innermost to outermost scope
-        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it)
-        {
-            auto found = it->find(name);
-            if (found != it->end())
-            {
-                return &found->second;
-            }
-        }
-        return nullptr;
+        // The innermost definition wins
+        return scopes.find(name);
     }
 
     bool SymbolTable::isDefined(const std::string& name)
@@ -58,6 +51,12 @@ namespace flow
 
     void SemanticAnalyzer::reportError(const std::string& message, const SourceLocation& loc)
     {
+        if (pendingErrors)
+        {
+            pendingErrors->emplace_back(message, loc);
+            return;
+        }
+
         if (errorCollector)
         {
             errorCollector->reportError("Semantic", message, loc);
@@ -74,13 +73,18 @@ namespace flow
         errorCollector = collector;
     }
 
-    bool SemanticAnalyzer::typesMatch(std::shared_ptr<Type> t1, std::shared_ptr<Type> t2)
+    bool SemanticAnalyzer::typesMatch(const Type* t1, const Type* t2)
     {
         if (!t1 || !t2) return false;
 
         t1 = resolveTypeAlias(t1);
         t2 = resolveTypeAlias(t2);
 
+        // Types are interned, so identical types are the same object
+        if (t1 == t2) return true;
+
+        // Same constructor with different parameters: the parameters may
+        // still match through aliases or coercion
         if (t1->kind == t2->kind && t1->name == t2->name)
         {
             if (!t1->typeParams.empty() || !t2->typeParams.empty())
@@ -137,14 +141,14 @@ namespace flow
     void SemanticAnalyzer::analyze(std::shared_ptr<Program> program)
     {
         // Register built-in functions
-        auto voidType = std::make_shared<Type>(TypeKind::VOID, "void");
-        auto intType = std::make_shared<Type>(TypeKind::INT, "int");
-        auto floatType = std::make_shared<Type>(TypeKind::FLOAT, "float");
-        auto stringType = std::make_shared<Type>(TypeKind::STRING, "string");
-        auto boolType = std::make_shared<Type>(TypeKind::BOOL, "bool");
+        auto voidType = types.getVoid();
+        auto intType = types.getInt();
+        auto floatType = types.getFloat();
+        auto stringType = types.getString();
+        auto boolType = types.getBool();
 
 
-        auto optionType = std::make_shared<Type>(TypeKind::STRUCT, "Option");
+        auto optionType = types.getStruct("Option");
         symbolTable.define("Option", optionType, false);
 
 
@@ -154,6 +158,7 @@ namespace flow
         symbolTable.define("println", voidType, false, true);
 
         symbolTable.define("len", intType, false, true);
+        symbolTable.define("push", voidType, false, true);
 
         symbolTable.define("malloc", stringType, false, true);    // Returns ptr (as string)
         symbolTable.define("free", voidType, false, true);        // Returns void
@@ -191,22 +196,22 @@ namespace flow
 
     void SemanticAnalyzer::visit(IntLiteralExpr& node)
     {
-        node.type = std::make_shared<Type>(TypeKind::INT, "int");
+        node.type = types.getInt();
     }
 
     void SemanticAnalyzer::visit(FloatLiteralExpr& node)
     {
-        node.type = std::make_shared<Type>(TypeKind::FLOAT, "float");
+        node.type = types.getFloat();
     }
 
     void SemanticAnalyzer::visit(StringLiteralExpr& node)
     {
-        node.type = std::make_shared<Type>(TypeKind::STRING, "string");
+        node.type = types.getString();
     }
 
     void SemanticAnalyzer::visit(BoolLiteralExpr& node)
     {
-        node.type = std::make_shared<Type>(TypeKind::BOOL, "bool");
+        node.type = types.getBool();
     }
 
     void SemanticAnalyzer::visit(IdentifierExpr& node)
@@ -219,20 +224,20 @@ namespace flow
         else
         {
             reportError("Undefined identifier: " + node.name, node.location);
-            node.type = std::make_shared<Type>(TypeKind::UNKNOWN);
+            node.type = types.getUnknown();
         }
     }
 
     void SemanticAnalyzer::visit(ThisExpr& node)
     {
-        if (currentStructContext.empty())
+        if (!currentStructType)
         {
             reportError("'this' can only be used inside a method", node.location);
-            node.type = std::make_shared<Type>(TypeKind::UNKNOWN);
+            node.type = types.getUnknown();
         }
         else
         {
-            node.type = std::make_shared<Type>(TypeKind::STRUCT, currentStructContext);
+            node.type = currentStructType;
         }
     }
 
@@ -258,7 +263,19 @@ namespace flow
             case TokenType::AND:
             case TokenType::OR:
                 // Comparison and logical operators return bool
-                node.type = std::make_shared<Type>(TypeKind::BOOL, "bool");
+                node.type = types.getBool();
+                break;
+            case TokenType::PLUS:
+                // A string on either side makes this a concatenation
+                if (node.right && node.right->type &&
+                    resolveTypeAlias(node.right->type)->kind == TypeKind::STRING)
+                {
+                    node.type = node.right->type;
+                }
+                else
+                {
+                    node.type = node.left->type;
+                }
                 break;
             default:
                 // Arithmetic operators inherit type from left operand
@@ -292,7 +309,7 @@ namespace flow
         }
 
         // Infer return type from function
-        if (auto* idExpr = dynamic_cast<IdentifierExpr*>(node.callee.get()))
+        if (auto* idExpr = dyn_cast<IdentifierExpr>(node.callee))
         {
             auto* symbol = symbolTable.lookup(idExpr->name);
             if (symbol)
@@ -301,6 +318,10 @@ namespace flow
                 {
                     // Regular function call
                     node.type = symbol->type;
+                    if (idExpr->name == "len" || idExpr->name == "push")
+                    {
+                        checkArrayBuiltin(idExpr->name, node);
+                    }
                 }
                 else if (symbol->type && symbol->type->kind == TypeKind::FUNCTION)
                 {
@@ -312,7 +333,7 @@ namespace flow
                     }
                     else
                     {
-                        node.type = std::make_shared<Type>(TypeKind::VOID, "void");
+                        node.type = types.getVoid();
                     }
                 }
             }
@@ -327,11 +348,44 @@ namespace flow
             }
             else
             {
-                node.type = std::make_shared<Type>(TypeKind::VOID, "void");
+                node.type = types.getVoid();
             }
         }
     }
 
+    void SemanticAnalyzer::checkArrayBuiltin(const std::string& name, CallExpr& node)
+    {
+        size_t expected = name == "push" ? 2 : 1;
+        if (node.arguments.size() != expected)
+        {
+            reportError(name + "() expects " + std::to_string(expected) + " argument" +
+                        (expected == 1 ? "" : "s") + ", but got " + std::to_string(node.arguments.size()),
+                        node.location);
+            return;
+        }
+
+        const Type* arrayType = node.arguments[0] ? node.arguments[0]->type : nullptr;
+        if (!arrayType)
+        {
+            return;
+        }
+        arrayType = resolveTypeAlias(arrayType);
+        if (arrayType->kind != TypeKind::ARRAY)
+        {
+            reportError(name + "() expects an array, but got '" + arrayType->name + "'", node.location);
+            return;
+        }
+
+        // push(array, value): the value must fit the element type
+        const Expr* value = name == "push" ? node.arguments[1] : nullptr;
+        if (value && value->type && !arrayType->typeParams.empty() &&
+            !typesMatch(value->type, arrayType->typeParams[0]))
+        {
+            reportError("Cannot push '" + value->type->name + "' onto an array of '" +
+                        arrayType->typeParams[0]->name + "'", node.location);
+        }
+    }
+
     void SemanticAnalyzer::visit(MemberAccessExpr& node)
     {
         // Type check the object
@@ -343,11 +397,12 @@ namespace flow
             if (node.object->type && node.object->type->kind == TypeKind::STRUCT)
             {
                 // Look up the field type from struct definition
-                auto structIt = structFields.find(node.object->type->name);
-                if (structIt != structFields.end())
+                auto structIt = structs.find(node.object->type->name);
+                if (structIt != structs.end())
                 {
-                    auto fieldIt = structIt->second.find(node.member);
-                    if (fieldIt != structIt->second.end())
+                    const auto& fields = structIt->second.fields;
+                    auto fieldIt = fields.find(node.member);
+                    if (fieldIt != fields.end())
                     {
                         node.type = fieldIt->second;
                     }
@@ -355,13 +410,13 @@ namespace flow
                     {
                         reportError("Unknown field '" + node.member + "' in struct '" + node.object->type->name + "'",
                                     node.location);
-                        node.type = std::make_shared<Type>(TypeKind::UNKNOWN, "unknown");
+                        node.type = types.getUnknown("unknown");
                     }
                 }
                 else
                 {
                     reportError("Unknown struct type: " + node.object->type->name, node.location);
-                    node.type = std::make_shared<Type>(TypeKind::UNKNOWN, "unknown");
+                    node.type = types.getUnknown("unknown");
                 }
             }
             else if (node.object->type)
@@ -378,21 +433,21 @@ namespace flow
             if (field) field->accept(*this);
         }
 
-        auto structIt = structFields.find(node.structName);
-        if (structIt == structFields.end())
+        auto structIt = structs.find(node.structName);
+        if (structIt == structs.end())
         {
             reportError("Unknown struct type: " + node.structName, node.location);
-            node.type = std::make_shared<Type>(TypeKind::UNKNOWN, "unknown");
+            node.type = types.getUnknown("unknown");
             return;
         }
 
-        const auto& expectedFields = structIt->second;
+        const auto& expectedFields = structIt->second.fields;
         if (node.fieldValues.size() != expectedFields.size())
         {
             reportError("Struct '" + node.structName + "' expects " +
                         std::to_string(expectedFields.size()) + " fields, but got " +
                         std::to_string(node.fieldValues.size()), node.location);
-            node.type = std::make_shared<Type>(TypeKind::STRUCT, node.structName);
+            node.type = structIt->second.type;
             return;
         }
 
@@ -414,13 +469,13 @@ namespace flow
             i++;
         }
 
-        node.type = std::make_shared<Type>(TypeKind::STRUCT, node.structName);
+        node.type = structIt->second.type;
     }
 
     void SemanticAnalyzer::visit(ArrayLiteralExpr& node)
     {
         // Type check all elements
-        std::shared_ptr<Type> elementType = nullptr;
+        const Type* elementType = nullptr;
 
         for (auto& elem : node.elements)
         {
@@ -445,13 +500,11 @@ namespace flow
         // Set the array type
         if (elementType)
         {
-            auto arrayType = std::make_shared<Type>(TypeKind::ARRAY, "array");
-            arrayType->typeParams.push_back(elementType);
-            node.type = arrayType;
+            node.type = types.getArray(elementType);
         }
         else
         {
-            node.type = std::make_shared<Type>(TypeKind::ARRAY, "array");
+            node.type = types.get(TypeKind::ARRAY, "array");
         }
     }
 
@@ -491,24 +544,13 @@ namespace flow
     void SemanticAnalyzer::visit(LambdaExpr& node)
     {
         // Create a function type for the lambda that includes return type info
-        auto funcType = std::make_shared<Type>(TypeKind::FUNCTION, "lambda");
-        
-        // Store the return type in the function type's typeParams
         // typeParams[0] = return type, typeParams[1..n] = parameter types
-        if (node.returnType)
-        {
-            funcType->typeParams.push_back(node.returnType);
-        }
-        else
-        {
-            funcType->typeParams.push_back(std::make_shared<Type>(TypeKind::VOID, "void"));
-        }
-        
-        // Add parameter types to the function type
+        std::vector<const Type*> paramTypes;
         for (const auto& param : node.parameters)
         {
-            funcType->typeParams.push_back(param.type);
+            paramTypes.push_back(param.type);
         }
+        auto funcType = types.getFunction(node.returnType ? node.returnType : types.getVoid(), paramTypes);
         
         // Enter a new scope for lambda parameters
         symbolTable.enterScope();
@@ -559,7 +601,7 @@ namespace flow
         }
 
         // Type inference: if no explicit type, infer from initializer
-        std::shared_ptr<Type> varType = node.declaredType;
+        const Type* varType = node.declaredType;
         if (!varType && node.initializer && node.initializer->type)
         {
             varType = node.initializer->type;
@@ -699,8 +741,21 @@ namespace flow
         // Enter new scope for loop body
         symbolTable.enterScope();
 
-        // Add iterator variable to scope (defaults to int for ranges)
-        auto iterType = std::make_shared<Type>(TypeKind::INT, "int");
+        // Add iterator variable to scope: an int for ranges, the element
+        // for arrays
+        const Type* iterType = types.getInt();
+        const Type* iterableType = node.iterable && node.iterable->type ? resolveTypeAlias(node.iterable->type) : nullptr;
+        if (iterableType && iterableType->kind == TypeKind::ARRAY)
+        {
+            if (iterableType->typeParams.empty())
+            {
+                reportError("Cannot infer the element type of the array being iterated", node.location);
+            }
+            else
+            {
+                iterType = iterableType->typeParams[0];
+            }
+        }
         symbolTable.define(node.iteratorVar, iterType, false); // false = immutable
 
         // Check body statements
@@ -751,9 +806,18 @@ namespace flow
     }
 
     void SemanticAnalyzer::visit(FunctionDecl& node)
+    {
+        declareFunction(node);
+        checkBody(node);
+    }
+
+    void SemanticAnalyzer::declareFunction(FunctionDecl& node)
     {
         symbolTable.define(node.name, node.returnType, false, true);
+    }
 
+    void SemanticAnalyzer::checkBody(FunctionDecl& node)
+    {
         symbolTable.enterScope();
         currentFunctionReturnType = node.returnType;
 
@@ -776,37 +840,55 @@ namespace flow
     void SemanticAnalyzer::visit(StructDecl& node)
     {
         // Register struct type
-        auto structType = std::make_shared<Type>(TypeKind::STRUCT, node.name);
+        auto structType = types.getStruct(node.name);
         symbolTable.define(node.name, structType, false);
 
         // Register field types for member access
-        std::map<std::string, std::shared_ptr<Type>> fields;
+        StructInfo& info = structs[node.name];
+        info.type = structType;
+        info.fields.clear();
         for (const auto& field : node.fields)
         {
-            fields[field.name] = field.type;
+            info.fields[field.name] = field.type;
         }
-        structFields[node.name] = fields;
     }
 
     void SemanticAnalyzer::visit(ImplDecl& node)
+    {
+        if (declareMethod(node))
+        {
+            checkBody(node);
+        }
+    }
+
+    bool SemanticAnalyzer::declareMethod(ImplDecl& node)
     {
         // Check that the struct exists
-        if (structFields.find(node.structName) == structFields.end())
+        if (structs.find(node.structName) == structs.end())
         {
             errors.push_back("Cannot implement method for undefined struct: " + node.structName);
-            return;
+            return false;
         }
 
+        // Register the method in the symbol table
+        // Store it as StructName::methodName
+        auto methodType = node.returnType ? node.returnType : types.getVoid();
+        symbolTable.define(node.name, methodType, false, true);
+        return true;
+    }
+
+    void SemanticAnalyzer::checkBody(ImplDecl& node)
+    {
         // Enter new scope for method
         symbolTable.enterScope();
 
         // Set current struct context for 'this' keyword
-        std::string savedContext = currentStructContext;
-        currentStructContext = node.structName;
+        const Type* savedStructType = currentStructType;
+        auto structIt = structs.find(node.structName);
+        currentStructType = structIt != structs.end() ? structIt->second.type : types.getStruct(node.structName);
 
         // Define 'this' variable with struct type
-        auto thisType = std::make_shared<Type>(TypeKind::STRUCT, node.structName);
-        symbolTable.define("this", thisType, false, false);
+        symbolTable.define("this", currentStructType, false, false);
 
         // Define parameters
         for (const auto& param : node.parameters)
@@ -827,34 +909,38 @@ namespace flow
         currentFunctionReturnType = savedReturnType;
 
         // Restore context and exit scope
-        currentStructContext = savedContext;
+        currentStructType = savedStructType;
         symbolTable.exitScope();
-
-        // Register the method in the symbol table
-        // Store it as StructName::methodName
-        auto methodType = node.returnType ? node.returnType : std::make_shared<Type>(TypeKind::VOID, "void");
-        symbolTable.define(node.name, methodType, false, true);
     }
 
     void SemanticAnalyzer::visit(TypeDefDecl& node)
     {
         // Register type alias
         typeAliases[node.name] = node.aliasedType;
+        resolvedAliases.clear();
     }
 
-    std::shared_ptr<Type> SemanticAnalyzer::resolveTypeAlias(std::shared_ptr<Type> type)
+    const Type* SemanticAnalyzer::resolveTypeAlias(const Type* type)
     {
-        if (!type) return type;
+        if (!type || typeAliases.empty()) return type;
+
+        auto cached = resolvedAliases.find(type);
+        if (cached != resolvedAliases.end())
+        {
+            return cached->second;
+        }
 
         // Check if this type name is an alias
+        const Type* resolved = type;
         auto it = typeAliases.find(type->name);
         if (it != typeAliases.end())
         {
             // Recursively resolve in case of chained aliases
-            return resolveTypeAlias(it->second);
+            resolved = resolveTypeAlias(it->second);
         }
 
-        return type;
+        resolvedAliases[type] = resolved;
+        return resolved;
     }
 
     void SemanticAnalyzer::visit(LinkDecl& node)
@@ -947,7 +1033,7 @@ namespace flow
             else
             {
                 // Default to void if no return type specified
-                auto voidType = std::make_shared<Type>(TypeKind::VOID, "void");
+                auto voidType = types.getVoid();
                 symbolTable.define(func->name, voidType, false, true);
             }
         }
@@ -955,41 +1041,7 @@ namespace flow
 
     std::string SemanticAnalyzer::resolveModulePath(const std::string& importPath)
     {
-        namespace fs = std::filesystem;
-
-        // If absolute path, use as-is
-        if (fs::path(importPath).is_absolute())
-        {
-            return importPath;
-        }
-
-        // First try: resolve relative to current directory
-        fs::path fullPath = fs::path(currentDirectory) / importPath;
-
-        try
-        {
-            return fs::canonical(fullPath).string();
-        }
-        catch (const fs::filesystem_error&)
-        {
-            // If that fails, try library paths
-            for (const auto& libPath : libraryPaths)
-            {
-                fs::path libFullPath = fs::path(libPath) / importPath;
-                try
-                {
-                    return fs::canonical(libFullPath).string();
-                }
-                catch (const fs::filesystem_error&)
-                {
-                    // Continue to next library path
-                }
-            }
-
-            // If all library paths fail, return the original path
-            // (will fail later with better error message)
-            return fullPath.string();
-        }
+        return ModuleGraph::resolveImport(importPath, currentDirectory, libraryPaths);
     }
 
     std::shared_ptr<Program> SemanticAnalyzer::loadModule(const std::string& modulePath)
@@ -1001,44 +1053,70 @@ namespace flow
             return it->second;
         }
 
-        // Read the file
-        std::ifstream file(modulePath);
-        if (!file.is_open())
+        llvm::TimeTraceScope timeScope("LoadImport", modulePath);
+
+        // Parsed once per session and shared with every other importer
+        auto unit = ModuleGraph::instance().load(modulePath);
+        if (!unit->program)
         {
-            throw std::runtime_error("Failed to open module: " + modulePath);
+            throw std::runtime_error(unit->error);
         }
 
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string source = buffer.str();
-        file.close();
-
-        // Lexically analyze
-        Lexer lexer(source, modulePath);
-        std::vector<Token> tokens = lexer.tokenize();
-
-        // Parse
-        Parser parser(tokens);
-        auto program = parser.parse();
-
-        // Cache the module
+        // Cache before declaring so import cycles terminate
+        auto program = unit->program;
         loadedModules[modulePath] = program;
 
-        // Analyze the module (recursive)
         std::string savedDir = currentDirectory;
         currentDirectory = std::filesystem::path(modulePath).parent_path().string();
 
-        for (auto& decl : program->declarations)
+        declareModuleInterface(*program);
+
+        currentDirectory = savedDir;
+
+        return program;
+    }
+
+    void SemanticAnalyzer::declareModuleInterface(Program& module)
+    {
+        // Bodies are checked when the module itself is compiled; importers only need
+        // the signatures. This also keeps the shared AST read-only here.
+        for (auto& decl : module.declarations)
         {
-            if (decl)
+            if (!decl) continue;
+
+            if (auto* funcDecl = dyn_cast<FunctionDecl>(decl))
+            {
+                symbolTable.define(funcDecl->name, funcDecl->returnType, false, true);
+            }
+            else if (auto* implDecl = dyn_cast<ImplDecl>(decl))
+            {
+                auto methodType = implDecl->returnType
+                                      ? implDecl->returnType
+                                      : types.getVoid();
+                symbolTable.define(implDecl->name, methodType, false, true);
+            }
+            else if (auto* linkDecl = dyn_cast<LinkDecl>(decl))
+            {
+                for (auto& func : linkDecl->functions)
+                {
+                    if (!func) continue;
+                    auto returnType = func->returnType
+                                          ? func->returnType
+                                          : types.getVoid();
+                    symbolTable.define(func->name, returnType, false, true);
+                }
+            }
+            else if (auto* importDecl = dyn_cast<ImportDecl>(decl))
+            {
+                // Transitive imports stay visible, as before
+                auto imported = loadModule(resolveModulePath(importDecl->modulePath));
+                importSymbolsFrom(imported, importDecl->imports, importDecl->alias);
+            }
+            else if (isa<StructDecl>(decl) || isa<TypeDefDecl>(decl))
             {
                 decl->accept(*this);
             }
         }
-
-        currentDirectory = savedDir;
-
-        return program;
     }
 
     void SemanticAnalyzer::importSymbolsFrom(std::shared_ptr<Program> module,
@@ -1049,48 +1127,50 @@ namespace flow
 
         for (auto& decl : module->declarations)
         {
-            FunctionDecl* funcDecl = dynamic_cast<FunctionDecl*>(decl.get());
+            FunctionDecl* funcDecl = dyn_cast<FunctionDecl>(decl);
             if (funcDecl)
             {
                 if (symbols.empty() || std::find(symbols.begin(), symbols.end(), funcDecl->name) != symbols.end())
                 {
                     std::string importName = alias.empty() ? funcDecl->name : alias + "." + funcDecl->name;
                     symbolTable.define(importName, funcDecl->returnType, false, true);
-                    std::cout << "  Imported function: " << importName << std::endl;
+                    if (verbose) ErrorReporter::output() << "  Imported function: " << importName << std::endl;
                 }
             }
 
-            StructDecl* structDecl = dynamic_cast<StructDecl*>(decl.get());
+            StructDecl* structDecl = dyn_cast<StructDecl>(decl);
             if (structDecl)
             {
                 if (symbols.empty() || std::find(symbols.begin(), symbols.end(), structDecl->name) != symbols.end())
                 {
                     std::string importName = alias.empty() ? structDecl->name : alias + "." + structDecl->name;
-                    auto structType = std::make_shared<Type>(TypeKind::STRUCT, importName);
+                    auto structType = types.getStruct(importName);
                     symbolTable.define(importName, structType, false);
 
-                    std::map<std::string, std::shared_ptr<Type>> fields;
+                    StructInfo& info = structs[importName];
+                    info.type = structType;
+                    info.fields.clear();
                     for (const auto& field : structDecl->fields)
                     {
-                        fields[field.name] = field.type;
+                        info.fields[field.name] = field.type;
                     }
-                    structFields[importName] = fields;
-                    std::cout << "  Imported struct: " << importName << std::endl;
+                    if (verbose) ErrorReporter::output() << "  Imported struct: " << importName << std::endl;
                 }
             }
 
-            TypeDefDecl* typedefDecl = dynamic_cast<TypeDefDecl*>(decl.get());
+            TypeDefDecl* typedefDecl = dyn_cast<TypeDefDecl>(decl);
             if (typedefDecl)
             {
                 if (symbols.empty() || std::find(symbols.begin(), symbols.end(), typedefDecl->name) != symbols.end())
                 {
                     std::string importName = alias.empty() ? typedefDecl->name : alias + "." + typedefDecl->name;
                     typeAliases[importName] = typedefDecl->aliasedType;
-                    std::cout << "  Imported type alias: " << importName << std::endl;
+                    resolvedAliases.clear();
+                    if (verbose) ErrorReporter::output() << "  Imported type alias: " << importName << std::endl;
                 }
             }
 
-            LinkDecl* linkDecl = dynamic_cast<LinkDecl*>(decl.get());
+            LinkDecl* linkDecl = dyn_cast<LinkDecl>(decl);
             if (linkDecl)
             {
                 for (auto& func : linkDecl->functions)
@@ -1100,7 +1180,7 @@ namespace flow
                     {
                         std::string importName = alias.empty() ? func->name : alias + "." + func->name;
                         symbolTable.define(importName, func->returnType, false, true);
-                        std::cout << "  Imported foreign function: " << importName << std::endl;
+                        if (verbose) ErrorReporter::output() << "  Imported foreign function: " << importName << std::endl;
                     }
                 }
             }
@@ -1109,7 +1189,7 @@ namespace flow
 
     void SemanticAnalyzer::visit(ImportDecl& node)
     {
-        std::cout << "Import: " << node.modulePath << std::endl;
+        if (verbose) ErrorReporter::output() << "Import: " << node.modulePath << std::endl;
 
         try
         {
@@ -1122,7 +1202,7 @@ namespace flow
             // Import specified symbols (or all if none specified)
             importSymbolsFrom(module, node.imports, node.alias);
 
-            std::cout << "  Module loaded successfully: " << resolvedPath << std::endl;
+            if (verbose) ErrorReporter::output() << "  Module loaded successfully: " << resolvedPath << std::endl;
         }
         catch (const std::exception& e)
         {
@@ -1133,23 +1213,100 @@ namespace flow
     void SemanticAnalyzer::visit(ModuleDecl& node)
     {
         // This could be used for namespacing in larger projects
-        std::cout << "Module: " << node.name << std::endl;
+        if (verbose) ErrorReporter::output() << "Module: " << node.name << std::endl;
     }
 
     void SemanticAnalyzer::visit(Program& node)
     {
-        std::cerr << "SemanticAnalyzer::visit(Program) - " << node.declarations.size() << " declarations" << std::endl;
-        int i = 0;
+        // Signatures, structs, aliases and imports first, so every body sees
+        // all of them (including functions declared further down)
+        std::vector<Decl*> bodies;
         for (auto& decl : node.declarations)
         {
-            if (decl)
+            if (!decl) continue;
+
+            if (auto* funcDecl = dyn_cast<FunctionDecl>(decl))
+            {
+                declareFunction(*funcDecl);
+                bodies.push_back(decl);
+            }
+            else if (auto* implDecl = dyn_cast<ImplDecl>(decl))
+            {
+                if (declareMethod(*implDecl))
+                {
+                    bodies.push_back(decl);
+                }
+            }
+            else
             {
-                std::cerr << "  Processing declaration " << i << ": " << decl->name << std::endl;
                 decl->accept(*this);
-                std::cerr << "  Declaration " << i << " processed successfully" << std::endl;
             }
-            i++;
         }
-        std::cerr << "SemanticAnalyzer::visit(Program) - all declarations processed" << std::endl;
+
+        checkBodies(bodies);
+    }
+
+    void SemanticAnalyzer::checkBodies(const std::vector<Decl*>& bodies)
+    {
+        auto check = [](SemanticAnalyzer& analyzer, Decl* decl)
+        {
+            if (auto* funcDecl = dyn_cast<FunctionDecl>(decl))
+            {
+                analyzer.checkBody(*funcDecl);
+            }
+            else
+            {
+                analyzer.checkBody(*cast<ImplDecl>(decl));
+            }
+        };
+
+        // Each task gets a contiguous run of bodies; small modules aren't
+        // worth the copies of the analyzer
+        const size_t minBodiesPerTask = 64;
+        unsigned threads = jobs == 0 ? ThreadPool::hardwareThreads() : jobs;
+        size_t tasks = std::min<size_t>(threads, bodies.size() / minBodiesPerTask);
+        if (tasks < 2)
+        {
+            for (Decl* decl : bodies)
+            {
+                check(*this, decl);
+            }
+            return;
+        }
+
+        llvm::TimeTraceScope timeScope("SemaBodies", std::to_string(bodies.size()) + " bodies");
+
+        // Every task checks its bodies with its own copy of the global state
+        // (bodies only change their own scopes) and keeps its diagnostics, so
+        // the output doesn't depend on thread timing
+        std::vector<std::vector<std::pair<std::string, SourceLocation> > > diagnostics(tasks);
+        {
+            ThreadPool pool(static_cast<unsigned>(tasks));
+            for (size_t task = 0; task < tasks; task++)
+            {
+                pool.submit([&, task]
+                {
+                    SemanticAnalyzer worker(*this);
+                    worker.errors.clear();
+                    worker.pendingErrors = &diagnostics[task];
+
+                    size_t begin = bodies.size() * task / tasks;
+                    size_t end = bodies.size() * (task + 1) / tasks;
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        check(worker, bodies[i]);
+                    }
+                });
+            }
+            pool.wait();
+        }
+
+        for (const auto& taskDiagnostics : diagnostics)
+        {
+            for (const auto& [message, location] : taskDiagnostics)
+            {
+                reportError(message, location);
+            }
+        }
     }
 } // namespace flow
\ No newline at end of file
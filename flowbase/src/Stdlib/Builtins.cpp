@@ -1,4 +1,5 @@
 #include "../../include/Stdlib/Builtins.h"
+#include "../../include/Stdlib/FlowString.h"
 #include <cstring>
 #include <cmath>
 #include <iostream>
@@ -9,40 +10,6 @@ namespace flow
 {
     namespace stdlib
     {
-        int strlen_impl(const char* str)
-        {
-            return str ? static_cast<int>(std::strlen(str)) : 0;
-        }
-
-        const char* substr_impl(const char* str, int start, int len)
-        {
-            if (!str) return "";
-
-            int strLen = std::strlen(str);
-            if (start < 0 || start >= strLen) return "";
-
-            int actualLen = (len > 0 && start + len < strLen) ? len : (strLen - start);
-            char* result = new char[actualLen + 1];
-            std::strncpy(result, str + start, actualLen);
-            result[actualLen] = '\0';
-            return result;
-        }
-
-        const char* concat_impl(const char* a, const char* b)
-        {
-            if (!a) a = "";
-            if (!b) b = "";
-
-            size_t lenA = std::strlen(a);
-            size_t lenB = std::strlen(b);
-            char* result = new char[lenA + lenB + 1];
-
-            std::strcpy(result, a);
-            std::strcat(result, b);
-            return result;
-        }
-
-
         int abs_impl(int x)
         {
             return std::abs(x);
@@ -74,8 +41,8 @@ namespace flow
             static std::string line;
             if (std::getline(std::cin, line))
             {
-                char* result = new char[line.length() + 1];
-                std::strcpy(result, line.c_str());
+                char* result = flow_string_alloc(static_cast<int64_t>(line.length()));
+                std::memcpy(result, line.data(), line.length());
                 return result;
             }
             return "";
@@ -112,8 +79,8 @@ namespace flow
             file.close();
 
             std::string content = buffer.str();
-            char* result = new char[content.length() + 1];
-            std::strcpy(result, content.c_str());
+            char* result = flow_string_alloc(static_cast<int64_t>(content.length()));
+            std::memcpy(result, content.data(), content.length());
             return result;
         }
     }
@@ -0,0 +1,99 @@
+#include "../../include/Stdlib/FlowArray.h"
+#include "../../include/Stdlib/FlowString.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace flow
+{
+    namespace
+    {
+        // The capacity an array grows to from empty
+        constexpr int64_t minimumCapacity = 8;
+
+        // len() returns an int and indices are ints
+        constexpr int64_t maximumLength = INT32_MAX;
+
+        [[noreturn]] void fail(const char* message)
+        {
+            std::fputs(message, stderr);
+            std::abort();
+        }
+
+        int64_t byteSize(int64_t elementSize, int64_t count)
+        {
+            if (elementSize < 0 || count < 0 || (elementSize > 0 && count > PTRDIFF_MAX / elementSize))
+            {
+                fail("Runtime Error: out of memory\n");
+            }
+            return elementSize * count;
+        }
+
+        FlowArray* allocateArray(int64_t region, int64_t elementSize, int64_t length)
+        {
+            if (length > maximumLength)
+            {
+                fail("Runtime Error: array longer than 2147483647 elements\n");
+            }
+
+            auto* array = static_cast<FlowArray*>(flow_region_alloc(region, sizeof(FlowArray)));
+            int64_t bytes = byteSize(elementSize, length);
+            array->data = bytes > 0 ? flow_region_alloc(region, bytes) : nullptr;
+            array->length = length;
+            array->capacity = length;
+            array->region = region;
+            return array;
+        }
+    } // namespace
+
+    extern "C" FlowArray* flow_array_new(int64_t elementSize, int64_t length)
+    {
+        FlowArray* array = allocateArray(flow_region_current(), elementSize, length);
+        if (array->data)
+        {
+            std::memset(array->data, 0, static_cast<size_t>(elementSize * length));
+        }
+        return array;
+    }
+
+    extern "C" void flow_array_grow(FlowArray* array, int64_t elementSize)
+    {
+        if (array->length < array->capacity)
+        {
+            return;
+        }
+        if (array->length >= maximumLength)
+        {
+            fail("Runtime Error: array longer than 2147483647 elements\n");
+        }
+
+        // Grown in the array's own region, which may be below the current one
+        int64_t capacity = array->capacity < minimumCapacity ? minimumCapacity : array->capacity * 2;
+        capacity = capacity < maximumLength ? capacity : maximumLength;
+        int64_t bytes = byteSize(elementSize, capacity);
+        if (bytes > 0)
+        {
+            array->data = array->data
+                              ? flow_region_realloc(array->region, array->data,
+                                                    byteSize(elementSize, array->capacity), bytes)
+                              : flow_region_alloc(array->region, bytes);
+        }
+        array->capacity = capacity;
+    }
+
+    extern "C" FlowArray* flow_array_keep(FlowArray* array, int64_t elementSize, int64_t mark)
+    {
+        if (!array || mark < 1 || array->region < mark)
+        {
+            return array;
+        }
+
+        FlowArray* copy = allocateArray(mark - 1, elementSize, array->length);
+        if (copy->data)
+        {
+            std::memcpy(copy->data, array->data, static_cast<size_t>(elementSize * array->length));
+        }
+        return copy;
+    }
+} // namespace flow
@@ -0,0 +1,482 @@
+#include "../../include/Stdlib/FlowString.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace flow
+{
+    namespace
+    {
+        // Regions grow in 64 KiB chunks; a string over a quarter of that
+        // gets a chunk of its own, so a chunk wastes at most a quarter
+        constexpr size_t chunkSize = 64 * 1024;
+        constexpr size_t largeAllocation = chunkSize / 4;
+
+        // Arrays are allocated in regions too, aligned for any element type
+        constexpr size_t elementAlignment = alignof(std::max_align_t);
+
+        // Released chunks kept for reuse, so a region entered on every call
+        // doesn't go back to malloc each time
+        constexpr size_t maxSpareChunks = 16;
+
+        struct Chunk
+        {
+            Chunk* next;
+            size_t size; // bytes after the header
+
+            char* begin() { return reinterpret_cast<char*>(this + 1); }
+            char* end() { return begin() + size; }
+        };
+
+        struct Region
+        {
+            Chunk* chunks = nullptr; // newest first
+            char* cursor = nullptr;  // free space in the newest standard chunk
+            char* limit = nullptr;
+            char* low = nullptr;     // bounds of all its chunks, so an address
+            char* high = nullptr;    // outside them is ruled out without a walk
+        };
+
+        class RegionStack
+        {
+        private:
+            std::vector<Region> regions; // regions[0] is never released
+            Chunk* spare = nullptr;
+            size_t spareCount = 0;
+
+            [[noreturn]] static void outOfMemory()
+            {
+                std::fputs("Runtime Error: out of memory\n", stderr);
+                std::abort();
+            }
+
+            Chunk* newChunk(size_t size)
+            {
+                if (size == chunkSize && spare)
+                {
+                    Chunk* chunk = spare;
+                    spare = chunk->next;
+                    spareCount--;
+                    return chunk;
+                }
+
+                auto* chunk = static_cast<Chunk*>(std::malloc(sizeof(Chunk) + size));
+                if (!chunk)
+                {
+                    outOfMemory();
+                }
+                chunk->size = size;
+                return chunk;
+            }
+
+            static void addChunk(Region& region, Chunk* chunk)
+            {
+                chunk->next = region.chunks;
+                region.chunks = chunk;
+                widen(region, chunk);
+            }
+
+            static void widen(Region& region, Chunk* chunk)
+            {
+                if (!region.low || chunk->begin() < region.low)
+                {
+                    region.low = chunk->begin();
+                }
+                if (!region.high || chunk->end() > region.high)
+                {
+                    region.high = chunk->end();
+                }
+            }
+
+            void releaseChunks(Chunk* chunk)
+            {
+                while (chunk)
+                {
+                    Chunk* next = chunk->next;
+                    if (chunk->size == chunkSize && spareCount < maxSpareChunks)
+                    {
+                        chunk->next = spare;
+                        spare = chunk;
+                        spareCount++;
+                    }
+                    else
+                    {
+                        std::free(chunk);
+                    }
+                    chunk = next;
+                }
+            }
+
+        public:
+            RegionStack() : regions(1)
+            {
+            }
+
+            ~RegionStack()
+            {
+                leave(0);
+                spareCount = maxSpareChunks; // free rather than keep
+                for (Region& region: regions)
+                {
+                    releaseChunks(region.chunks);
+                }
+                while (spare)
+                {
+                    Chunk* next = spare->next;
+                    std::free(spare);
+                    spare = next;
+                }
+            }
+
+            char* allocate(size_t index, size_t bytes, size_t alignment = 1)
+            {
+                Region& region = regions[index];
+                size_t room = static_cast<size_t>(region.limit - region.cursor);
+                size_t padding = (alignment - reinterpret_cast<uintptr_t>(region.cursor) % alignment) % alignment;
+                if (room >= padding && room - padding >= bytes)
+                {
+                    char* memory = region.cursor + padding;
+                    region.cursor = memory + bytes;
+                    return memory;
+                }
+
+                // Large strings get their own chunk behind the one being
+                // filled, which stays current
+                if (bytes > largeAllocation)
+                {
+                    Chunk* chunk = newChunk(bytes);
+                    addChunk(region, chunk);
+                    return chunk->begin();
+                }
+
+                Chunk* chunk = newChunk(chunkSize);
+                addChunk(region, chunk);
+                region.cursor = chunk->begin() + bytes;
+                region.limit = chunk->end();
+                return chunk->begin();
+            }
+
+            char* allocate(size_t bytes)
+            {
+                return allocate(regions.size() - 1, bytes);
+            }
+
+            // Resize a block allocated in region index with elementAlignment.
+            // The newest block in the chunk being filled grows in place, a
+            // block with a chunk of its own is reallocated with it, and any
+            // other block is copied, leaving the old one to its region.
+            char* reallocate(size_t index, char* memory, size_t bytes, size_t newBytes)
+            {
+                Region& region = regions[index];
+                if (memory + bytes == region.cursor && newBytes <= largeAllocation &&
+                    static_cast<size_t>(region.limit - memory) >= newBytes)
+                {
+                    region.cursor = memory + newBytes;
+                    return memory;
+                }
+
+                // Only blocks over largeAllocation have a chunk to themselves
+                if (bytes > largeAllocation && newBytes > largeAllocation)
+                {
+                    for (Chunk** link = &region.chunks; *link; link = &(*link)->next)
+                    {
+                        if ((*link)->begin() != memory)
+                        {
+                            continue;
+                        }
+                        auto* chunk = static_cast<Chunk*>(std::realloc(*link, sizeof(Chunk) + newBytes));
+                        if (!chunk)
+                        {
+                            outOfMemory();
+                        }
+                        chunk->size = newBytes;
+                        *link = chunk;
+                        widen(region, chunk);
+                        return chunk->begin();
+                    }
+                }
+
+                char* copy = allocate(index, newBytes, elementAlignment);
+                std::memcpy(copy, memory, std::min(bytes, newBytes));
+                return copy;
+            }
+
+            size_t enter()
+            {
+                regions.emplace_back();
+                return regions.size() - 1;
+            }
+
+            // Release the regions from mark up; the bottom region stays
+            void leave(size_t mark)
+            {
+                mark = std::max<size_t>(mark, 1);
+                while (regions.size() > mark)
+                {
+                    releaseChunks(regions.back().chunks);
+                    regions.pop_back();
+                }
+            }
+
+            // Whether memory was allocated in a region from mark up. A string
+            // being kept was usually just built, so the newest region and
+            // chunk are tried first, and regions whose chunks all lie
+            // elsewhere are skipped.
+            bool owns(size_t mark, const char* memory) const
+            {
+                for (size_t index = regions.size(); index-- > mark;)
+                {
+                    const Region& region = regions[index];
+                    if (memory < region.low || memory >= region.high)
+                    {
+                        continue;
+                    }
+                    for (Chunk* chunk = region.chunks; chunk; chunk = chunk->next)
+                    {
+                        if (memory >= chunk->begin() && memory < chunk->end())
+                        {
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+
+            size_t depth() const { return regions.size(); }
+        };
+
+        thread_local RegionStack regionStack;
+
+        // A NUL-terminated buffer for length bytes that the caller fills in
+        char* allocate(int64_t length)
+        {
+            char* buffer = regionStack.allocate(static_cast<size_t>(length) + 1);
+            buffer[length] = '\0';
+            return buffer;
+        }
+
+        // "00" "01" ... "99": two digits per division
+        const char digitPairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        unsigned countDigits(uint32_t value)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            // floor(log10) from the bit width, corrected by one comparison
+            static const uint32_t powers[] = {
+                1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+            };
+            unsigned bits = 32 - __builtin_clz(value | 1);
+            unsigned estimate = (bits * 1233) >> 12; // bits * log10(2)
+            return estimate + 1 - (value < powers[estimate]) + (value == 0);
+#else
+            unsigned digits = 1;
+            while (value >= 10)
+            {
+                value /= 10;
+                digits++;
+            }
+            return digits;
+#endif
+        }
+    } // namespace
+
+    extern "C" FlowString flow_string_from_cstr(const char* str)
+    {
+        if (!str)
+        {
+            return FlowString{"", 0};
+        }
+        return FlowString{str, static_cast<int64_t>(std::strlen(str))};
+    }
+
+    extern "C" const char* flow_string_to_cstr(const char* data, int64_t length)
+    {
+        if (!data)
+        {
+            return "";
+        }
+        if (data[length] == '\0')
+        {
+            return data;
+        }
+
+        // A slice that stops short of its buffer's end
+        char* copy = allocate(length);
+        std::memcpy(copy, data, static_cast<size_t>(length));
+        return copy;
+    }
+
+    extern "C" FlowString flow_string_from_buffer(char* buffer, int64_t size, int64_t length)
+    {
+        if (!buffer || size <= 0)
+        {
+            return FlowString{"", 0};
+        }
+        length = length < size - 1 ? length : size - 1;
+        buffer[length] = '\0';
+        return FlowString{buffer, length};
+    }
+
+    extern "C" FlowString flow_string_substr(const char* data, int64_t length, int32_t start, int32_t count)
+    {
+        if (!data || start < 0 || start >= length)
+        {
+            return FlowString{"", 0};
+        }
+
+        int64_t available = length - start;
+        int64_t sliceLength = (count > 0 && count < available) ? count : available;
+        return FlowString{data + start, sliceLength};
+    }
+
+    extern "C" FlowString flow_string_concat(const char* left, int64_t leftLength,
+                                             const char* right, int64_t rightLength)
+    {
+        char* buffer = allocate(leftLength + rightLength);
+        if (leftLength > 0)
+        {
+            std::memcpy(buffer, left, static_cast<size_t>(leftLength));
+        }
+        if (rightLength > 0)
+        {
+            std::memcpy(buffer + leftLength, right, static_cast<size_t>(rightLength));
+        }
+        return FlowString{buffer, leftLength + rightLength};
+    }
+
+    extern "C" FlowString flow_string_concat_n(const FlowString* pieces, int64_t count)
+    {
+        int64_t total = 0;
+        for (int64_t i = 0; i < count; i++)
+        {
+            total += pieces[i].length;
+        }
+
+        char* buffer = allocate(total);
+        char* out = buffer;
+        for (int64_t i = 0; i < count; i++)
+        {
+            if (pieces[i].length > 0)
+            {
+                std::memcpy(out, pieces[i].data, static_cast<size_t>(pieces[i].length));
+                out += pieces[i].length;
+            }
+        }
+        return FlowString{buffer, total};
+    }
+
+    extern "C" int64_t flow_format_int(int32_t value, char* buffer)
+    {
+        char* out = buffer;
+        uint32_t magnitude = static_cast<uint32_t>(value);
+        if (value < 0)
+        {
+            *out++ = '-';
+            magnitude = 0u - magnitude;
+        }
+
+        // Fill from the last digit back, two at a time
+        char* end = out + countDigits(magnitude);
+        char* digit = end;
+        while (magnitude >= 100)
+        {
+            unsigned pair = (magnitude % 100) * 2;
+            magnitude /= 100;
+            digit -= 2;
+            std::memcpy(digit, digitPairs + pair, 2);
+        }
+        if (magnitude >= 10)
+        {
+            std::memcpy(digit - 2, digitPairs + magnitude * 2, 2);
+        }
+        else
+        {
+            digit[-1] = static_cast<char>('0' + magnitude);
+        }
+
+        *end = '\0';
+        return end - buffer;
+    }
+
+    extern "C" int64_t flow_format_float(double value, char* buffer)
+    {
+        // Shortest digits that parse back to the same double (libstdc++ and
+        // libc++ implement this with Ryu), without locale or format parsing
+        char* end = std::to_chars(buffer, buffer + flowFloatBufferSize - 3, value).ptr;
+
+        // Keep whole numbers recognizable as floats: 1 -> 1.0
+        if (std::isfinite(value) && !std::memchr(buffer, '.', end - buffer) && !std::memchr(buffer, 'e', end - buffer))
+        {
+            *end++ = '.';
+            *end++ = '0';
+        }
+
+        *end = '\0';
+        return end - buffer;
+    }
+
+    extern "C" int32_t flow_string_equals(const char* left, int64_t leftLength,
+                                          const char* right, int64_t rightLength)
+    {
+        if (leftLength != rightLength)
+        {
+            return 0;
+        }
+        return leftLength == 0 || std::memcmp(left, right, static_cast<size_t>(leftLength)) == 0;
+    }
+
+    extern "C" char* flow_string_alloc(int64_t length)
+    {
+        return allocate(length);
+    }
+
+    extern "C" int64_t flow_region_enter()
+    {
+        return static_cast<int64_t>(regionStack.enter());
+    }
+
+    extern "C" void flow_region_leave(int64_t mark)
+    {
+        regionStack.leave(static_cast<size_t>(mark));
+    }
+
+    extern "C" FlowString flow_region_keep(const char* data, int64_t length, int64_t mark)
+    {
+        size_t below = static_cast<size_t>(mark) - 1;
+        if (!data || mark < 1 || static_cast<size_t>(mark) >= regionStack.depth() ||
+            !regionStack.owns(static_cast<size_t>(mark), data))
+        {
+            return FlowString{data, length};
+        }
+
+        char* copy = regionStack.allocate(below, static_cast<size_t>(length) + 1);
+        std::memcpy(copy, data, static_cast<size_t>(length));
+        copy[length] = '\0';
+        return FlowString{copy, length};
+    }
+
+    extern "C" int64_t flow_region_current()
+    {
+        return static_cast<int64_t>(regionStack.depth() - 1);
+    }
+
+    extern "C" void* flow_region_alloc(int64_t region, int64_t bytes)
+    {
+        return regionStack.allocate(static_cast<size_t>(region), static_cast<size_t>(bytes), elementAlignment);
+    }
+
+    extern "C" void* flow_region_realloc(int64_t region, void* memory, int64_t bytes, int64_t newBytes)
+    {
+        return regionStack.reallocate(static_cast<size_t>(region), static_cast<char*>(memory),
+                                      static_cast<size_t>(bytes), static_cast<size_t>(newBytes));
+    }
+} // namespace flow
@@ -77,6 +77,16 @@ impl Builder {
         let is_library = self.package.is_library();
         
         let mut cmd = Command::new(&flow_compiler);
+        
+        // Hand the compile to a running `flowbase --server` so each package
+        // doesn't pay LLVM start-up and re-parse shared imports
+        if let Some(socket) = self.compile_server_socket() {
+            println!("  {} Using compile server: {}", "→".cyan(), socket.display());
+            cmd.arg("--client");
+            cmd.arg("--socket");
+            cmd.arg(&socket);
+        }
+        
         cmd.arg(&entry_point);
         
         // If library, add -c flag for object-only compilation
@@ -175,6 +185,34 @@ impl Builder {
         Err("Flow compiler (flowbase or flow) not found. Please set FLOW_HOME or ensure flowbase/flow is in PATH".into())
     }
     
+    fn compile_server_socket(&self) -> Option<PathBuf> {
+        // Same lookup order as flowbase: $FLOW_SERVER_SOCKET, then
+        // $XDG_RUNTIME_DIR/flowbase.sock, then /tmp/flowbase-<uid>.sock
+        let env_path = |name: &str| std::env::var(name).ok().filter(|value| !value.is_empty());
+        let socket = if let Some(path) = env_path("FLOW_SERVER_SOCKET") {
+            PathBuf::from(path)
+        } else if let Some(runtime_dir) = env_path("XDG_RUNTIME_DIR") {
+            PathBuf::from(runtime_dir).join("flowbase.sock")
+        } else {
+            #[cfg(unix)]
+            {
+                use std::os::unix::fs::MetadataExt;
+                let uid = fs::metadata("/proc/self").ok()?.uid();
+                PathBuf::from(format!("/tmp/flowbase-{}.sock", uid))
+            }
+            #[cfg(not(unix))]
+            {
+                return None;
+            }
+        };
+        
+        if socket.exists() {
+            Some(socket)
+        } else {
+            None
+        }
+    }
+    
     fn build_dependency(&self, dep: &crate::resolver::ResolvedDependency) -> Result<PathBuf, Box<dyn std::error::Error>> {
         println!("  {} Building dependency: {}", "→".cyan(), dep.name.yellow());
         